@@ -120,12 +120,6 @@ const char *const forced_keyframes_const_names[] = {
     NULL
 };
 
-typedef struct BenchmarkTimeStamps {
-    int64_t real_usec;
-    int64_t user_usec;
-    int64_t sys_usec;
-} BenchmarkTimeStamps;
-
 static void do_video_stats(OutputStream *ost, int frame_size);
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
 static int64_t getmaxrss(void);
@@ -166,6 +160,7 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_output_threads(void);
 #endif
 
 /* sub2video hack:
@@ -335,7 +330,7 @@ static volatile int received_sigterm = 0;
 static volatile int received_nb_signals = 0;
 static atomic_int transcode_init_done = ATOMIC_VAR_INIT(0);
 static volatile int ffmpeg_exited = 0;
-static int main_return_code = 0;
+static atomic_int main_return_code = ATOMIC_VAR_INIT(0);
 
 static void
 sigterm_handler(int sig)
@@ -489,8 +484,23 @@ static void ffmpeg_cleanup(int ret)
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
     }
 
+#if HAVE_THREADS
+    /* stop the output threads before freeing anything they may use */
+    free_output_threads();
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        if (fg->graph) {
+            AVBufferPoolStats stats;
+
+            avfilter_graph_get_pool_stats(fg->graph, &stats);
+            av_log(NULL, AV_LOG_VERBOSE, "Filtergraph #%d frame pools: "
+                   "%d buffers allocated (%"PRId64" kB), peak %d in use, "
+                   "%"PRIu64" reused, %"PRIu64" allocated\n", fg->index,
+                   stats.allocated, stats.bytes / 1024, stats.peak,
+                   stats.hits, stats.misses);
+        }
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             while (av_fifo_size(fg->inputs[j]->frame_queue)) {
@@ -556,6 +566,8 @@ static void ffmpeg_cleanup(int ret)
 
         av_frame_free(&ost->filtered_frame);
         av_frame_free(&ost->last_frame);
+        av_buffer_unref(&ost->dup_buf);
+        av_packet_unref(&ost->dup_pkt);
         av_dict_free(&ost->encoder_opts);
 
         av_freep(&ost->forced_keyframes);
@@ -613,6 +625,7 @@ static void ffmpeg_cleanup(int ret)
                    av_err2str(AVERROR(errno)));
     }
     av_freep(&vstats_filename);
+    av_freep(&benchmark_json);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -656,40 +669,85 @@ static void abort_codec_experimental(AVCodec *c, int encoder)
     exit_program(1);
 }
 
-static void update_benchmark(const char *fmt, ...)
+static void update_benchmark_va(BenchmarkTimeStamps *last, const char *fmt, va_list va)
 {
     if (do_benchmark_all) {
         BenchmarkTimeStamps t = get_benchmark_time_stamps();
-        va_list va;
         char buf[1024];
 
         if (fmt) {
-            va_start(va, fmt);
             vsnprintf(buf, sizeof(buf), fmt, va);
-            va_end(va);
             av_log(NULL, AV_LOG_INFO,
                    "bench: %8" PRIu64 " user %8" PRIu64 " sys %8" PRIu64 " real %s \n",
-                   t.user_usec - current_time.user_usec,
-                   t.sys_usec - current_time.sys_usec,
-                   t.real_usec - current_time.real_usec, buf);
+                   t.user_usec - last->user_usec,
+                   t.sys_usec - last->sys_usec,
+                   t.real_usec - last->real_usec, buf);
         }
-        current_time = t;
+        *last = t;
     }
 }
 
+static void update_benchmark(const char *fmt, ...)
+{
+    va_list va;
+
+    va_start(va, fmt);
+    update_benchmark_va(&current_time, fmt, va);
+    va_end(va);
+}
+
+/*
+ * update_benchmark() for the encoding of ost, which may happen in its own
+ * thread. The user and sys times are those of the whole process.
+ */
+static void update_encoder_benchmark(OutputStream *ost, const char *fmt, ...)
+{
+    BenchmarkTimeStamps *last = &current_time;
+    va_list va;
+
+#if HAVE_THREADS
+    if (ost->enc_thread_queue)
+        last = &ost->enc_thread_bench;
+#endif
+    va_start(va, fmt);
+    update_benchmark_va(last, fmt, va);
+    va_end(va);
+}
+
+/*
+ * Wall-clock accounting of the time spent in the processing stages, reported
+ * with -benchmark_json.
+ */
+static int64_t stage_start(void)
+{
+    return benchmark_json ? av_gettime_relative() : 0;
+}
+
+static void stage_end(int64_t *total, int64_t start)
+{
+    if (benchmark_json)
+        *total += av_gettime_relative() - start;
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
-        ost2->finished |= ost == ost2 ? this_stream : others;
+        atomic_fetch_or(&ost2->finished, ost == ost2 ? this_stream : others);
     }
 }
 
-static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
+/*
+ * Mux a packet, or pass it to the muxing thread. This may run in the encoding
+ * thread of ost, so errors which must stop the program are returned instead
+ * of calling exit_program().
+ */
+static int write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    int64_t start;
     int ret;
 
     /*
@@ -701,11 +759,11 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
      * Do not count the packet when unqueued because it has been counted when queued.
      */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && ost->encoding_needed) && !unqueue) {
-        if (ost->frame_number >= ost->max_frames) {
+        if (atomic_load(&ost->frame_number) >= ost->max_frames) {
             av_packet_unref(pkt);
-            return;
+            return 0;
         }
-        ost->frame_number++;
+        atomic_fetch_add(&ost->frame_number, 1);
     }
 
     if (!of->header_written) {
@@ -718,18 +776,19 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                 av_log(NULL, AV_LOG_ERROR,
                        "Too many packets buffered for output stream %d:%d.\n",
                        ost->file_index, ost->st->index);
-                exit_program(1);
+                av_packet_unref(pkt);
+                return AVERROR(ENOSPC);
             }
             ret = av_fifo_realloc2(ost->muxing_queue, new_size);
             if (ret < 0)
-                exit_program(1);
+                goto fail;
         }
         ret = av_packet_make_refcounted(pkt);
         if (ret < 0)
-            exit_program(1);
+            goto fail;
         av_packet_move_ref(&tmp_pkt, pkt);
         av_fifo_generic_write(ost->muxing_queue, &tmp_pkt, sizeof(tmp_pkt), NULL);
-        return;
+        return 0;
     }
 
     if ((st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
@@ -740,14 +799,14 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
         int i;
         uint8_t *sd = av_packet_get_side_data(pkt, AV_PKT_DATA_QUALITY_STATS,
                                               NULL);
-        ost->quality = sd ? AV_RL32(sd) : -1;
-        ost->pict_type = sd ? sd[4] : AV_PICTURE_TYPE_NONE;
+        atomic_store(&ost->quality, sd ? AV_RL32(sd) : -1);
+        atomic_store(&ost->pict_type, sd ? sd[4] : AV_PICTURE_TYPE_NONE);
 
         for (i = 0; i<FF_ARRAY_ELEMS(ost->error); i++) {
             if (sd && i < sd[5])
-                ost->error[i] = AV_RL64(sd + 8 + 8*i);
+                atomic_store(&ost->error[i], AV_RL64(sd + 8 + 8*i));
             else
-                ost->error[i] = -1;
+                atomic_store(&ost->error[i], -1);
         }
 
         if (ost->frame_rate.num && ost->is_cfr) {
@@ -784,7 +843,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                        ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
                 if (exit_on_error) {
                     av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-                    exit_program(1);
+                    av_packet_unref(pkt);
+                    return AVERROR(EINVAL);
                 }
                 av_log(s, loglevel, "changing to %"PRId64". This may result "
                        "in incorrect timestamps in the output file.\n",
@@ -797,8 +857,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
     }
     ost->last_mux_dts = pkt->dts;
 
-    ost->data_size += pkt->size;
-    ost->packets_written++;
+    atomic_fetch_add(&ost->data_size, pkt->size);
+    atomic_fetch_add(&ost->packets_written, 1);
 
     pkt->stream_index = ost->index;
 
@@ -812,20 +872,53 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+#if HAVE_THREADS
+    if (of->mux_thread_queue) {
+        AVPacket tmp_pkt;
+
+        ret = av_packet_make_refcounted(pkt);
+        if (ret < 0)
+            goto fail;
+        av_packet_move_ref(&tmp_pkt, pkt);
+        start = stage_start();
+        ret = av_thread_message_queue_send(of->mux_thread_queue, &tmp_pkt, 0);
+        stage_end(&ost->mux_queue_send_wait, start);
+        if (benchmark_json)
+            ost->mux_queue_max = FFMAX(ost->mux_queue_max,
+                                       av_thread_message_queue_nb_elems(of->mux_thread_queue));
+        if (ret < 0) {
+            /* the error has already been reported by the muxing thread */
+            av_packet_unref(&tmp_pkt);
+            atomic_store(&main_return_code, 1);
+            close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        }
+        return 0;
+    }
+#endif
+
+    start = stage_start();
     ret = av_interleaved_write_frame(s, pkt);
+    stage_end(&ost->mux_time, start);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
-        main_return_code = 1;
+        atomic_store(&main_return_code, 1);
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
     av_packet_unref(pkt);
+    return 0;
+
+fail:
+    av_log(NULL, AV_LOG_FATAL, "Error writing a packet for output stream #%d:%d: %s\n",
+           ost->file_index, ost->index, av_err2str(ret));
+    av_packet_unref(pkt);
+    return ret;
 }
 
 static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
-    ost->finished |= ENCODER_FINISHED;
+    atomic_fetch_or(&ost->finished, ENCODER_FINISHED);
     if (of->shortest) {
         int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
         of->recording_time = FFMIN(of->recording_time, end);
@@ -842,8 +935,10 @@ static void close_output_stream(OutputStream *ost)
  * If eof is set, instead indicate EOF to all bitstream filters and
  * therefore flush any delayed packets to the output.  A blank packet
  * must be supplied in this case.
+ *
+ * Returns a negative error code if the program must be stopped.
  */
-static void output_packet(OutputFile *of, AVPacket *pkt,
+static int output_packet(OutputFile *of, AVPacket *pkt,
                           OutputStream *ost, int eof)
 {
     int ret = 0;
@@ -879,19 +974,20 @@ static void output_packet(OutputFile *of, AVPacket *pkt,
                 eof = 0;
             } else if (eof)
                 goto finish;
-            else
-                write_packet(of, pkt, ost, 0);
+            else if ((ret = write_packet(of, pkt, ost, 0)) < 0)
+                return ret;
         }
     } else if (!eof)
-        write_packet(of, pkt, ost, 0);
+        return write_packet(of, pkt, ost, 0);
 
 finish:
     if (ret < 0 && ret != AVERROR_EOF) {
         av_log(NULL, AV_LOG_ERROR, "Error applying bitstream filters to an output "
                "packet for stream #%d:%d.\n", ost->file_index, ost->index);
         if(exit_on_error)
-            exit_program(1);
+            return ret;
     }
+    return 0;
 }
 
 static int check_recording_time(OutputStream *ost)
@@ -907,64 +1003,199 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
-static void do_audio_out(OutputFile *of, OutputStream *ost,
-                         AVFrame *frame)
+/*
+ * Hand a packet returned by the encoder over to output_packet(). The packet timestamps are in the encoder time base.
+ */
+static int output_encoded_packet(OutputFile *of, OutputStream *ost, AVPacket *pkt)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+    const char *type_desc = av_get_media_type_string(enc->codec_type);
+
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base));
+    }
+
+    av_packet_rescale_ts(pkt, enc->time_base, ost->mux_timebase);
+
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &ost->mux_timebase),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &ost->mux_timebase));
+    }
+
+    return output_packet(of, pkt, ost, 0);
+}
+
+/*
+ * Check whether the frame shows the same picture as the one the packet in
+ * ost->dup_pkt was encoded from. The reference held in ost->dup_buf keeps the
+ * buffer from being written to or returned to its pool in the meantime, so
+ * sharing it means sharing the picture.
+ */
+static int is_dup_frame(OutputStream *ost, const AVFrame *frame)
+{
+    return ost->dup_buf && frame->buf[0] &&
+           frame->buf[0]->buffer == ost->dup_buf->buffer &&
+           frame->data[0] == ost->dup_buf->data;
+}
+
+/*
+ * Send a single audio or video frame to the encoder of the output stream
+ * and pass all the packets it returns on to output_packet().
+ *
+ * With -dup_packets, a frame repeating the previous picture is not encoded
+ * again; the packet of the previous frame is sent with new timestamps instead.
+ *
+ * This is called from the main thread, or from the encoding thread of the
+ * stream when -output_threads is enabled.
+ */
+static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
+    const char *type_desc = av_get_media_type_string(enc->codec_type);
     AVPacket pkt;
+    int frame_size = 0, nb_pkts = 0;
+    int64_t start;
     int ret;
 
     av_init_packet(&pkt);
     pkt.data = NULL;
     pkt.size = 0;
 
-    if (!check_recording_time(ost))
-        return;
-
-    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
-        frame->pts = ost->sync_opts;
-    ost->sync_opts = frame->pts + frame->nb_samples;
-    ost->samples_encoded += frame->nb_samples;
-    ost->frames_encoded++;
-
-    av_assert0(pkt.size || !pkt.data);
-    update_benchmark(NULL);
+    update_encoder_benchmark(ost, NULL);
     if (debug_ts) {
-        av_log(NULL, AV_LOG_INFO, "encoder <- type:audio "
+        av_log(NULL, AV_LOG_INFO, "encoder <- type:%s "
                "frame_pts:%s frame_pts_time:%s time_base:%d/%d\n",
+               type_desc,
                av_ts2str(frame->pts), av_ts2timestr(frame->pts, &enc->time_base),
                enc->time_base.num, enc->time_base.den);
     }
 
+    if (ost->dup_packets && is_dup_frame(ost, frame)) {
+        ret = av_packet_ref(&pkt, &ost->dup_pkt);
+        if (ret < 0)
+            return ret;
+        pkt.pts = pkt.dts = frame->pts;
+
+        frame_size = pkt.size;
+        ret = output_encoded_packet(of, ost, &pkt);
+        if (ret < 0)
+            return ret;
+        goto end;
+    }
+
+    start = stage_start();
     ret = avcodec_send_frame(enc, frame);
+    stage_end(&ost->encode_time, start);
     if (ret < 0)
-        goto error;
+        return ret;
 
     while (1) {
+        start = stage_start();
         ret = avcodec_receive_packet(enc, &pkt);
+        stage_end(&ost->encode_time, start);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
-            goto error;
+            return ret;
 
-        update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
+        update_encoder_benchmark(ost, "encode_%s %d.%d", type_desc, ost->file_index, ost->index);
 
-        av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
+        if (enc->codec_type == AVMEDIA_TYPE_VIDEO &&
+            pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+            pkt.pts = frame->pts;
 
-        if (debug_ts) {
-            av_log(NULL, AV_LOG_INFO, "encoder -> type:audio "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                   av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
-                   av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
+        if (ost->dup_packets && !nb_pkts++) {
+            av_packet_unref(&ost->dup_pkt);
+            if (pkt.pts == frame->pts) {
+                ret = av_packet_ref(&ost->dup_pkt, &pkt);
+                if (ret < 0)
+                    return ret;
+            }
         }
 
-        output_packet(of, &pkt, ost, 0);
+        frame_size = pkt.size;
+        ret = output_encoded_packet(of, ost, &pkt);
+        if (ret < 0)
+            return ret;
+
+        /* if two pass, output log */
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
+        }
     }
 
-    return;
-error:
-    av_log(NULL, AV_LOG_FATAL, "Audio encoding failed\n");
-    exit_program(1);
+    /* only reuse the packet if the frame was coded into exactly that one */
+    if (ost->dup_packets) {
+        av_buffer_unref(&ost->dup_buf);
+        if (nb_pkts == 1 && ost->dup_pkt.data && frame->buf[0]) {
+            ost->dup_buf = av_buffer_ref(frame->buf[0]);
+            if (!ost->dup_buf)
+                return AVERROR(ENOMEM);
+        } else
+            av_packet_unref(&ost->dup_pkt);
+    }
+
+end:
+    if (enc->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename && frame_size)
+        do_video_stats(ost, frame_size);
+
+    return 0;
+}
+
+/*
+ * Pass a frame to the encoder of the output stream, either directly or
+ * through the queue of its encoding thread. The frame is not consumed.
+ */
+static int send_frame_to_encoder(OutputFile *of, OutputStream *ost, AVFrame *frame)
+{
+#if HAVE_THREADS
+    if (ost->enc_thread_queue) {
+        AVFrame *ref = av_frame_clone(frame);
+        int64_t start;
+        int ret;
+
+        if (!ref)
+            return AVERROR(ENOMEM);
+        start = stage_start();
+        ret = av_thread_message_queue_send(ost->enc_thread_queue, &ref, 0);
+        stage_end(&ost->enc_queue_send_wait, start);
+        if (benchmark_json)
+            ost->enc_queue_max = FFMAX(ost->enc_queue_max,
+                                       av_thread_message_queue_nb_elems(ost->enc_thread_queue));
+        if (ret < 0)
+            av_frame_free(&ref);
+        return ret;
+    }
+#endif
+    return encode_frame(of, ost, frame);
+}
+
+static void do_audio_out(OutputFile *of, OutputStream *ost,
+                         AVFrame *frame)
+{
+    int ret;
+
+    if (!check_recording_time(ost))
+        return;
+
+    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
+        frame->pts = ost->sync_opts;
+    ost->sync_opts = frame->pts + frame->nb_samples;
+    ost->samples_encoded += frame->nb_samples;
+    ost->frames_encoded++;
+
+    ret = send_frame_to_encoder(of, ost, frame);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Audio encoding failed\n");
+        exit_program(1);
+    }
 }
 
 static void do_subtitle_out(OutputFile *of,
@@ -1046,7 +1277,8 @@ static void do_subtitle_out(OutputFile *of,
                 pkt.pts += av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
         }
         pkt.dts = pkt.pts;
-        output_packet(of, &pkt, ost, 0);
+        if (output_packet(of, &pkt, ost, 0) < 0)
+            exit_program(1);
     }
 }
 
@@ -1056,14 +1288,12 @@ static void do_video_out(OutputFile *of,
                          double sync_ipts)
 {
     int ret, format_video_sync;
-    AVPacket pkt;
     AVCodecContext *enc = ost->enc_ctx;
     AVCodecParameters *mux_par = ost->st->codecpar;
     AVRational frame_rate;
     int nb_frames, nb0_frames, i;
     double delta, delta0;
     double duration = 0;
-    int frame_size = 0;
     InputStream *ist = NULL;
     AVFilterContext *filter = ost->filter->filter;
 
@@ -1132,7 +1362,7 @@ static void do_video_out(OutputFile *of,
 
         switch (format_video_sync) {
         case VSYNC_VSCFR:
-            if (ost->frame_number == 0 && delta0 >= 0.5) {
+            if (atomic_load(&ost->frame_number) == 0 && delta0 >= 0.5) {
                 av_log(NULL, AV_LOG_DEBUG, "Not duplicating %d initial frames\n", (int)lrintf(delta0));
                 delta = duration;
                 delta0 = 0;
@@ -1140,7 +1370,7 @@ static void do_video_out(OutputFile *of,
             }
         case VSYNC_CFR:
             // FIXME set to 0.5 after we fix some dts/pts bugs like in avidec.c
-            if (frame_drop_threshold && delta < frame_drop_threshold && ost->frame_number) {
+            if (frame_drop_threshold && delta < frame_drop_threshold && atomic_load(&ost->frame_number)) {
                 nb_frames = 0;
             } else if (delta < -1.1)
                 nb_frames = 0;
@@ -1165,7 +1395,7 @@ static void do_video_out(OutputFile *of,
         }
     }
 
-    nb_frames = FFMIN(nb_frames, ost->max_frames - ost->frame_number);
+    nb_frames = FFMIN(nb_frames, ost->max_frames - atomic_load(&ost->frame_number));
     nb0_frames = FFMIN(nb0_frames, nb_frames);
 
     memmove(ost->last_nb0_frames + 1,
@@ -1177,7 +1407,7 @@ static void do_video_out(OutputFile *of,
         nb_frames_drop++;
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
-               ost->frame_number, ost->st->index, ost->last_frame->pts);
+               atomic_load(&ost->frame_number), ost->st->index, ost->last_frame->pts);
     }
     if (nb_frames > (nb0_frames && ost->last_dropped) + (nb_frames > nb0_frames)) {
         if (nb_frames > dts_error_threshold * 30) {
@@ -1199,9 +1429,6 @@ static void do_video_out(OutputFile *of,
         AVFrame *in_picture;
         int forced_keyframe = 0;
         double pts_time;
-        av_init_packet(&pkt);
-        pkt.data = NULL;
-        pkt.size = 0;
 
         if (i < nb0_frames && ost->last_frame) {
             in_picture = ost->last_frame;
@@ -1274,67 +1501,21 @@ static void do_video_out(OutputFile *of,
             av_log(NULL, AV_LOG_DEBUG, "Forced keyframe at time %f\n", pts_time);
         }
 
-        update_benchmark(NULL);
-        if (debug_ts) {
-            av_log(NULL, AV_LOG_INFO, "encoder <- type:video "
-                   "frame_pts:%s frame_pts_time:%s time_base:%d/%d\n",
-                   av_ts2str(in_picture->pts), av_ts2timestr(in_picture->pts, &enc->time_base),
-                   enc->time_base.num, enc->time_base.den);
-        }
-
         ost->frames_encoded++;
 
-        ret = avcodec_send_frame(enc, in_picture);
+        ret = send_frame_to_encoder(of, ost, in_picture);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
 
-        while (1) {
-            ret = avcodec_receive_packet(enc, &pkt);
-            update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
-            if (ret == AVERROR(EAGAIN))
-                break;
-            if (ret < 0)
-                goto error;
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                       "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                       av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
-                       av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
-            }
-
-            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
-                pkt.pts = ost->sync_opts;
-
-            av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                    "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                    av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->mux_timebase),
-                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->mux_timebase));
-            }
-
-            frame_size = pkt.size;
-            output_packet(of, &pkt, ost, 0);
-
-            /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
-        }
         ost->sync_opts++;
         /*
          * For video, number of frames in == number of packets out.
          * But there may be reordering, so we can't throw away frames on encoder
          * flush, we need to limit them here, before they go into encoder.
          */
-        ost->frame_number++;
-
-        if (vstats_filename && frame_size)
-            do_video_stats(ost, frame_size);
+        atomic_fetch_add(&ost->frame_number, 1);
     }
 
     if (!ost->last_frame)
@@ -1359,7 +1540,10 @@ static double psnr(double d)
 static void do_video_stats(OutputStream *ost, int frame_size)
 {
     AVCodecContext *enc;
-    int frame_number;
+    AVBPrint buf;
+    int frame_number, quality, threaded = 0;
+    int64_t error, end_pts;
+    uint64_t data_size;
     double ti1, bitrate, avg_bitrate;
 
     /* this is executed just the first time do_video_stats is called */
@@ -1371,31 +1555,52 @@ static void do_video_stats(OutputStream *ost, int frame_size)
         }
     }
 
+#if HAVE_THREADS
+    threaded = !!ost->enc_thread_queue;
+#endif
+
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
-        frame_number = ost->st->nb_frames;
+        /* the stream is only updated by the muxing thread if there is one,
+         * use what write_packet() recorded instead */
+        if (threaded) {
+            frame_number = atomic_load(&ost->packets_written);
+            end_pts      = ost->last_mux_dts;
+        } else {
+            frame_number = ost->st->nb_frames;
+            end_pts      = av_stream_get_end_pts(ost->st);
+        }
+        quality   = atomic_load(&ost->quality);
+        error     = atomic_load(&ost->error[0]);
+        data_size = atomic_load(&ost->data_size);
+
+        /* print the whole line at once, the streams may be encoded in
+         * concurrent threads */
+        av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
         if (vstats_version <= 1) {
-            fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number,
-                    ost->quality / (float)FF_QP2LAMBDA);
+            av_bprintf(&buf, "frame= %5d q= %2.1f ", frame_number,
+                       quality / (float)FF_QP2LAMBDA);
         } else  {
-            fprintf(vstats_file, "out= %2d st= %2d frame= %5d q= %2.1f ", ost->file_index, ost->index, frame_number,
-                    ost->quality / (float)FF_QP2LAMBDA);
+            av_bprintf(&buf, "out= %2d st= %2d frame= %5d q= %2.1f ", ost->file_index, ost->index, frame_number,
+                       quality / (float)FF_QP2LAMBDA);
         }
 
-        if (ost->error[0]>=0 && (enc->flags & AV_CODEC_FLAG_PSNR))
-            fprintf(vstats_file, "PSNR= %6.2f ", psnr(ost->error[0] / (enc->width * enc->height * 255.0 * 255.0)));
+        if (error>=0 && (enc->flags & AV_CODEC_FLAG_PSNR))
+            av_bprintf(&buf, "PSNR= %6.2f ", psnr(error / (enc->width * enc->height * 255.0 * 255.0)));
 
-        fprintf(vstats_file,"f_size= %6d ", frame_size);
+        av_bprintf(&buf,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
+        ti1 = end_pts * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
         bitrate     = (frame_size * 8) / av_q2d(enc->time_base) / 1000.0;
-        avg_bitrate = (double)(ost->data_size * 8) / ti1 / 1000.0;
-        fprintf(vstats_file, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
-               (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
-        fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(ost->pict_type));
+        avg_bitrate = (double)(data_size * 8) / ti1 / 1000.0;
+        av_bprintf(&buf, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
+                   (double)data_size / 1024, ti1, bitrate, avg_bitrate);
+        av_bprintf(&buf, "type= %c\n", av_get_picture_type_char(atomic_load(&ost->pict_type)));
+        fputs(buf.str, vstats_file);
+        av_bprint_finalize(&buf, NULL);
     }
 }
 
@@ -1406,7 +1611,7 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
-    ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
+    atomic_store(&ost->finished, ENCODER_FINISHED | MUXER_FINISHED);
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
@@ -1414,6 +1619,31 @@ static void finish_output_stream(OutputStream *ost)
     }
 }
 
+/* Return the current write position in the output file. */
+static int64_t output_file_tell(OutputFile *of)
+{
+#if HAVE_THREADS
+    if (of->mux_thread_queue)
+        return atomic_load(&of->mux_size);
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
+static int64_t output_file_size(OutputFile *of)
+{
+    int64_t size;
+
+#if HAVE_THREADS
+    /* the AVIOContext belongs to the muxing thread */
+    if (of->mux_thread_queue)
+        return atomic_load(&of->mux_size);
+#endif
+    size = avio_size(of->ctx->pb);
+    if (size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+        size = avio_tell(of->ctx->pb);
+    return size;
+}
+
 /**
  * Get and encode new output from any of the filtergraphs, without causing
  * activity.
@@ -1466,7 +1696,7 @@ static int reap_filters(int flush)
                 }
                 break;
             }
-            if (ost->finished) {
+            if (atomic_load(&ost->finished)) {
                 av_frame_unref(filtered_frame);
                 continue;
             }
@@ -1536,13 +1766,13 @@ static void print_final_stats(int64_t total_size)
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
         switch (ost->enc_ctx->codec_type) {
-            case AVMEDIA_TYPE_VIDEO: video_size += ost->data_size; break;
-            case AVMEDIA_TYPE_AUDIO: audio_size += ost->data_size; break;
-            case AVMEDIA_TYPE_SUBTITLE: subtitle_size += ost->data_size; break;
-            default:                 other_size += ost->data_size; break;
+            case AVMEDIA_TYPE_VIDEO: video_size += atomic_load(&ost->data_size); break;
+            case AVMEDIA_TYPE_AUDIO: audio_size += atomic_load(&ost->data_size); break;
+            case AVMEDIA_TYPE_SUBTITLE: subtitle_size += atomic_load(&ost->data_size); break;
+            default:                 other_size += atomic_load(&ost->data_size); break;
         }
         extra_size += ost->enc_ctx->extradata_size;
-        data_size  += ost->data_size;
+        data_size  += atomic_load(&ost->data_size);
         if (   (ost->enc_ctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2))
             != AV_CODEC_FLAG_PASS1)
             pass1_used = 0;
@@ -1609,8 +1839,8 @@ static void print_final_stats(int64_t total_size)
             OutputStream *ost = output_streams[of->ost_index + j];
             enum AVMediaType type = ost->enc_ctx->codec_type;
 
-            total_size    += ost->data_size;
-            total_packets += ost->packets_written;
+            total_size    += atomic_load(&ost->data_size);
+            total_packets += atomic_load(&ost->packets_written);
 
             av_log(NULL, AV_LOG_VERBOSE, "  Output stream #%d:%d (%s): ",
                    i, j, media_type_string(type));
@@ -1623,7 +1853,7 @@ static void print_final_stats(int64_t total_size)
             }
 
             av_log(NULL, AV_LOG_VERBOSE, "%"PRIu64" packets muxed (%"PRIu64" bytes); ",
-                   ost->packets_written, ost->data_size);
+                   atomic_load(&ost->packets_written), atomic_load(&ost->data_size));
 
             av_log(NULL, AV_LOG_VERBOSE, "\n");
         }
@@ -1645,7 +1875,6 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 {
     AVBPrint buf, buf_script;
     OutputStream *ost;
-    AVFormatContext *oc;
     int64_t total_size;
     AVCodecContext *enc;
     int frame_number, vid, i;
@@ -1675,11 +1904,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     t = (cur_time-timer_start) / 1000000.0;
 
 
-    oc = output_files[0]->ctx;
-
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+    total_size = output_file_size(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
@@ -1689,7 +1914,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         ost = output_streams[i];
         enc = ost->enc_ctx;
         if (!ost->stream_copy)
-            q = ost->quality / (float) FF_QP2LAMBDA;
+            q = atomic_load(&ost->quality) / (float) FF_QP2LAMBDA;
 
         if (vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             av_bprintf(&buf, "q=%2.1f ", q);
@@ -1699,7 +1924,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (!vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             float fps;
 
-            frame_number = ost->frame_number;
+            frame_number = atomic_load(&ost->frame_number);
             fps = t > 1 ? frame_number / t : 0;
             av_bprintf(&buf, "frame=%5d fps=%3.*f q=%3.1f ",
                      frame_number, fps < 9.95, fps, q);
@@ -1718,7 +1943,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                     av_bprintf(&buf, "%X", av_log2(qp_histogram[j] + 1));
             }
 
-            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (ost->pict_type != AV_PICTURE_TYPE_NONE || is_last_report)) {
+            if ((enc->flags & AV_CODEC_FLAG_PSNR) && (atomic_load(&ost->pict_type) != AV_PICTURE_TYPE_NONE || is_last_report)) {
                 int j;
                 double error, error_sum = 0;
                 double scale, scale_sum = 0;
@@ -1730,7 +1955,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                         error = enc->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
-                        error = ost->error[j];
+                        error = atomic_load(&ost->error[j]);
                         scale = enc->width * enc->height * 255.0 * 255.0;
                     }
                     if (j)
@@ -1811,6 +2036,18 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         av_bprintf(&buf_script, "speed=%4.3gx\n", speed);
     }
 
+#if HAVE_THREADS
+    /* high-water marks of the packet queues of the input threads, a single
+     * input is read without a thread */
+    for (i = 0; nb_input_files > 1 && i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        av_bprintf(&buf_script, "input_%d_queue_max_packets=%d\n", i,
+                   atomic_load(&f->queue_max_packets));
+        av_bprintf(&buf_script, "input_%d_queue_max_bytes=%"PRId64"\n", i,
+                   (int64_t)atomic_load(&f->queue_max_bytes));
+    }
+#endif
+
     if (print_stats || is_last_report) {
         const char end = is_last_report ? '\n' : '\r';
         if (print_stats==1 && AV_LOG_INFO > av_log_get_level()) {
@@ -1853,13 +2090,279 @@ static void ifilter_parameters_from_codecpar(InputFilter *ifilter, AVCodecParame
     ifilter->sample_aspect_ratio    = par->sample_aspect_ratio;
 }
 
+/*
+ * Drain the encoder of ost. Like write_packet(), this may run in the encoding
+ * thread, so a negative error code is returned if the program must stop.
+ */
+static int flush_encoder(OutputFile *of, OutputStream *ost)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+    int ret;
+
+    if (enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
+        return 0;
+
+    if (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+
+    for (;;) {
+        const char *desc = NULL;
+        AVPacket pkt;
+        int64_t start;
+        int pkt_size;
+
+        switch (enc->codec_type) {
+        case AVMEDIA_TYPE_AUDIO:
+            desc   = "audio";
+            break;
+        case AVMEDIA_TYPE_VIDEO:
+            desc   = "video";
+            break;
+        default:
+            av_assert0(0);
+        }
+
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+
+        update_encoder_benchmark(ost, NULL);
+        start = stage_start();
+
+        while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
+            ret = avcodec_send_frame(enc, NULL);
+            if (ret < 0) {
+                av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
+                       desc,
+                       av_err2str(ret));
+                return ret;
+            }
+        }
+
+        stage_end(&ost->encode_time, start);
+        update_encoder_benchmark(ost, "flush_%s %d.%d", desc, ost->file_index, ost->index);
+        if (ret < 0 && ret != AVERROR_EOF) {
+            av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
+                   desc,
+                   av_err2str(ret));
+            return ret;
+        }
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
+        }
+        if (ret == AVERROR_EOF)
+            return output_packet(of, &pkt, ost, 1);
+        if (atomic_load(&ost->finished) & MUXER_FINISHED) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
+        pkt_size = pkt.size;
+        ret = output_packet(of, &pkt, ost, 0);
+        if (ret < 0)
+            return ret;
+        if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
+            do_video_stats(ost, pkt_size);
+        }
+    }
+}
+
+#if HAVE_THREADS
+/*
+ * Encode the frames of the queue of ost. The thread never calls
+ * exit_program(): on error it records the error in enc_thread_ret and sets
+ * it on the queue, where the main thread gets it on its next send.
+ */
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    OutputFile    *of = output_files[ost->file_index];
+    int ret;
+
+    while (1) {
+        int64_t start = stage_start();
+        AVFrame *frame;
+
+        ret = av_thread_message_queue_recv(ost->enc_thread_queue, &frame, 0);
+        stage_end(&ost->enc_queue_recv_wait, start);
+        if (ret < 0)
+            return NULL;
+
+        if (!frame) {
+            ret = flush_encoder(of, ost);
+            if (ret < 0)
+                break;
+            av_thread_message_queue_set_err_send(ost->enc_thread_queue, AVERROR_EOF);
+            return NULL;
+        }
+
+        ret = encode_frame(of, ost, frame);
+        av_frame_free(&frame);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error encoding a frame for output stream #%d:%d: %s\n",
+                   ost->file_index, ost->index, av_err2str(ret));
+            break;
+        }
+    }
+
+    ost->enc_thread_ret = ret;
+    av_thread_message_queue_set_err_send(ost->enc_thread_queue, ret);
+    return NULL;
+}
+
+static void *muxer_thread(void *arg)
+{
+    OutputFile *of = arg;
+    AVFormatContext *s = of->ctx;
+    AVPacket pkt;
+    int ret;
+
+    while (1) {
+        OutputStream *ost;
+        int64_t start = stage_start();
+
+        ret = av_thread_message_queue_recv(of->mux_thread_queue, &pkt, 0);
+        stage_end(&of->mux_queue_recv_wait, start);
+        if (ret < 0)
+            break;
+
+        ost   = output_streams[of->ost_index + pkt.stream_index];
+        start = stage_start();
+        ret = av_interleaved_write_frame(s, &pkt);
+        stage_end(&ost->mux_time, start);
+        if (s->pb)
+            atomic_store(&of->mux_size, avio_tell(s->pb));
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            av_thread_message_queue_set_err_send(of->mux_thread_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void free_frame_msg(void *msg)
+{
+    av_frame_free(msg);
+}
+
+static void free_packet_msg(void *msg)
+{
+    av_packet_unref(msg);
+}
+
+/* wait for the encoding thread to flush the encoder and terminate */
+static void finish_encoder_thread(OutputStream *ost)
+{
+    AVFrame *frame = NULL;
+
+    av_thread_message_queue_send(ost->enc_thread_queue, &frame, 0);
+    pthread_join(ost->enc_thread, NULL);
+    av_thread_message_queue_free(&ost->enc_thread_queue);
+    if (ost->enc_thread_ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n",
+               ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO ? "Video" : "Audio");
+        exit_program(1);
+    }
+}
+
+/* write all the queued packets and terminate the muxing thread */
+static void finish_muxer_thread(OutputFile *of)
+{
+    av_thread_message_queue_set_err_recv(of->mux_thread_queue, AVERROR_EOF);
+    pthread_join(of->mux_thread, NULL);
+    av_thread_message_queue_free(&of->mux_thread_queue);
+}
+
+static void free_output_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost || !ost->enc_thread_queue)
+            continue;
+
+        av_thread_message_flush(ost->enc_thread_queue);
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+        pthread_join(ost->enc_thread, NULL);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+    }
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        if (!of || !of->mux_thread_queue)
+            continue;
+
+        finish_muxer_thread(of);
+    }
+}
+
+/*
+ * Start the muxing thread of an output file and the encoding threads of its
+ * streams. This is done once the header has been written, so that the
+ * threads never touch the muxing queues or the muxing time bases.
+ */
+static int init_output_threads(OutputFile *of)
+{
+    int i, ret;
+
+    ret = av_thread_message_queue_alloc(&of->mux_thread_queue,
+                                        of->thread_queue_size, sizeof(AVPacket));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(of->mux_thread_queue, free_packet_msg);
+    atomic_init(&of->mux_size, of->ctx->pb ? avio_tell(of->ctx->pb) : 0);
+
+    if ((ret = pthread_create(&of->mux_thread, NULL, muxer_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_thread_queue);
+        return AVERROR(ret);
+    }
+
+    /* do_video_stats() opens the file lazily, which is not thread-safe */
+    if (vstats_filename && !vstats_file) {
+        vstats_file = fopen(vstats_filename, "w");
+        if (!vstats_file) {
+            perror("fopen");
+            exit_program(1);
+        }
+    }
+
+    for (i = 0; i < of->ctx->nb_streams; i++) {
+        OutputStream *ost = output_streams[of->ost_index + i];
+
+        if (!ost->encoding_needed ||
+            (ost->enc_ctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+             ost->enc_ctx->codec_type != AVMEDIA_TYPE_AUDIO))
+            continue;
+
+        ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                            of->thread_queue_size, sizeof(AVFrame*));
+        if (ret < 0)
+            return ret;
+        av_thread_message_queue_set_free_func(ost->enc_thread_queue, free_frame_msg);
+
+        if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+            av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+            av_thread_message_queue_free(&ost->enc_thread_queue);
+            return AVERROR(ret);
+        }
+    }
+
+    return 0;
+}
+#endif
+
 static void flush_encoders(void)
 {
     int i, ret;
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream   *ost = output_streams[i];
-        AVCodecContext *enc = ost->enc_ctx;
         OutputFile      *of = output_files[ost->file_index];
 
         if (!ost->encoding_needed)
@@ -1903,69 +2406,15 @@ static void flush_encoders(void)
             }
         }
 
-        if (enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
-            continue;
-
-        if (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO)
+#if HAVE_THREADS
+        if (ost->enc_thread_queue) {
+            /* the encoding thread flushes the encoder when it receives NULL */
+            finish_encoder_thread(ost);
             continue;
-
-        for (;;) {
-            const char *desc = NULL;
-            AVPacket pkt;
-            int pkt_size;
-
-            switch (enc->codec_type) {
-            case AVMEDIA_TYPE_AUDIO:
-                desc   = "audio";
-                break;
-            case AVMEDIA_TYPE_VIDEO:
-                desc   = "video";
-                break;
-            default:
-                av_assert0(0);
-            }
-
-            av_init_packet(&pkt);
-            pkt.data = NULL;
-            pkt.size = 0;
-
-            update_benchmark(NULL);
-
-            while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
-                ret = avcodec_send_frame(enc, NULL);
-                if (ret < 0) {
-                    av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
-                           desc,
-                           av_err2str(ret));
-                    exit_program(1);
-                }
-            }
-
-            update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
-            if (ret < 0 && ret != AVERROR_EOF) {
-                av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
-                       desc,
-                       av_err2str(ret));
-                exit_program(1);
-            }
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
-            if (ret == AVERROR_EOF) {
-                output_packet(of, &pkt, ost, 1);
-                break;
-            }
-            if (ost->finished & MUXER_FINISHED) {
-                av_packet_unref(&pkt);
-                continue;
-            }
-            av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
-            pkt_size = pkt.size;
-            output_packet(of, &pkt, ost, 0);
-            if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                do_video_stats(ost, pkt_size);
-            }
         }
+#endif
+        if (flush_encoder(of, ost) < 0)
+            exit_program(1);
     }
 }
 
@@ -1980,7 +2429,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (atomic_load(&ost->finished))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -2001,15 +2450,16 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
 
     // EOF: flush output bitstream filters.
     if (!pkt) {
-        output_packet(of, &opkt, ost, 1);
+        if (output_packet(of, &opkt, ost, 1) < 0)
+            exit_program(1);
         return;
     }
 
-    if ((!ost->frame_number && !(pkt->flags & AV_PKT_FLAG_KEY)) &&
+    if ((!atomic_load(&ost->frame_number) && !(pkt->flags & AV_PKT_FLAG_KEY)) &&
         !ost->copy_initial_nonkeyframes)
         return;
 
-    if (!ost->frame_number && !ost->copy_prior_start) {
+    if (!atomic_load(&ost->frame_number) && !ost->copy_prior_start) {
         int64_t comp_start = start_time;
         if (copy_ts && f->start_time != AV_NOPTS_VALUE)
             comp_start = FFMAX(start_time, f->start_time + f->ts_offset);
@@ -2073,7 +2523,8 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
 
     av_copy_packet_side_data(&opkt, pkt);
 
-    output_packet(of, &opkt, ost, 0);
+    if (output_packet(of, &opkt, ost, 0) < 0)
+        exit_program(1);
 }
 
 int guess_input_channel_layout(InputStream *ist)
@@ -2285,6 +2736,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     AVFrame *decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
     int ret, err = 0;
+    int64_t start;
     AVRational decoded_frame_tb;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = av_frame_alloc()))
@@ -2294,7 +2746,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     decoded_frame = ist->decoded_frame;
 
     update_benchmark(NULL);
+    start = stage_start();
     ret = decode(avctx, decoded_frame, got_output, pkt);
+    stage_end(&ist->decode_time, start);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2348,6 +2802,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     int i, ret = 0, err = 0;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
+    int64_t start;
     AVPacket avpkt;
 
     // With fate-indeo3-2, we're getting 0-sized packets before EOF for some
@@ -2379,7 +2834,9 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+    start = stage_start();
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
+    stage_end(&ist->decode_time, start);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -3007,10 +3464,19 @@ static int check_init_output_file(OutputFile *of, int file_index)
         while (av_fifo_size(ost->muxing_queue)) {
             AVPacket pkt;
             av_fifo_generic_read(ost->muxing_queue, &pkt, sizeof(pkt), NULL);
-            write_packet(of, &pkt, ost, 1);
+            if (write_packet(of, &pkt, ost, 1) < 0)
+                exit_program(1);
         }
     }
 
+#if HAVE_THREADS
+    if (output_threads) {
+        ret = init_output_threads(of);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     return 0;
 }
 
@@ -3528,6 +3994,17 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
             av_buffersink_set_frame_size(ost->filter->filter,
                                             ost->enc_ctx->frame_size);
         assert_avoptions(ost->encoder_opts);
+        if (ost->dup_packets) {
+            const AVCodecDescriptor *desc = avcodec_descriptor_get(ost->enc_ctx->codec_id);
+            if (!desc || !(desc->props & AV_CODEC_PROP_INTRA_ONLY) ||
+                (ost->enc->capabilities & AV_CODEC_CAP_DELAY) ||
+                (ost->enc_ctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2))) {
+                av_log(NULL, AV_LOG_WARNING, "Output stream #%d:%d: -dup_packets "
+                       "needs an intra-only encoder without delay or two-pass "
+                       "encoding, ignoring it\n", ost->file_index, ost->index);
+                ost->dup_packets = 0;
+            }
+        }
         if (ost->enc_ctx->bit_rate && ost->enc_ctx->bit_rate < 1000 &&
             ost->enc_ctx->codec_id != AV_CODEC_ID_CODEC2 /* don't complain about 700 bit/s modes */)
             av_log(NULL, AV_LOG_WARNING, "The bitrate parameter is set too low."
@@ -3842,10 +4319,10 @@ static int need_output(void)
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (atomic_load(&ost->finished) ||
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+        if (atomic_load(&ost->frame_number) >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3877,12 +4354,12 @@ static OutputStream *choose_output(void)
         if (ost->st->cur_dts == AV_NOPTS_VALUE)
             av_log(NULL, AV_LOG_DEBUG,
                 "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
-                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, ost->finished);
+                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, atomic_load(&ost->finished));
 
         if (!ost->initialized && !ost->inputs_done)
             return ost;
 
-        if (!ost->finished && opts < opts_min) {
+        if (!atomic_load(&ost->finished) && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost->unavailable ? NULL : ost;
         }
@@ -4019,16 +4496,53 @@ static int check_keyboard_interaction(int64_t cur_time)
     return 0;
 }
 
+/* read a packet, accounting the time spent to the stream it belongs to */
+static int read_frame(InputFile *f, AVPacket *pkt)
+{
+    int64_t start = stage_start();
+    int ret = av_read_frame(f->ctx, pkt);
+
+    if (ret >= 0 && pkt->stream_index < f->nb_streams)
+        stage_end(&input_streams[f->ist_index + pkt->stream_index]->demux_time, start);
+    return ret;
+}
+
 #if HAVE_THREADS
+/*
+ * Double the size of the packet queue of an input file if the packets in it
+ * stay within the byte budget. Only called from the input thread.
+ */
+static int grow_input_queue(InputFile *f)
+{
+    int ret;
+
+    if (atomic_load(&f->queue_bytes) > f->thread_queue_bytes ||
+        f->thread_queue_size > INT_MAX / 2)
+        return AVERROR(ENOSPC);
+
+    ret = av_thread_message_queue_grow(f->in_thread_queue, f->thread_queue_size);
+    if (ret < 0)
+        return ret;
+    f->thread_queue_size *= 2;
+
+    av_log(f->ctx, AV_LOG_VERBOSE, "Thread message queue full, growing it to "
+           "%d packets\n", f->thread_queue_size);
+    return 0;
+}
+
 static void *input_thread(void *arg)
 {
     InputFile *f = arg;
     unsigned flags = f->non_blocking ? AV_THREAD_MESSAGE_NONBLOCK : 0;
+    int queue_size = f->thread_queue_size;
     int ret = 0;
 
     while (1) {
         AVPacket pkt;
-        ret = av_read_frame(f->ctx, &pkt);
+        int nb_queued;
+        int64_t queued_bytes, max_bytes, start;
+
+        ret = read_frame(f, &pkt);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -4038,15 +4552,41 @@ static void *input_thread(void *arg)
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
+
+        start = stage_start();
+        /* once the queue has grown, keep the packets it holds within the
+         * byte budget on every send, it does not shrink back by itself */
+        while (f->thread_queue_size > queue_size &&
+               av_thread_message_queue_nb_elems(f->in_thread_queue) >= queue_size &&
+               atomic_load(&f->queue_bytes) + pkt.size > f->thread_queue_bytes)
+            av_usleep(1000);
+
+        /* account for the packet before the main thread can dequeue it */
+        queued_bytes = atomic_fetch_add(&f->queue_bytes, pkt.size) + pkt.size;
+
         ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
+        if (flags && ret == AVERROR(EAGAIN) && grow_input_queue(f) >= 0)
+            ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
             ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
             av_log(f->ctx, AV_LOG_WARNING,
                    "Thread message queue blocking; consider raising the "
-                   "thread_queue_size option (current value: %d)\n",
-                   f->thread_queue_size);
+                   "thread_queue_size (current value: %d) or "
+                   "thread_queue_bytes (current value: %"PRId64") option\n",
+                   f->thread_queue_size, f->thread_queue_bytes);
         }
+        stage_end(&f->queue_send_wait, start);
+        if (ret < 0)
+            atomic_fetch_sub(&f->queue_bytes, pkt.size);
+
+        nb_queued = av_thread_message_queue_nb_elems(f->in_thread_queue);
+        if (nb_queued > atomic_load(&f->queue_max_packets))
+            atomic_store(&f->queue_max_packets, nb_queued);
+        max_bytes = atomic_load(&f->queue_max_bytes);
+        if (ret >= 0 && queued_bytes > max_bytes)
+            atomic_store(&f->queue_max_bytes, queued_bytes);
+
         if (ret < 0) {
             if (ret != AVERROR_EOF)
                 av_log(f->ctx, AV_LOG_ERROR,
@@ -4100,6 +4640,7 @@ static int init_input_thread(int i)
                                         f->thread_queue_size, sizeof(AVPacket));
     if (ret < 0)
         return ret;
+    atomic_init(&f->queue_bytes, 0);
 
     if ((ret = pthread_create(&f->thread, NULL, input_thread, f))) {
         av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
@@ -4124,9 +4665,12 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 {
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    int ret = av_thread_message_queue_recv(f->in_thread_queue, pkt,
+                                           f->non_blocking ?
+                                           AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret >= 0)
+        atomic_fetch_sub(&f->queue_bytes, pkt->size);
+    return ret;
 }
 #endif
 
@@ -4147,7 +4691,7 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     if (nb_input_files > 1)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    return read_frame(f, pkt);
 }
 
 static int got_eagain(void)
@@ -4648,6 +5192,141 @@ static int transcode_step(void)
     return reap_filters(0);
 }
 
+static void print_json_string(AVIOContext *pb, const char *str)
+{
+    avio_w8(pb, '"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            avio_printf(pb, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            avio_printf(pb, "\\u%04x", *str);
+        else
+            avio_w8(pb, *str);
+    }
+    avio_w8(pb, '"');
+}
+
+static const char *json_media_type(enum AVMediaType type)
+{
+    const char *str = av_get_media_type_string(type);
+    return str ? str : "unknown";
+}
+
+/*
+ * Write the time spent in each stage of the processing for -benchmark_json.
+ * All times are wall-clock times in microseconds; the times of the stages
+ * run by different threads overlap.
+ */
+static void write_benchmark_json(int64_t timer_start)
+{
+    AVIOContext *pb = NULL;
+    int i, j, ret;
+
+    ret = avio_open2(&pb, benchmark_json, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open benchmark file '%s': %s\n",
+               benchmark_json, av_err2str(ret));
+        return;
+    }
+
+    avio_printf(pb, "{\n  \"real_us\": %"PRId64",\n  \"inputs\": [",
+                av_gettime_relative() - timer_start);
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+
+        avio_printf(pb, "%s\n    {\n      \"url\": ", i ? "," : "");
+        print_json_string(pb, f->ctx->url);
+#if HAVE_THREADS
+        if (nb_input_files > 1)
+            avio_printf(pb, ",\n      \"queue\": { \"max_packets\": %d, "
+                        "\"max_bytes\": %"PRId64", \"send_wait_us\": %"PRId64" }",
+                        atomic_load(&f->queue_max_packets),
+                        (int64_t)atomic_load(&f->queue_max_bytes),
+                        f->queue_send_wait);
+#endif
+        avio_printf(pb, ",\n      \"streams\": [");
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+
+            avio_printf(pb, "%s\n        { \"index\": %d, \"type\": \"%s\", "
+                        "\"codec\": \"%s\", \"packets\": %"PRIu64", "
+                        "\"frames\": %"PRIu64", \"demux_us\": %"PRId64", "
+                        "\"decode_us\": %"PRId64" }",
+                        j ? "," : "", j,
+                        json_media_type(ist->st->codecpar->codec_type),
+                        avcodec_get_name(ist->st->codecpar->codec_id),
+                        ist->nb_packets, ist->frames_decoded,
+                        ist->demux_time, ist->decode_time);
+        }
+        avio_printf(pb, "\n      ]\n    }");
+    }
+
+    avio_printf(pb, "\n  ],\n  \"filtergraphs\": [");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+
+        avio_printf(pb, "%s\n    {\n      \"index\": %d,\n      \"filters\": [",
+                    i ? "," : "", i);
+        for (j = 0; graph && j < graph->nb_filters; j++) {
+            AVFilterContext *filter = graph->filters[j];
+
+            avio_printf(pb, "%s\n        { \"name\": ", j ? "," : "");
+            print_json_string(pb, filter->name);
+            avio_printf(pb, ", \"filter\": \"%s\", \"exec_us\": %"PRId64" }",
+                        filter->filter->name, filter->exec_time);
+        }
+        avio_printf(pb, "\n      ]\n    }");
+    }
+
+    avio_printf(pb, "\n  ],\n  \"outputs\": [");
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        avio_printf(pb, "%s\n    {\n      \"url\": ", i ? "," : "");
+        print_json_string(pb, of->ctx->url);
+#if HAVE_THREADS
+        if (output_threads)
+            avio_printf(pb, ",\n      \"mux_queue\": { \"recv_wait_us\": %"PRId64" }",
+                        of->mux_queue_recv_wait);
+#endif
+        avio_printf(pb, ",\n      \"streams\": [");
+        for (j = 0; j < of->ctx->nb_streams; j++) {
+            OutputStream *ost = output_streams[of->ost_index + j];
+
+            avio_printf(pb, "%s\n        { \"index\": %d, \"type\": \"%s\", "
+                        "\"codec\": \"%s\", \"packets\": %"PRIu64", "
+                        "\"frames\": %"PRIu64", \"encode_us\": %"PRId64", "
+                        "\"mux_us\": %"PRId64,
+                        j ? "," : "", j,
+                        json_media_type(ost->st->codecpar->codec_type),
+                        avcodec_get_name(ost->st->codecpar->codec_id),
+                        atomic_load(&ost->packets_written), ost->frames_encoded,
+                        ost->encode_time, ost->mux_time);
+#if HAVE_THREADS
+            if (output_threads && ost->encoding_needed &&
+                (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO ||
+                 ost->enc_ctx->codec_type == AVMEDIA_TYPE_AUDIO))
+                avio_printf(pb, ", \"encode_queue\": { \"max_frames\": %d, "
+                            "\"send_wait_us\": %"PRId64", \"recv_wait_us\": %"PRId64" }",
+                            ost->enc_queue_max, ost->enc_queue_send_wait,
+                            ost->enc_queue_recv_wait);
+            if (output_threads)
+                avio_printf(pb, ", \"mux_queue\": { \"max_packets\": %d, "
+                            "\"send_wait_us\": %"PRId64" }",
+                            ost->mux_queue_max, ost->mux_queue_send_wait);
+#endif
+            avio_printf(pb, " }");
+        }
+        avio_printf(pb, "\n      ]\n    }");
+    }
+    avio_printf(pb, "\n  ]\n}\n");
+
+    ret = avio_closep(&pb);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Error closing benchmark file '%s': %s\n",
+               benchmark_json, av_err2str(ret));
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -4710,6 +5389,9 @@ static int transcode(void)
         }
     }
     flush_encoders();
+#if HAVE_THREADS
+    free_output_threads();
+#endif
 
     term_exit();
 
@@ -4733,13 +5415,16 @@ static int transcode(void)
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
 
+    if (benchmark_json)
+        write_benchmark_json(timer_start);
+
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
         ost = output_streams[i];
         if (ost->encoding_needed) {
             av_freep(&ost->enc_ctx->stats_in);
         }
-        total_packets_written += ost->packets_written;
+        total_packets_written += atomic_load(&ost->packets_written);
     }
 
     if (!total_packets_written && (abort_on_flags & ABORT_ON_FLAG_EMPTY_OUTPUT)) {
@@ -4908,6 +5593,6 @@ int main(int argc, char **argv)
     if ((decode_error_stat[0] + decode_error_stat[1]) * max_error_rate < decode_error_stat[1])
         exit_program(69);
 
-    exit_program(received_nb_signals ? 255 : main_return_code);
-    return main_return_code;
+    exit_program(received_nb_signals ? 255 : atomic_load(&main_return_code));
+    return atomic_load(&main_return_code);
 }
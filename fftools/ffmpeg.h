@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -120,6 +121,7 @@ typedef struct OptionsContext {
     int rate_emu;
     int accurate_seek;
     int thread_queue_size;
+    int64_t thread_queue_bytes;
 
     SpecifierOpt *ts_scale;
     int        nb_ts_scale;
@@ -180,6 +182,8 @@ typedef struct OptionsContext {
     int        nb_forced_key_frames;
     SpecifierOpt *force_fps;
     int        nb_force_fps;
+    SpecifierOpt *dup_packets;
+    int        nb_dup_packets;
     SpecifierOpt *frame_aspect_ratios;
     int        nb_frame_aspect_ratios;
     SpecifierOpt *rc_overrides;
@@ -383,6 +387,9 @@ typedef struct InputStream {
     // number of frames/samples retrieved from the decoder
     uint64_t frames_decoded;
     uint64_t samples_decoded;
+    // wall-clock time in microseconds spent demuxing/decoding, -benchmark_json only
+    int64_t demux_time;
+    int64_t decode_time;
 
     int64_t *dts_buffer;
     int nb_dts_buffer;
@@ -417,7 +424,12 @@ typedef struct InputFile {
     pthread_t thread;           /* thread reading from this file */
     int non_blocking;           /* reading packets from the thread should not block */
     int joined;                 /* the thread has been joined */
-    int thread_queue_size;      /* maximum number of queued packets */
+    int thread_queue_size;      /* number of packets the queue can hold, grows up to the budget */
+    int64_t thread_queue_bytes; /* size of the queued packets up to which the queue may grow */
+    atomic_int_least64_t queue_bytes;      /* size of the packets currently queued */
+    atomic_int           queue_max_packets; /* high-water marks of the queue */
+    atomic_int_least64_t queue_max_bytes;
+    int64_t queue_send_wait;    /* time the thread was blocked on the full queue, -benchmark_json only */
 #endif
 } InputFile;
 
@@ -439,13 +451,21 @@ typedef enum {
     MUXER_FINISHED = 2,
 } OSTFinished ;
 
+typedef struct BenchmarkTimeStamps {
+    int64_t real_usec;
+    int64_t user_usec;
+    int64_t sys_usec;
+} BenchmarkTimeStamps;
+
 typedef struct OutputStream {
     int file_index;          /* file index */
     int index;               /* stream index in the output file */
     int source_index;        /* InputStream index */
     AVStream *st;            /* stream in the output file */
     int encoding_needed;     /* true if encoding needed for this stream */
-    int frame_number;
+    /* The fields marked as shared below are updated by the encoding thread of
+     * the stream with -output_threads, while the main thread reads them. */
+    atomic_int frame_number; /* shared */
     /* input pts and corresponding output pts
        for A/V sync */
     struct InputStream *sync_ist; /* input stream to sync against */
@@ -477,6 +497,9 @@ typedef struct OutputStream {
     AVRational frame_rate;
     int is_cfr;
     int force_fps;
+    int dup_packets;            /* repeat the packet of duplicated frames instead of encoding them */
+    AVBufferRef *dup_buf;       /* first buffer of the frame dup_pkt was encoded from */
+    AVPacket dup_pkt;           /* packet of the last frame, in the encoder time base */
     int top_field_first;
     int rotate_overridden;
     double rotate_override_value;
@@ -509,7 +532,7 @@ typedef struct OutputStream {
     AVDictionary *swr_opts;
     AVDictionary *resample_opts;
     char *apad;
-    OSTFinished finished;        /* no more packets should be written for this stream */
+    atomic_int finished;         /* OSTFinished flags, no more packets should be written for this stream, shared */
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
 
@@ -528,27 +551,44 @@ typedef struct OutputStream {
     int keep_pix_fmt;
 
     /* stats */
-    // combined size of all the packets written
-    uint64_t data_size;
-    // number of packets send to the muxer
-    uint64_t packets_written;
+    // combined size of all the packets written, shared
+    atomic_uint_least64_t data_size;
+    // number of packets send to the muxer, shared
+    atomic_uint_least64_t packets_written;
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
     uint64_t samples_encoded;
+    // wall-clock time in microseconds spent encoding/muxing, -benchmark_json only
+    int64_t encode_time;
+    int64_t mux_time;
 
-    /* packet quality factor */
-    int quality;
+    /* packet quality factor, shared */
+    atomic_int quality;
 
     int max_muxing_queue_size;
 
     /* the packets are buffered here until the muxer is ready to be initialized */
     AVFifoBuffer *muxing_queue;
 
-    /* packet picture type */
-    int pict_type;
+    /* packet picture type, shared */
+    atomic_int pict_type;
 
-    /* frame encode sum of squared error values */
-    int64_t error[4];
+    /* frame encode sum of squared error values, shared */
+    atomic_int_least64_t error[4];
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *enc_thread_queue;
+    pthread_t enc_thread;       /* thread running the encoder of this stream */
+    BenchmarkTimeStamps enc_thread_bench; /* -benchmark_all time stamps of the thread */
+    int enc_thread_ret;         /* error which stopped the thread, read after joining it */
+
+    /* queue statistics, -benchmark_json only */
+    int     enc_queue_max;       /* largest number of frames queued for encoding */
+    int64_t enc_queue_send_wait; /* time the sender was blocked on the full queue */
+    int64_t enc_queue_recv_wait; /* time the encoding thread waited for frames */
+    int     mux_queue_max;       /* same for the muxing queue, as seen when sending */
+    int64_t mux_queue_send_wait; /* the packets of this stream */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -562,6 +602,14 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *mux_thread_queue;
+    pthread_t mux_thread;       /* thread writing packets to this file */
+    int thread_queue_size;      /* maximum number of queued frames/packets */
+    atomic_int_least64_t mux_size; /* bytes written so far by the muxing thread */
+    int64_t mux_queue_recv_wait;   /* time the muxing thread waited for packets, -benchmark_json only */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -578,6 +626,7 @@ extern FilterGraph **filtergraphs;
 extern int        nb_filtergraphs;
 
 extern char *vstats_filename;
+extern char *benchmark_json;
 extern char *sdp_filename;
 
 extern float audio_drift_threshold;
@@ -607,8 +656,11 @@ extern AVIOContext *progress_avio;
 extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
+extern int output_threads;
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_graph_nbthreads;
+extern int filter_pool_frames;
 extern int vstats_version;
 
 extern const AVIOInterruptCB int_cb;
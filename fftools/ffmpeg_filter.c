@@ -1013,6 +1013,10 @@ int configure_filtergraph(FilterGraph *fg)
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
 
+    av_opt_set_int(fg->graph, "graph_threads", filter_graph_nbthreads, 0);
+    av_opt_set_int(fg->graph, "max_pool_frames", filter_pool_frames, 0);
+    av_opt_set_int(fg->graph, "profile", !!benchmark_json, 0);
+
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
         char args[512];
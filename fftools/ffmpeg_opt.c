@@ -82,6 +82,7 @@ HWDevice *filter_hw_device;
 
 char *vstats_filename;
 char *sdp_filename;
+char *benchmark_json;
 
 float audio_drift_threshold = 0.1;
 float dts_delta_threshold   = 10;
@@ -107,8 +108,11 @@ int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
+int output_threads = 0;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
+int filter_graph_nbthreads = 0;
+int filter_pool_frames = -1;
 int vstats_version = 2;
 
 
@@ -166,6 +170,7 @@ static void init_options(OptionsContext *o)
     o->limit_filesize = UINT64_MAX;
     o->chapters_input_file = INT_MAX;
     o->accurate_seek  = 1;
+    o->thread_queue_bytes = 64 << 20;
 }
 
 static int show_hwaccels(void *optctx, const char *opt, const char *arg)
@@ -1211,7 +1216,11 @@ static int open_input_file(OptionsContext *o, const char *filename)
     f->duration = 0;
     f->time_base = (AVRational){ 1, 1 };
 #if HAVE_THREADS
-    f->thread_queue_size = o->thread_queue_size > 0 ? o->thread_queue_size : 8;
+    f->thread_queue_size  = o->thread_queue_size > 0 ? o->thread_queue_size : 8;
+    f->thread_queue_bytes = o->thread_queue_bytes;
+    atomic_init(&f->queue_bytes,       0);
+    atomic_init(&f->queue_max_packets, 0);
+    atomic_init(&f->queue_max_bytes,   0);
 #endif
 
     /* check if all codec options have been used */
@@ -1831,6 +1840,7 @@ static OutputStream *new_video_stream(OptionsContext *o, AVFormatContext *oc, in
             ost->forced_keyframes = av_strdup(ost->forced_keyframes);
 
         MATCH_PER_STREAM_OPT(force_fps, i, ost->force_fps, oc, st);
+        MATCH_PER_STREAM_OPT(dup_packets, i, ost->dup_packets, oc, st);
 
         ost->top_field_first = -1;
         MATCH_PER_STREAM_OPT(top_field_first, i, ost->top_field_first, oc, st);
@@ -1954,7 +1964,7 @@ static OutputStream *new_attachment_stream(OptionsContext *o, AVFormatContext *o
 {
     OutputStream *ost = new_output_stream(o, oc, AVMEDIA_TYPE_ATTACHMENT, source_index);
     ost->stream_copy = 1;
-    ost->finished    = 1;
+    atomic_store(&ost->finished, 1);
     return ost;
 }
 
@@ -2142,6 +2152,9 @@ static int open_output_file(OptionsContext *o, const char *filename)
     of->start_time     = o->start_time;
     of->limit_filesize = o->limit_filesize;
     of->shortest       = o->shortest;
+#if HAVE_THREADS
+    of->thread_queue_size = o->thread_queue_size > 0 ? o->thread_queue_size : 8;
+#endif
     av_dict_copy(&of->opts, o->g->format_opts, 0);
 
     if (!strcmp(filename, "-"))
@@ -3436,6 +3449,8 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "benchmark_json", HAS_ARG | OPT_STRING | OPT_EXPERT,           { &benchmark_json },
+      "write the time spent in each processing stage as JSON", "url" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
@@ -3513,6 +3528,10 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_graph_threads", HAS_ARG | OPT_INT,                     { &filter_graph_nbthreads },
+        "maximum number of filters activated in parallel in each filtergraph" },
+    { "filter_pool_frames", HAS_ARG | OPT_INT | OPT_EXPERT,          { &filter_pool_frames },
+        "maximum number of unused frames kept for reuse by each filter link", "count" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
@@ -3537,9 +3556,14 @@ const OptionDef options[] = {
     { "disposition",    OPT_STRING | HAS_ARG | OPT_SPEC |
                         OPT_OUTPUT,                                  { .off = OFFSET(disposition) },
         "disposition", "" },
-    { "thread_queue_size", HAS_ARG | OPT_INT | OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+    { "thread_queue_size", HAS_ARG | OPT_INT | OPT_OFFSET | OPT_EXPERT | OPT_INPUT | OPT_OUTPUT,
                                                                      { .off = OFFSET(thread_queue_size) },
-        "set the maximum number of queued packets from the demuxer" },
+        "set the maximum number of queued packets from the demuxer or to the encoders and muxer" },
+    { "thread_queue_bytes", HAS_ARG | OPT_INT64 | OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+                                                                     { .off = OFFSET(thread_queue_bytes) },
+        "set the size of the queued packets up to which the queue from the demuxer may grow", "bytes" },
+    { "output_threads", OPT_BOOL | OPT_EXPERT,                       { &output_threads },
+        "run the encoders and muxer of each output file in dedicated threads" },
     { "find_stream_info", OPT_BOOL | OPT_PERFILE | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
 
@@ -3613,6 +3637,9 @@ const OptionDef options[] = {
     { "force_fps",    OPT_VIDEO | OPT_BOOL | OPT_EXPERT  | OPT_SPEC |
                       OPT_OUTPUT,                                                { .off = OFFSET(force_fps) },
         "force the selected framerate, disable the best supported framerate selection" },
+    { "dup_packets",  OPT_VIDEO | OPT_BOOL | OPT_EXPERT  | OPT_SPEC |
+                      OPT_OUTPUT,                                                { .off = OFFSET(dup_packets) },
+        "repeat the packet of duplicated frames instead of encoding them again (intra-only encoders)" },
     { "streamid",     OPT_VIDEO | HAS_ARG | OPT_EXPERT | OPT_PERFILE |
                       OPT_OUTPUT,                                                { .func_arg = opt_streamid },
         "set the value of an outfile streamid", "streamIndex:value" },
@@ -3370,6 +3370,17 @@ typedef struct AVCodecContext {
      * - encoding: unused
      */
     int discard_damaged_percentage;
+
+    /**
+     * Priority of the slice threading jobs and of the frame threading work
+     * of this context on the thread pool shared by the whole process, see
+     * av_cpu_set_shared_threads(). Higher values are served first. Has no
+     * effect when the pool is not used.
+     *
+     * - encoding: Set by user before avcodec_open2().
+     * - decoding: Set by user before avcodec_open2().
+     */
+    int thread_priority;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -68,6 +68,11 @@
  * Codec initializes slice-based threading with a main function
  */
 #define FF_CODEC_CAP_SLICE_THREAD_HAS_MF    (1 << 5)
+/**
+ * The jobs of a slice threaded execution wait for each other, so they must
+ * all run at the same time, and cannot use the shared thread pool.
+ */
+#define FF_CODEC_CAP_SLICE_THREAD_SYNC_JOBS (1 << 6)
 
 #ifdef TRACE
 #   define ff_tlog(ctx, ...) av_log(ctx, AV_LOG_TRACE, __VA_ARGS__)
@@ -1139,6 +1139,23 @@ static int get_intra_count(MpegEncContext *s, uint8_t *src,
     return acc;
 }
 
+/**
+ * Score the input picture arg points to against the one before it for
+ * b_strategy 1. The pictures are scored independently of each other, on
+ * the encoder threads.
+ */
+static int b_frame_score_thread(AVCodecContext *avctx, void *arg)
+{
+    MpegEncContext *s = avctx->priv_data;
+    Picture **pic = arg;
+
+    if (pic[0] && pic[0]->b_frame_score == 0)
+        pic[0]->b_frame_score = get_intra_count(s, pic[ 0]->f->data[0],
+                                                   pic[-1]->f->data[0],
+                                                   s->linesize) + 1;
+    return 0;
+}
+
 static int alloc_picture(MpegEncContext *s, Picture *pic, int shared)
 {
     return ff_alloc_picture(s->avctx, pic, &s->me, &s->sc, shared, 1,
@@ -1363,16 +1380,112 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return size;
 }
 
+typedef struct BCountTrial {
+    MpegEncContext *s;
+    int b_count;
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;
+} BCountTrial;
+
+/**
+ * Encode the downscaled input pictures with b_count B-frames between the
+ * P-frames and store the resulting rate-distortion cost in the trial.
+ * The trials of one call of estimate_best_b_count() are independent of each
+ * other and are run in parallel on the encoder threads.
+ */
+static int estimate_b_count_rd(AVCodecContext *avctx, void *arg)
+{
+    BCountTrial *t = arg;
+    MpegEncContext *s = t->s;
+    const AVCodec *codec = avcodec_find_encoder(avctx->codec_id);
+    const int lambda2 = t->lambda2;
+    const int j = t->b_count;
+    AVCodecContext *c;
+    AVFrame *frame = NULL;
+    int i, out_size, ret;
+    int64_t rd = 0;
+
+    c = avcodec_alloc_context3(NULL);
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    c->width        = s->width  >> s->brd_scale;
+    c->height       = s->height >> s->brd_scale;
+    c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
+    c->flags       |= avctx->flags & AV_CODEC_FLAG_QPEL;
+    c->mb_decision  = avctx->mb_decision;
+    c->me_cmp       = avctx->me_cmp;
+    c->mb_cmp       = avctx->mb_cmp;
+    c->me_sub_cmp   = avctx->me_sub_cmp;
+    c->pix_fmt      = AV_PIX_FMT_YUV420P;
+    c->time_base    = avctx->time_base;
+    c->max_b_frames = s->max_b_frames;
+
+    ret = avcodec_open2(c, codec, NULL);
+    if (ret < 0)
+        goto fail;
+
+    /* the trials share the downscaled pictures, so each one sets the
+     * picture types on its own references to them */
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = 0; i < s->max_b_frames + 2; i++) {
+        int is_p = i && ((i - 1) % (j + 1) == j || i - 1 == s->max_b_frames);
+
+        ret = av_frame_ref(frame, s->tmp_frames[i]);
+        if (ret < 0)
+            goto fail;
+        frame->pict_type = !i ? AV_PICTURE_TYPE_I :
+                           is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+        frame->quality   = !i ? 1 * FF_QP2LAMBDA :
+                           is_p ? t->p_lambda : t->b_lambda;
+
+        out_size = encode_frame(c, frame);
+        av_frame_unref(frame);
+        if (out_size < 0) {
+            ret = out_size;
+            goto fail;
+        }
+
+        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+        if (i)
+            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    out_size = encode_frame(c, NULL);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+    rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    t->rd = rd;
+    ret   = 0;
+
+fail:
+    av_frame_free(&frame);
+    avcodec_free_context(&c);
+    return ret;
+}
+
 static int estimate_best_b_count(MpegEncContext *s)
 {
-    const AVCodec *codec = avcodec_find_encoder(s->avctx->codec_id);
     const int scale = s->brd_scale;
     int width  = s->width  >> scale;
     int height = s->height >> scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
+    int i, j, p_lambda, b_lambda, lambda2;
     int64_t best_rd  = INT64_MAX;
     int best_b_count = -1;
-    int ret = 0;
+    BCountTrial trials[MAX_B_FRAMES + 1];
+    int rets[MAX_B_FRAMES + 1];
+    int nb_trials;
 
     av_assert0(scale >= 0 && scale <= 3);
 
@@ -1419,79 +1532,32 @@ static int estimate_best_b_count(MpegEncContext *s)
         }
     }
 
-    for (j = 0; j < s->max_b_frames + 1; j++) {
-        AVCodecContext *c;
-        int64_t rd = 0;
+    for (nb_trials = 0; nb_trials < s->max_b_frames + 1; nb_trials++) {
+        BCountTrial *t = &trials[nb_trials];
 
-        if (!s->input_picture[j])
+        if (!s->input_picture[nb_trials])
             break;
 
-        c = avcodec_alloc_context3(NULL);
-        if (!c)
-            return AVERROR(ENOMEM);
-
-        c->width        = width;
-        c->height       = height;
-        c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
-        c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
-        c->mb_decision  = s->avctx->mb_decision;
-        c->me_cmp       = s->avctx->me_cmp;
-        c->mb_cmp       = s->avctx->mb_cmp;
-        c->me_sub_cmp   = s->avctx->me_sub_cmp;
-        c->pix_fmt      = AV_PIX_FMT_YUV420P;
-        c->time_base    = s->avctx->time_base;
-        c->max_b_frames = s->max_b_frames;
-
-        ret = avcodec_open2(c, codec, NULL);
-        if (ret < 0)
-            goto fail;
-
-        s->tmp_frames[0]->pict_type = AV_PICTURE_TYPE_I;
-        s->tmp_frames[0]->quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, s->tmp_frames[0]);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
-
-            s->tmp_frames[i + 1]->pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            s->tmp_frames[i + 1]->quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, s->tmp_frames[i + 1]);
-            if (out_size < 0) {
-                ret = out_size;
-                goto fail;
-            }
-
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
+        t->s        = s;
+        t->b_count  = nb_trials;
+        t->p_lambda = p_lambda;
+        t->b_lambda = b_lambda;
+        t->lambda2  = lambda2;
+        t->rd       = INT64_MAX;
+    }
 
-        /* get the delayed frames */
-        out_size = encode_frame(c, NULL);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-        rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    emms_c();
+    s->avctx->execute(s->avctx, estimate_b_count_rd, trials, rets,
+                      nb_trials, sizeof(*trials));
 
-        rd += c->error[0] + c->error[1] + c->error[2];
+    for (j = 0; j < nb_trials; j++) {
+        if (rets[j] < 0)
+            return rets[j];
 
-        if (rd < best_rd) {
-            best_rd = rd;
+        if (trials[j].rd < best_rd) {
+            best_rd = trials[j].rd;
             best_b_count = j;
         }
-
-fail:
-        avcodec_free_context(&c);
-        if (ret < 0)
-            return ret;
     }
 
     return best_b_count;
@@ -1550,16 +1616,9 @@ static int select_input_picture(MpegEncContext *s)
                 while (b_frames && !s->input_picture[b_frames])
                     b_frames--;
             } else if (s->b_frame_strategy == 1) {
-                for (i = 1; i < s->max_b_frames + 1; i++) {
-                    if (s->input_picture[i] &&
-                        s->input_picture[i]->b_frame_score == 0) {
-                        s->input_picture[i]->b_frame_score =
-                            get_intra_count(s,
-                                            s->input_picture[i    ]->f->data[0],
-                                            s->input_picture[i - 1]->f->data[0],
-                                            s->linesize) + 1;
-                    }
-                }
+                s->avctx->execute(s->avctx, b_frame_score_thread,
+                                  &s->input_picture[1], NULL,
+                                  s->max_b_frames, sizeof(*s->input_picture));
                 for (i = 0; i < s->max_b_frames + 1; i++) {
                     if (!s->input_picture[i] ||
                         s->input_picture[i]->b_frame_score - 1 >
@@ -43,6 +43,7 @@
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/thread.h"
 
 enum {
@@ -72,6 +73,7 @@ typedef struct PerThreadContext {
 
     pthread_t      thread;
     int            thread_init;
+    AVSliceThread *task;            ///< Runs the decoding on the shared thread pool, used instead of thread.
     pthread_cond_t input_cond;      ///< Used to wait for a new packet from the main thread.
     pthread_cond_t progress_cond;   ///< Used by child threads to wait for progress to change.
     pthread_cond_t output_cond;     ///< Used by the main thread to wait for frames to finish.
@@ -159,81 +161,102 @@ static void async_unlock(FrameThreadContext *fctx)
 }
 
 /**
- * Codec worker thread.
+ * Decodes the packet submitted to a codec worker, called with p->mutex held.
  *
  * Automatically calls ff_thread_finish_setup() if the codec does
  * not provide an update_thread_context method, or if the codec returns
  * before calling it.
  */
-static attribute_align_arg void *frame_worker_thread(void *arg)
+static void frame_worker_decode(PerThreadContext *p)
 {
-    PerThreadContext *p = arg;
     AVCodecContext *avctx = p->avctx;
     const AVCodec *codec = avctx->codec;
 
-    pthread_mutex_lock(&p->mutex);
-    while (1) {
-        while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
-            pthread_cond_wait(&p->input_cond, &p->mutex);
+    if (!codec->update_thread_context && THREAD_SAFE_CALLBACKS(avctx))
+        ff_thread_finish_setup(avctx);
 
-        if (p->die) break;
+    /* If a decoder supports hwaccel, then it must call ff_get_format().
+     * Since that call must happen before ff_thread_finish_setup(), the
+     * decoder is required to implement update_thread_context() and call
+     * ff_thread_finish_setup() manually. Therefore the above
+     * ff_thread_finish_setup() call did not happen and hwaccel_serializing
+     * cannot be true here. */
+    av_assert0(!p->hwaccel_serializing);
+
+    /* if the previous thread uses hwaccel then we take the lock to ensure
+     * the threads don't run concurrently */
+    if (avctx->hwaccel) {
+        pthread_mutex_lock(&p->parent->hwaccel_mutex);
+        p->hwaccel_serializing = 1;
+    }
 
-        if (!codec->update_thread_context && THREAD_SAFE_CALLBACKS(avctx))
-            ff_thread_finish_setup(avctx);
-
-        /* If a decoder supports hwaccel, then it must call ff_get_format().
-         * Since that call must happen before ff_thread_finish_setup(), the
-         * decoder is required to implement update_thread_context() and call
-         * ff_thread_finish_setup() manually. Therefore the above
-         * ff_thread_finish_setup() call did not happen and hwaccel_serializing
-         * cannot be true here. */
-        av_assert0(!p->hwaccel_serializing);
-
-        /* if the previous thread uses hwaccel then we take the lock to ensure
-         * the threads don't run concurrently */
-        if (avctx->hwaccel) {
-            pthread_mutex_lock(&p->parent->hwaccel_mutex);
-            p->hwaccel_serializing = 1;
-        }
+    av_frame_unref(p->frame);
+    p->got_frame = 0;
+    p->result = codec->decode(avctx, p->frame, &p->got_frame, &p->avpkt);
 
+    if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
+        if (avctx->internal->allocate_progress)
+            av_log(avctx, AV_LOG_ERROR, "A frame threaded decoder did not "
+                   "free the frame on failure. This is a bug, please report it.\n");
         av_frame_unref(p->frame);
-        p->got_frame = 0;
-        p->result = codec->decode(avctx, p->frame, &p->got_frame, &p->avpkt);
+    }
 
-        if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
-            if (avctx->internal->allocate_progress)
-                av_log(avctx, AV_LOG_ERROR, "A frame threaded decoder did not "
-                       "free the frame on failure. This is a bug, please report it.\n");
-            av_frame_unref(p->frame);
-        }
+    if (atomic_load(&p->state) == STATE_SETTING_UP)
+        ff_thread_finish_setup(avctx);
 
-        if (atomic_load(&p->state) == STATE_SETTING_UP)
-            ff_thread_finish_setup(avctx);
+    if (p->hwaccel_serializing) {
+        p->hwaccel_serializing = 0;
+        pthread_mutex_unlock(&p->parent->hwaccel_mutex);
+    }
 
-        if (p->hwaccel_serializing) {
-            p->hwaccel_serializing = 0;
-            pthread_mutex_unlock(&p->parent->hwaccel_mutex);
-        }
+    if (p->async_serializing) {
+        p->async_serializing = 0;
 
-        if (p->async_serializing) {
-            p->async_serializing = 0;
+        async_unlock(p->parent);
+    }
 
-            async_unlock(p->parent);
-        }
+    pthread_mutex_lock(&p->progress_mutex);
 
-        pthread_mutex_lock(&p->progress_mutex);
+    atomic_store(&p->state, STATE_INPUT_READY);
 
-        atomic_store(&p->state, STATE_INPUT_READY);
+    pthread_cond_broadcast(&p->progress_cond);
+    pthread_cond_signal(&p->output_cond);
+    pthread_mutex_unlock(&p->progress_mutex);
+}
 
-        pthread_cond_broadcast(&p->progress_cond);
-        pthread_cond_signal(&p->output_cond);
-        pthread_mutex_unlock(&p->progress_mutex);
+/**
+ * Codec worker thread.
+ */
+static attribute_align_arg void *frame_worker_thread(void *arg)
+{
+    PerThreadContext *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    while (1) {
+        while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
+            pthread_cond_wait(&p->input_cond, &p->mutex);
+
+        if (p->die) break;
+
+        frame_worker_decode(p);
     }
     pthread_mutex_unlock(&p->mutex);
 
     return NULL;
 }
 
+/**
+ * Decodes one packet on a worker of the shared thread pool.
+ */
+static void frame_worker_task(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    PerThreadContext *p = priv;
+
+    pthread_mutex_lock(&p->mutex);
+    frame_worker_decode(p);
+    pthread_mutex_unlock(&p->mutex);
+}
+
 /**
  * Update the next thread's AVCodecContext with values from the reference thread's context.
  *
@@ -426,7 +449,10 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     }
 
     atomic_store(&p->state, STATE_SETTING_UP);
-    pthread_cond_signal(&p->input_cond);
+    if (p->task)
+        avpriv_slicethread_execute_async(p->task, 1);
+    else
+        pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
 
     /*
@@ -675,6 +701,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         if (p->thread_init)
             pthread_join(p->thread, NULL);
         p->thread_init=0;
+        avpriv_slicethread_free(&p->task);
 
         if (codec->close && p->avctx)
             codec->close(p->avctx);
@@ -825,6 +852,20 @@ int ff_frame_thread_init(AVCodecContext *avctx)
 
         atomic_init(&p->debug_threads, (copy->debug & FF_DEBUG_THREADS) != 0);
 
+        /* Without thread-safe callbacks, the decoding waits for the user
+         * thread to allocate its buffers, while the user thread may wait
+         * for earlier decodings, which could then never get a worker. */
+        if (THREAD_SAFE_CALLBACKS(avctx))
+            err = avpriv_slicethread_create_async(&p->task, p, frame_worker_task, 1);
+        else
+            err = AVERROR(ENOSYS);
+        if (err >= 0) {
+            avpriv_slicethread_set_priority(p->task, avctx->thread_priority);
+            err = 0;
+            continue;
+        } else if (err != AVERROR(ENOSYS))
+            goto error;
+
         err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
         p->thread_init= !err;
         if(!p->thread_init)
@@ -156,7 +156,15 @@ int ff_slice_thread_init(AVCodecContext *avctx)
 
     avctx->internal->thread_ctx = c = av_mallocz(sizeof(*c));
     mainfunc = avctx->codec->caps_internal & FF_CODEC_CAP_SLICE_THREAD_HAS_MF ? &main_function : NULL;
-    if (!c || (thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count)) <= 1) {
+    if (c) {
+        /* jobs waiting for each other, e.g. through ff_thread_await_progress2(),
+         * need threads of their own */
+        if (avctx->codec->caps_internal & FF_CODEC_CAP_SLICE_THREAD_SYNC_JOBS)
+            thread_count = avpriv_slicethread_create_private(&c->thread, avctx, worker_func, mainfunc, thread_count);
+        else
+            thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count);
+    }
+    if (!c || thread_count <= 1) {
         if (c)
             avpriv_slicethread_free(&c->thread);
         av_freep(&avctx->internal->thread_ctx);
@@ -165,6 +173,7 @@ int ff_slice_thread_init(AVCodecContext *avctx)
         return 0;
     }
     avctx->thread_count = thread_count;
+    avpriv_slicethread_set_priority(c->thread, avctx->thread_priority);
 
     avctx->execute = thread_execute;
     avctx->execute2 = thread_execute2;
@@ -38,6 +38,8 @@ AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples)
 AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
     AVFrame *frame = NULL;
+    /* the filter may not be in a graph yet */
+    int max_idle = link->dst->graph ? link->dst->graph->max_pool_frames : -1;
     int channels = link->channels;
 
     av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
@@ -47,6 +49,7 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
                                                     nb_samples, link->format, BUFFER_ALIGN);
         if (!link->frame_pool)
             return NULL;
+        ff_frame_pool_set_max_idle(link->frame_pool, max_idle);
     } else {
         int pool_channels = 0;
         int pool_nb_samples = 0;
@@ -67,6 +70,7 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
                                                         nb_samples, link->format, BUFFER_ALIGN);
             if (!link->frame_pool)
                 return NULL;
+            ff_frame_pool_set_max_idle(link->frame_pool, max_idle);
         }
     }
 
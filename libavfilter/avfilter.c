@@ -33,6 +33,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -192,6 +193,15 @@ int avfilter_link_get_channels(AVFilterLink *link)
 
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
+    AVFilterGraphInternal *graphi = filter->graph ? filter->graph->internal : NULL;
+
+    /* filters activated in parallel may share a neighbour */
+    if (graphi && graphi->sched) {
+        ff_mutex_lock(&graphi->sched_lock);
+        filter->ready = FFMAX(filter->ready, priority);
+        ff_mutex_unlock(&graphi->sched_lock);
+        return;
+    }
     filter->ready = FFMAX(filter->ready, priority);
 }
 
@@ -1420,6 +1430,7 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
 int ff_filter_activate(AVFilterContext *filter)
 {
+    int64_t start = filter->graph->profile ? av_gettime_relative() : 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
@@ -1428,6 +1439,8 @@ int ff_filter_activate(AVFilterContext *filter)
     filter->ready = 0;
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    if (filter->graph->profile)
+        filter->exec_time += av_gettime_relative() - start;
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -422,6 +422,15 @@ struct AVFilterContext {
      * configured.
      */
     int extra_hw_frames;
+
+    /**
+     * Wall-clock time in microseconds spent activating this filter, including
+     * the slice jobs it ran on other threads. Only updated when
+     * AVFilterGraph.profile is set.
+     *
+     * Set by libavfilter, must not be changed by the caller.
+     */
+    int64_t exec_time;
 };
 
 /**
@@ -896,6 +905,46 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Maximum number of filters of this graph that may be activated at the
+     * same time. Filters are only run concurrently when they do not share a
+     * link, so the order of the frames on each link is preserved.
+     *
+     * Must be set before avfilter_graph_config(). Zero or one (the default)
+     * activates a single filter at a time. If set, a user supplied
+     * AVFilterGraph.execute callback must be reentrant.
+     * Access ONLY through AVOptions.
+     */
+    int graph_threads;
+
+    /**
+     * Priority of the threaded work of this graph on the thread pool shared
+     * by the whole process, see av_cpu_set_shared_threads(). Higher values
+     * are served first. Has no effect when the pool is not used.
+     *
+     * Must be set before adding filters to the graph.
+     * Access ONLY through AVOptions.
+     */
+    int thread_priority;
+
+    /**
+     * Maximum number of unused frames kept for reuse by the frame pool of
+     * each link, negative (the default) for no limit. Frames released beyond
+     * that are freed, which bounds the memory held by graphs whose frame
+     * sizes keep changing or which see bursts of frames.
+     *
+     * Must be set before avfilter_graph_config().
+     * Access ONLY through AVOptions.
+     */
+    int max_pool_frames;
+
+    /**
+     * If set, the time spent in each filter of the graph is accounted in
+     * AVFilterContext.exec_time.
+     * Access ONLY through AVOptions.
+     */
+    int profile;
+
     /**
      * Private fields
      *
@@ -1131,6 +1180,16 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
 int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, int flags, double ts);
 
 
+/**
+ * Get the usage statistics of the frame pools of all the links of a graph.
+ * The counts are in buffers, i.e. one per frame plane, and the peak is the
+ * sum of the peaks of each pool.
+ *
+ * @param graph the filter graph
+ * @param stats structure to fill
+ */
+void avfilter_graph_get_pool_stats(AVFilterGraph *graph, AVBufferPoolStats *stats);
+
 /**
  * Dump a graph into a human-readable string representation.
  *
@@ -39,6 +39,7 @@
 #include "avfilter.h"
 #include "buffersink.h"
 #include "formats.h"
+#include "framepool.h"
 #include "internal.h"
 #include "thread.h"
 
@@ -56,6 +57,14 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "graph_threads", "Maximum number of filters activated in parallel", OFFSET(graph_threads),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
+    { "thread_priority", "Priority on the shared thread pool", OFFSET(thread_priority),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, INT_MIN, INT_MAX, F|V|A },
+    { "max_pool_frames", "Maximum number of unused frames kept by each link", OFFSET(max_pool_frames),
+        AV_OPT_TYPE_INT,   { .i64 = -1 }, -1, INT_MAX, F|V|A },
+    { "profile", "Account the time spent in each filter", OFFSET(profile),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -78,6 +87,22 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_sched_init(AVFilterGraph *graph)
+{
+    graph->graph_threads = 1;
+    return 0;
+}
+
+void ff_graph_sched_free(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_sched_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                           int nb_filters)
+{
+    return AVERROR(ENOSYS);
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -92,6 +117,12 @@ AVFilterGraph *avfilter_graph_alloc(void)
         return NULL;
     }
 
+    if (ff_mutex_init(&ret->internal->sched_lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
@@ -125,7 +156,9 @@ void avfilter_graph_free(AVFilterGraph **graph)
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
+    ff_graph_sched_free(*graph);
     ff_graph_thread_free(*graph);
+    ff_mutex_destroy(&(*graph)->internal->sched_lock);
 
     av_freep(&(*graph)->sink_links);
 
@@ -1280,10 +1313,38 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = ff_graph_sched_init(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
 
+void avfilter_graph_get_pool_stats(AVFilterGraph *graph, AVBufferPoolStats *stats)
+{
+    int i, j;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        for (j = 0; j < filter->nb_outputs; j++) {
+            AVFilterLink *link = filter->outputs[j];
+            AVBufferPoolStats s;
+
+            if (!link || !link->frame_pool)
+                continue;
+            ff_frame_pool_get_stats(link->frame_pool, &s);
+            stats->hits        += s.hits;
+            stats->misses      += s.misses;
+            stats->outstanding += s.outstanding;
+            stats->allocated   += s.allocated;
+            stats->peak        += s.peak;
+            stats->bytes       += s.bytes;
+        }
+    }
+}
+
 int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     int i, r = AVERROR(ENOSYS);
@@ -1390,8 +1451,13 @@ static void heap_bubble_down(AVFilterGraph *graph,
 
 void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link)
 {
+    /* several sinks may be activated in parallel */
+    if (graph->internal->sched)
+        ff_mutex_lock(&graph->internal->sched_lock);
     heap_bubble_up  (graph, link, link->age_index);
     heap_bubble_down(graph, link, link->age_index);
+    if (graph->internal->sched)
+        ff_mutex_unlock(&graph->internal->sched_lock);
 }
 
 int avfilter_graph_request_oldest(AVFilterGraph *graph)
@@ -1439,6 +1505,70 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+/**
+ * Check if activating the two filters at the same time could make them
+ * access the same link: that is the case if they are connected, or if one
+ * feeds a filter connected to the input of the other, since activating a
+ * filter unblocks the outputs of the filters downstream.
+ */
+static int filters_conflict(AVFilterContext *a, AVFilterContext *b)
+{
+    unsigned i, j;
+
+    for (i = 0; i < a->nb_inputs; i++)
+        if (a->inputs[i] && a->inputs[i]->src == b)
+            return 1;
+    for (i = 0; i < a->nb_outputs; i++) {
+        AVFilterContext *next = a->outputs[i] ? a->outputs[i]->dst : NULL;
+        if (!next)
+            continue;
+        if (next == b)
+            return 1;
+        for (j = 0; j < next->nb_outputs; j++)
+            if (next->outputs[j] && next->outputs[j]->dst == b)
+                return 1;
+    }
+    for (i = 0; i < b->nb_outputs; i++) {
+        AVFilterContext *next = b->outputs[i] ? b->outputs[i]->dst : NULL;
+        if (!next)
+            continue;
+        if (next == a)
+            return 1;
+        for (j = 0; j < next->nb_outputs; j++)
+            if (next->outputs[j] && next->outputs[j]->dst == a)
+                return 1;
+    }
+    return 0;
+}
+
+static int graph_run_once_parallel(AVFilterGraph *graph, AVFilterContext *first)
+{
+    AVFilterContext **batch = graph->internal->sched_batch;
+    unsigned i, j;
+    int nb_batch = 1;
+
+    batch[0] = first;
+    if (first->filter->flags_internal & FF_FILTER_FLAG_GRAPH_ACCESS)
+        return ff_filter_activate(first);
+
+    for (i = 0; i < graph->nb_filters && nb_batch < graph->graph_threads; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (!filter->ready || filter == first ||
+            filter->filter->flags_internal & FF_FILTER_FLAG_GRAPH_ACCESS)
+            continue;
+        for (j = 0; j < nb_batch; j++)
+            if (filters_conflict(filter, batch[j]))
+                break;
+        if (j == nb_batch)
+            batch[nb_batch++] = filter;
+    }
+
+    if (nb_batch == 1)
+        return ff_filter_activate(first);
+    return ff_graph_sched_execute(graph, batch, nb_batch);
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
@@ -1451,5 +1581,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
+    if (graph->internal->sched)
+        return graph_run_once_parallel(graph, filter);
     return ff_filter_activate(filter);
 }
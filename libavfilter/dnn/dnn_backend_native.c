@@ -23,9 +23,50 @@
  * DNN native backend implementation.
  */
 
+#include "config.h"
 #include "dnn_backend_native.h"
 #include "libavutil/avassert.h"
+#include "libavutil/thread.h"
 #include "dnn_backend_native_layer_pad.h"
+#include "dnn_backend_native_layer_conv2d.h"
+
+typedef struct NativeRequest {
+    // ping-pong buffers holding the input and the outputs of the layers
+    float *data[2];
+    unsigned data_size[2];
+    void *opaque;
+    DNNData output;
+    DNNReturnType result;
+    int in_use;
+} NativeRequest;
+
+typedef struct NativeAsyncContext {
+    ConvolutionalNetwork *network;
+
+    NativeRequest **requests;
+    int nb_requests;
+
+    // requests in submission order, the request of the i-th execution is
+    // queue[i % queue_size]
+    NativeRequest **queue;
+    unsigned queue_size;
+    // numbers of queued, flushed, finished and returned executions
+    uint64_t nb_queued, nb_flushed, nb_done, nb_returned;
+    // request of the output returned last, recycled by the next call
+    NativeRequest *returned;
+
+    // requests of the running batch
+    NativeRequest **batch;
+    unsigned batch_size;
+
+#if HAVE_THREADS
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    // signaled when executions are flushed or finished
+    pthread_cond_t cond;
+    int finished;
+#endif
+} NativeAsyncContext;
 
 static DNNReturnType set_input_output_native(void *model, DNNInputData *input, const char *input_name, const char **output_names, uint32_t nb_output)
 {
@@ -40,6 +81,9 @@ static DNNReturnType set_input_output_native(void *model, DNNInputData *input, c
     if (network->layers_num <= 0 || network->layers[0].type != INPUT){
         return DNN_ERROR;
     }
+    else if (network->async && network->async->nb_returned != network->async->nb_queued){
+        return DNN_ERROR;
+    }
     else{
         input_params = (InputParams *)network->layers[0].params;
         input_params->width = cur_width = input->width;
@@ -53,6 +97,7 @@ static DNNReturnType set_input_output_native(void *model, DNNInputData *input, c
         if (!network->layers[0].output){
             return DNN_ERROR;
         }
+        network->max_data_size = cur_height * cur_width * cur_channels;
     }
 
     for (layer = 1; layer < network->layers_num; ++layer){
@@ -99,6 +144,7 @@ static DNNReturnType set_input_output_native(void *model, DNNInputData *input, c
         if (!network->layers[layer].output){
             return DNN_ERROR;
         }
+        network->max_data_size = FFMAX(network->max_data_size, cur_height * cur_width * cur_channels);
     }
 
     return DNN_SUCCESS;
@@ -138,6 +184,9 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
         return NULL;
     }
     model->model = (void *)network;
+    network->conv2d = NULL;
+    network->max_data_size = 0;
+    network->async = NULL;
 
     network->layers_num = 1 + (int32_t)avio_rl32(model_file_context);
     dnn_size = 4;
@@ -167,7 +216,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
         dnn_size += 4;
         switch (layer_type){
         case CONV:
-            conv_params = av_malloc(sizeof(ConvolutionalParams));
+            conv_params = av_mallocz(sizeof(ConvolutionalParams));
             if (!conv_params){
                 avio_closep(&model_file_context);
                 ff_dnn_free_model_native(&model);
@@ -203,6 +252,11 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
             }
             network->layers[layer].type = CONV;
             network->layers[layer].params = conv_params;
+            if (dnn_pack_conv2d_kernel(conv_params) < 0){
+                avio_closep(&model_file_context);
+                ff_dnn_free_model_native(&model);
+                return NULL;
+            }
             break;
         case DEPTH_TO_SPACE:
             depth_to_space_params = av_malloc(sizeof(DepthToSpaceParams));
@@ -247,68 +301,17 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
         return NULL;
     }
 
+    network->conv2d = dnn_conv2d_alloc(0);
+    if (!network->conv2d){
+        ff_dnn_free_model_native(&model);
+        return NULL;
+    }
+
     model->set_input_output = &set_input_output_native;
 
     return model;
 }
 
-#define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
-
-static void convolve(const float *input, float *output, const ConvolutionalParams *conv_params, int width, int height)
-{
-    int radius = conv_params->kernel_size >> 1;
-    int src_linesize = width * conv_params->input_num;
-    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
-    int filter_size = conv_params->kernel_size * filter_linesize;
-    int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
-
-    for (int y = pad_size; y < height - pad_size; ++y) {
-        for (int x = pad_size; x < width - pad_size; ++x) {
-            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
-                output[n_filter] = conv_params->biases[n_filter];
-
-                for (int ch = 0; ch < conv_params->input_num; ++ch) {
-                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
-                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
-                            float input_pel;
-                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
-                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
-                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
-                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            } else {
-                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
-                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
-                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
-                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            }
-
-
-                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                                kernel_x * conv_params->input_num + ch];
-                        }
-                    }
-                }
-                switch (conv_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
-                }
-            }
-            output += conv_params->output_num;
-        }
-    }
-}
-
 static void depth_to_space(const float *input, float *output, int block_size, int width, int height, int channels)
 {
     int y, x, by, bx, ch;
@@ -332,15 +335,53 @@ static void depth_to_space(const float *input, float *output, int block_size, in
     }
 }
 
+static DNNReturnType execute_layer(ConvolutionalNetwork *network, int32_t layer, const float *input, float *output,
+                                   int *cur_width, int *cur_height, int *cur_channels)
+{
+    ConvolutionalParams *conv_params;
+    DepthToSpaceParams *depth_to_space_params;
+    LayerPadParams *pad_params;
+
+    switch (network->layers[layer].type){
+    case CONV:
+        conv_params = (ConvolutionalParams *)network->layers[layer].params;
+        if (dnn_execute_layer_conv2d(network->conv2d, input, output, conv_params, *cur_width, *cur_height) < 0){
+            return DNN_ERROR;
+        }
+        *cur_channels = conv_params->output_num;
+        if (conv_params->padding_method == VALID) {
+            int pad_size = (conv_params->kernel_size - 1) * conv_params->dilation;
+            *cur_height -= pad_size;
+            *cur_width -= pad_size;
+        }
+        break;
+    case DEPTH_TO_SPACE:
+        depth_to_space_params = (DepthToSpaceParams *)network->layers[layer].params;
+        depth_to_space(input, output, depth_to_space_params->block_size, *cur_width, *cur_height, *cur_channels);
+        *cur_height *= depth_to_space_params->block_size;
+        *cur_width *= depth_to_space_params->block_size;
+        *cur_channels /= depth_to_space_params->block_size * depth_to_space_params->block_size;
+        break;
+    case MIRROR_PAD:
+        pad_params = (LayerPadParams *)network->layers[layer].params;
+        dnn_execute_layer_pad(input, output, pad_params, 1, *cur_height, *cur_width, *cur_channels);
+        *cur_height = *cur_height + pad_params->paddings[1][0] + pad_params->paddings[1][1];
+        *cur_width = *cur_width + pad_params->paddings[2][0] + pad_params->paddings[2][1];
+        *cur_channels = *cur_channels + pad_params->paddings[3][0] + pad_params->paddings[3][1];
+        break;
+    case INPUT:
+        return DNN_ERROR;
+    }
+
+    return DNN_SUCCESS;
+}
+
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *outputs, uint32_t nb_output)
 {
     ConvolutionalNetwork *network = (ConvolutionalNetwork *)model->model;
     int cur_width, cur_height, cur_channels;
     int32_t layer;
     InputParams *input_params;
-    ConvolutionalParams *conv_params;
-    DepthToSpaceParams *depth_to_space_params;
-    LayerPadParams *pad_params;
 
     if (network->layers_num <= 0 || network->layers[0].type != INPUT || !network->layers[0].output){
         return DNN_ERROR;
@@ -356,34 +397,8 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *output
         if (!network->layers[layer].output){
             return DNN_ERROR;
         }
-        switch (network->layers[layer].type){
-        case CONV:
-            conv_params = (ConvolutionalParams *)network->layers[layer].params;
-            convolve(network->layers[layer - 1].output, network->layers[layer].output, conv_params, cur_width, cur_height);
-            cur_channels = conv_params->output_num;
-            if (conv_params->padding_method == VALID) {
-                int pad_size = (conv_params->kernel_size - 1) * conv_params->dilation;
-                cur_height -= pad_size;
-                cur_width -= pad_size;
-            }
-            break;
-        case DEPTH_TO_SPACE:
-            depth_to_space_params = (DepthToSpaceParams *)network->layers[layer].params;
-            depth_to_space(network->layers[layer - 1].output, network->layers[layer].output,
-                           depth_to_space_params->block_size, cur_width, cur_height, cur_channels);
-            cur_height *= depth_to_space_params->block_size;
-            cur_width *= depth_to_space_params->block_size;
-            cur_channels /= depth_to_space_params->block_size * depth_to_space_params->block_size;
-            break;
-        case MIRROR_PAD:
-            pad_params = (LayerPadParams *)network->layers[layer].params;
-            dnn_execute_layer_pad(network->layers[layer - 1].output, network->layers[layer].output,
-                                  pad_params, 1, cur_height, cur_width, cur_channels);
-            cur_height = cur_height + pad_params->paddings[1][0] + pad_params->paddings[1][1];
-            cur_width = cur_width + pad_params->paddings[2][0] + pad_params->paddings[2][1];
-            cur_channels = cur_channels + pad_params->paddings[3][0] + pad_params->paddings[3][1];
-            break;
-        case INPUT:
+        if (execute_layer(network, layer, network->layers[layer - 1].output, network->layers[layer].output,
+                          &cur_width, &cur_height, &cur_channels) != DNN_SUCCESS){
             return DNN_ERROR;
         }
     }
@@ -399,6 +414,322 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *output
     return DNN_SUCCESS;
 }
 
+// The executions of a batch are run layer by layer, so that the parameters of
+// each layer are loaded once for the whole batch.
+static void execute_batch(ConvolutionalNetwork *network, NativeRequest **batch, int nb)
+{
+    InputParams *input_params = (InputParams *)network->layers[0].params;
+    int cur_width = input_params->width;
+    int cur_height = input_params->height;
+    int cur_channels = input_params->channels;
+    int width, height, channels, i;
+    int32_t layer;
+
+    for (i = 0; i < nb; i++)
+        batch[i]->result = DNN_SUCCESS;
+
+    for (layer = 1; layer < network->layers_num; ++layer){
+        for (i = 0; i < nb; i++){
+            NativeRequest *request = batch[i];
+
+            width = cur_width;
+            height = cur_height;
+            channels = cur_channels;
+            if (request->result == DNN_SUCCESS)
+                request->result = execute_layer(network, layer, request->data[(layer - 1) & 1], request->data[layer & 1],
+                                                &width, &height, &channels);
+        }
+        cur_width = width;
+        cur_height = height;
+        cur_channels = channels;
+    }
+
+    for (i = 0; i < nb; i++){
+        batch[i]->output.data = batch[i]->data[(network->layers_num - 1) & 1];
+        batch[i]->output.width = cur_width;
+        batch[i]->output.height = cur_height;
+        batch[i]->output.channels = cur_channels;
+    }
+}
+
+// Must be called with the mutex locked, returns the number of executions taken.
+static int get_batch(NativeAsyncContext *async, NativeRequest ***batch, NativeRequest **single)
+{
+    int nb = async->nb_flushed - async->nb_done, i;
+    NativeRequest **requests = av_fast_realloc(async->batch, &async->batch_size, nb * sizeof(*requests));
+
+    if (requests){
+        async->batch = requests;
+    } else {
+        // run them one by one
+        requests = single;
+        nb = 1;
+    }
+    for (i = 0; i < nb; i++)
+        requests[i] = async->queue[(async->nb_done + i) % async->queue_size];
+    *batch = requests;
+
+    return nb;
+}
+
+#if HAVE_THREADS
+static void *async_worker(void *arg)
+{
+    NativeAsyncContext *async = arg;
+    NativeRequest **batch, *single;
+    int nb;
+
+    pthread_mutex_lock(&async->mutex);
+    while (!async->finished){
+        if (async->nb_done == async->nb_flushed){
+            pthread_cond_wait(&async->cond, &async->mutex);
+            continue;
+        }
+        nb = get_batch(async, &batch, &single);
+        pthread_mutex_unlock(&async->mutex);
+
+        execute_batch(async->network, batch, nb);
+
+        pthread_mutex_lock(&async->mutex);
+        async->nb_done += nb;
+        pthread_cond_broadcast(&async->cond);
+    }
+    pthread_mutex_unlock(&async->mutex);
+
+    return NULL;
+}
+#endif
+
+static void free_async(NativeAsyncContext **pasync)
+{
+    NativeAsyncContext *async = *pasync;
+    int i;
+
+    if (!async)
+        return;
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&async->mutex);
+    async->finished = 1;
+    pthread_cond_broadcast(&async->cond);
+    pthread_mutex_unlock(&async->mutex);
+    pthread_join(async->thread, NULL);
+    pthread_cond_destroy(&async->cond);
+    pthread_mutex_destroy(&async->mutex);
+#endif
+
+    for (i = 0; i < async->nb_requests; i++){
+        av_freep(&async->requests[i]->data[0]);
+        av_freep(&async->requests[i]->data[1]);
+        av_freep(&async->requests[i]);
+    }
+    av_freep(&async->requests);
+    av_freep(&async->queue);
+    av_freep(&async->batch);
+    av_freep(pasync);
+}
+
+static NativeAsyncContext *alloc_async(ConvolutionalNetwork *network)
+{
+    NativeAsyncContext *async = av_mallocz(sizeof(*async));
+
+    if (!async)
+        return NULL;
+    async->network = network;
+
+#if HAVE_THREADS
+    if (pthread_mutex_init(&async->mutex, NULL)){
+        av_freep(&async);
+        return NULL;
+    }
+    if (pthread_cond_init(&async->cond, NULL)){
+        pthread_mutex_destroy(&async->mutex);
+        av_freep(&async);
+        return NULL;
+    }
+    if (pthread_create(&async->thread, NULL, async_worker, async)){
+        pthread_cond_destroy(&async->cond);
+        pthread_mutex_destroy(&async->mutex);
+        av_freep(&async);
+        return NULL;
+    }
+#endif
+
+    return async;
+}
+
+static NativeRequest *get_request(NativeAsyncContext *async)
+{
+    NativeRequest *request, **requests;
+    int i;
+
+    for (i = 0; i < async->nb_requests; i++){
+        if (!async->requests[i]->in_use){
+            async->requests[i]->in_use = 1;
+            return async->requests[i];
+        }
+    }
+
+    requests = av_realloc_array(async->requests, async->nb_requests + 1, sizeof(*requests));
+    if (!requests)
+        return NULL;
+    async->requests = requests;
+    request = av_mallocz(sizeof(*request));
+    if (!request)
+        return NULL;
+    request->in_use = 1;
+    async->requests[async->nb_requests++] = request;
+
+    return request;
+}
+
+// Must be called with the mutex locked.
+static int grow_queue(NativeAsyncContext *async)
+{
+    unsigned size = FFMAX(2 * async->queue_size, 4);
+    NativeRequest **queue = av_malloc_array(size, sizeof(*queue));
+    uint64_t i;
+
+    if (!queue)
+        return AVERROR(ENOMEM);
+    for (i = async->nb_returned; i < async->nb_queued; i++)
+        queue[i % size] = async->queue[i % async->queue_size];
+    av_free(async->queue);
+    async->queue = queue;
+    async->queue_size = size;
+
+    return 0;
+}
+
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, void *opaque)
+{
+    ConvolutionalNetwork *network = (ConvolutionalNetwork *)model->model;
+    InputParams *input_params;
+    NativeAsyncContext *async;
+    NativeRequest *request;
+    int ret = 0, i;
+
+    if (network->layers_num <= 0 || network->layers[0].type != INPUT || !network->layers[0].output){
+        return DNN_ERROR;
+    }
+    input_params = (InputParams *)network->layers[0].params;
+
+    if (!network->async){
+        network->async = alloc_async(network);
+        if (!network->async){
+            return DNN_ERROR;
+        }
+    }
+    async = network->async;
+
+    request = get_request(async);
+    if (!request){
+        return DNN_ERROR;
+    }
+    for (i = 0; i < 2; i++){
+        av_fast_malloc(&request->data[i], &request->data_size[i], network->max_data_size * sizeof(float));
+        if (!request->data[i]){
+            request->in_use = 0;
+            return DNN_ERROR;
+        }
+    }
+    memcpy(request->data[0], network->layers[0].output,
+           input_params->height * input_params->width * input_params->channels * sizeof(float));
+    request->opaque = opaque;
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&async->mutex);
+#endif
+    if (async->nb_queued - async->nb_returned == async->queue_size)
+        ret = grow_queue(async);
+    if (ret >= 0)
+        async->queue[async->nb_queued++ % async->queue_size] = request;
+#if HAVE_THREADS
+    pthread_mutex_unlock(&async->mutex);
+#endif
+    if (ret < 0){
+        request->in_use = 0;
+        return DNN_ERROR;
+    }
+
+    return DNN_SUCCESS;
+}
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model)
+{
+    ConvolutionalNetwork *network = (ConvolutionalNetwork *)model->model;
+    NativeAsyncContext *async = network->async;
+#if !HAVE_THREADS
+    NativeRequest **batch, *single;
+#endif
+
+    if (!async || async->nb_flushed == async->nb_queued){
+        return DNN_SUCCESS;
+    }
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&async->mutex);
+    async->nb_flushed = async->nb_queued;
+    pthread_cond_broadcast(&async->cond);
+    pthread_mutex_unlock(&async->mutex);
+#else
+    async->nb_flushed = async->nb_queued;
+    while (async->nb_done != async->nb_flushed){
+        int nb = get_batch(async, &batch, &single);
+        execute_batch(network, batch, nb);
+        async->nb_done += nb;
+    }
+#endif
+
+    return DNN_SUCCESS;
+}
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, DNNData *output, void **opaque, int wait)
+{
+    ConvolutionalNetwork *network = (ConvolutionalNetwork *)model->model;
+    NativeAsyncContext *async = network->async;
+    NativeRequest *request;
+    uint64_t nb_done;
+
+    *opaque = NULL;
+    if (!async){
+        return DAST_EMPTY_QUEUE;
+    }
+    if (async->returned){
+        async->returned->in_use = 0;
+        async->returned = NULL;
+    }
+    if (async->nb_returned == async->nb_queued){
+        return DAST_EMPTY_QUEUE;
+    }
+    if (wait && async->nb_returned == async->nb_flushed){
+        ff_dnn_flush_native(model);
+    }
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&async->mutex);
+    while (wait && async->nb_done == async->nb_returned)
+        pthread_cond_wait(&async->cond, &async->mutex);
+    nb_done = async->nb_done;
+    pthread_mutex_unlock(&async->mutex);
+#else
+    nb_done = async->nb_done;
+#endif
+    if (nb_done == async->nb_returned){
+        return DAST_NOT_READY;
+    }
+
+    request = async->queue[async->nb_returned++ % async->queue_size];
+    async->returned = request;
+    *opaque = request->opaque;
+    if (request->result != DNN_SUCCESS){
+        return DAST_FAIL;
+    }
+    *output = request->output;
+
+    return DAST_SUCCESS;
+}
+
 void ff_dnn_free_model_native(DNNModel **model)
 {
     ConvolutionalNetwork *network;
@@ -408,16 +739,19 @@ void ff_dnn_free_model_native(DNNModel **model)
     if (*model)
     {
         network = (ConvolutionalNetwork *)(*model)->model;
+        free_async(&network->async);
         for (layer = 0; layer < network->layers_num; ++layer){
             av_freep(&network->layers[layer].output);
             if (network->layers[layer].type == CONV){
                 conv_params = (ConvolutionalParams *)network->layers[layer].params;
                 av_freep(&conv_params->kernel);
                 av_freep(&conv_params->biases);
+                av_freep(&conv_params->packed_kernel);
             }
             av_freep(&network->layers[layer].params);
         }
         av_freep(&network->layers);
+        dnn_conv2d_free(&network->conv2d);
         av_freep(&network);
         av_freep(model);
     }
@@ -49,6 +49,7 @@ typedef struct ConvolutionalParams{
     int32_t dilation;
     float *kernel;
     float *biases;
+    float *packed_kernel;
 } ConvolutionalParams;
 
 typedef struct InputParams{
@@ -63,12 +64,22 @@ typedef struct DepthToSpaceParams{
 typedef struct ConvolutionalNetwork{
     Layer *layers;
     int32_t layers_num;
+    struct DNNConv2DContext *conv2d;
+    // size in floats of the largest input or layer output
+    size_t max_data_size;
+    struct NativeAsyncContext *async;
 } ConvolutionalNetwork;
 
 DNNModel *ff_dnn_load_model_native(const char *model_filename);
 
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *outputs, uint32_t nb_output);
 
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, void *opaque);
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model);
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, DNNData *output, void **opaque, int wait);
+
 void ff_dnn_free_model_native(DNNModel **model);
 
 #endif
@@ -0,0 +1,266 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "dnn_backend_native_layer_conv2d.h"
+
+#define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
+
+static void gemm_block_c(float *dst, ptrdiff_t dst_stride,
+                         const float *src, ptrdiff_t src_stride,
+                         const float *kernel, int len)
+{
+    float sum[CONV2D_BLOCK_PIXELS][CONV2D_BLOCK_OUTPUTS] = { { 0 } };
+    int i, j, k;
+
+    for (k = 0; k < len; k++) {
+        for (i = 0; i < CONV2D_BLOCK_PIXELS; i++) {
+            const float s = ((const float *)((const uint8_t *)src + i * src_stride))[k];
+            for (j = 0; j < CONV2D_BLOCK_OUTPUTS; j++)
+                sum[i][j] += s * kernel[j];
+        }
+        kernel += CONV2D_BLOCK_OUTPUTS;
+    }
+
+    for (i = 0; i < CONV2D_BLOCK_PIXELS; i++) {
+        memcpy(dst, sum[i], sizeof(sum[i]));
+        dst = (float *)((uint8_t *)dst + dst_stride);
+    }
+}
+
+av_cold void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *dsp)
+{
+    dsp->gemm_block = gemm_block_c;
+}
+
+static inline int filter_size(const ConvolutionalParams *conv_params)
+{
+    return conv_params->kernel_size * conv_params->kernel_size * conv_params->input_num;
+}
+
+static inline int nb_panels(const ConvolutionalParams *conv_params)
+{
+    return (conv_params->output_num + CONV2D_BLOCK_OUTPUTS - 1) / CONV2D_BLOCK_OUTPUTS;
+}
+
+int dnn_pack_conv2d_kernel(ConvolutionalParams *conv_params)
+{
+    const int size = filter_size(conv_params);
+    float *packed;
+    int n_filter, k;
+
+    av_freep(&conv_params->packed_kernel);
+    packed = av_mallocz_array(nb_panels(conv_params) * size,
+                              CONV2D_BLOCK_OUTPUTS * sizeof(*packed));
+    if (!packed)
+        return AVERROR(ENOMEM);
+
+    // each panel interleaves CONV2D_BLOCK_OUTPUTS filters, the filters
+    // missing from the last panel are zero
+    for (n_filter = 0; n_filter < conv_params->output_num; n_filter++) {
+        float *dst = packed + n_filter / CONV2D_BLOCK_OUTPUTS * size * CONV2D_BLOCK_OUTPUTS +
+                     n_filter % CONV2D_BLOCK_OUTPUTS;
+        const float *src = conv_params->kernel + n_filter * size;
+
+        for (k = 0; k < size; k++)
+            dst[k * CONV2D_BLOCK_OUTPUTS] = src[k];
+    }
+    conv_params->packed_kernel = packed;
+
+    return 0;
+}
+
+static inline float activate(float value, DNNActivationFunc activation)
+{
+    switch (activation){
+    case RELU:
+        return FFMAX(value, 0.0);
+    case TANH:
+        return 2.0f  / (1.0f + exp(-2.0f * value)) - 1.0f;
+    case SIGMOID:
+        return 1.0f / (1.0f + exp(-value));
+    case LEAKY_RELU:
+        return FFMAX(value, 0.0) + 0.2 * FFMIN(value, 0.0);
+    default:
+        return value;
+    }
+}
+
+// Gather the input patches of the output pixels x..x+n-1 of row y.
+static void im2col(float *col, const float *input, const ConvolutionalParams *conv_params,
+                   int x, int y, int n, int width, int height)
+{
+    const int radius = conv_params->kernel_size >> 1;
+    const int dilation = conv_params->dilation;
+    const int input_num = conv_params->input_num;
+    const size_t pel_size = input_num * sizeof(*col);
+    int i, kernel_x, kernel_y;
+
+    for (i = 0; i < n; i++) {
+        for (kernel_y = 0; kernel_y < conv_params->kernel_size; kernel_y++) {
+            int y_pos = y + (kernel_y - radius) * dilation;
+
+            for (kernel_x = 0; kernel_x < conv_params->kernel_size; kernel_x++) {
+                int x_pos = x + i + (kernel_x - radius) * dilation;
+
+                if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
+                    memcpy(col, input + (CLAMP_TO_EDGE(y_pos, height) * width +
+                                         CLAMP_TO_EDGE(x_pos, width)) * input_num, pel_size);
+                } else if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
+                    memset(col, 0, pel_size);
+                } else {
+                    memcpy(col, input + (y_pos * width + x_pos) * input_num, pel_size);
+                }
+                col += input_num;
+            }
+        }
+    }
+}
+
+static void conv2d_row(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    DNNConv2DContext *s = priv;
+    const ConvolutionalParams *conv_params = s->params;
+    const int size = filter_size(conv_params);
+    const int panels = nb_panels(conv_params);
+    const int sum_linesize = panels * CONV2D_BLOCK_OUTPUTS;
+    const int offset = conv_params->padding_method == VALID ?
+                       (conv_params->kernel_size >> 1) * conv_params->dilation : 0;
+    const int out_width = conv_params->padding_method == VALID ?
+                          s->width - (conv_params->kernel_size - 1) * conv_params->dilation : s->width;
+    float *col = s->scratch[threadnr];
+    float *sum = col + CONV2D_TILE_PIXELS * size;
+    float *output = s->output + (size_t)jobnr * out_width * conv_params->output_num;
+    int x, i, panel, n_filter;
+
+    for (x = 0; x < out_width; x += CONV2D_TILE_PIXELS) {
+        const int n = FFMIN(CONV2D_TILE_PIXELS, out_width - x);
+
+        im2col(col, s->input, conv_params, x + offset, jobnr + offset, n, s->width, s->height);
+
+        // the rows of the last pixel block past n are left over from the
+        // previous tile, their products are not used
+        for (panel = 0; panel < panels; panel++) {
+            const float *kernel = conv_params->packed_kernel + panel * size * CONV2D_BLOCK_OUTPUTS;
+
+            for (i = 0; i < n; i += CONV2D_BLOCK_PIXELS)
+                s->dsp.gemm_block(sum + i * sum_linesize + panel * CONV2D_BLOCK_OUTPUTS,
+                                  sum_linesize * sizeof(*sum),
+                                  col + i * size, size * sizeof(*col), kernel, size);
+        }
+
+        for (i = 0; i < n; i++) {
+            const float *pel_sum = sum + i * sum_linesize;
+
+            for (n_filter = 0; n_filter < conv_params->output_num; n_filter++)
+                output[n_filter] = activate(pel_sum[n_filter] + conv_params->biases[n_filter],
+                                            conv_params->activation);
+            output += conv_params->output_num;
+        }
+    }
+}
+
+int dnn_execute_layer_conv2d(DNNConv2DContext *s, const float *input, float *output,
+                             const ConvolutionalParams *conv_params, int width, int height)
+{
+    const size_t scratch_size = CONV2D_TILE_PIXELS * sizeof(float) *
+                                (filter_size(conv_params) + nb_panels(conv_params) * CONV2D_BLOCK_OUTPUTS);
+    int out_height = height, i;
+
+    if (conv_params->padding_method == VALID)
+        out_height -= (conv_params->kernel_size - 1) * conv_params->dilation;
+    if (out_height <= 0 || !conv_params->packed_kernel)
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < s->nb_threads; i++) {
+        av_fast_mallocz(&s->scratch[i], &s->scratch_size[i], scratch_size);
+        if (!s->scratch[i])
+            return AVERROR(ENOMEM);
+    }
+
+    s->params = conv_params;
+    s->input  = input;
+    s->output = output;
+    s->width  = width;
+    s->height = height;
+
+    if (s->slicethread) {
+        avpriv_slicethread_execute(s->slicethread, out_height, 0);
+    } else {
+        for (i = 0; i < out_height; i++)
+            conv2d_row(s, i, 0, out_height, 1);
+    }
+
+    return 0;
+}
+
+DNNConv2DContext *dnn_conv2d_alloc(int nb_threads)
+{
+    DNNConv2DContext *s = av_mallocz(sizeof(*s));
+    int ret;
+
+    if (!s)
+        return NULL;
+
+    ret = avpriv_slicethread_create(&s->slicethread, s, conv2d_row, NULL, nb_threads);
+    if (ret < 0) {
+#if HAVE_THREADS
+        goto fail;
+#else
+        ret = 1;
+#endif
+    }
+    s->nb_threads = ret;
+
+    s->scratch      = av_mallocz_array(s->nb_threads, sizeof(*s->scratch));
+    s->scratch_size = av_mallocz_array(s->nb_threads, sizeof(*s->scratch_size));
+    if (!s->scratch || !s->scratch_size)
+        goto fail;
+
+    ff_dnn_conv2d_dsp_init(&s->dsp);
+
+    return s;
+fail:
+    dnn_conv2d_free(&s);
+    return NULL;
+}
+
+void dnn_conv2d_free(DNNConv2DContext **ps)
+{
+    DNNConv2DContext *s = *ps;
+    int i;
+
+    if (!s)
+        return;
+
+    avpriv_slicethread_free(&s->slicethread);
+    if (s->scratch) {
+        for (i = 0; i < s->nb_threads; i++)
+            av_freep(&s->scratch[i]);
+    }
+    av_freep(&s->scratch);
+    av_freep(&s->scratch_size);
+    av_freep(ps);
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * layer conv2d for native backend.
+ *
+ * The convolution of each output row is computed as a matrix product: the
+ * input patches of a tile of output pixels are gathered into the rows of a
+ * matrix (im2col), which is multiplied by the kernel, reordered at load time
+ * into panels of CONV2D_BLOCK_OUTPUTS output channels. The output rows are
+ * split over a thread pool.
+ */
+
+#ifndef AVFILTER_DNN_DNN_BACKEND_NATIVE_LAYER_CONV2D_H
+#define AVFILTER_DNN_DNN_BACKEND_NATIVE_LAYER_CONV2D_H
+
+#include <stddef.h>
+
+#include "libavutil/slicethread.h"
+#include "dnn_backend_native.h"
+
+/* size of the blocks computed by DNNConv2DDSPContext.gemm_block */
+#define CONV2D_BLOCK_PIXELS   4
+#define CONV2D_BLOCK_OUTPUTS 16
+/* number of output pixels gathered at once, multiple of CONV2D_BLOCK_PIXELS */
+#define CONV2D_TILE_PIXELS   32
+
+typedef struct DNNConv2DDSPContext {
+    /**
+     * Compute a CONV2D_BLOCK_PIXELS x CONV2D_BLOCK_OUTPUTS block of a matrix
+     * product: dst[i][j] = sum of src[i][k] * kernel[k][j] for k < len.
+     *
+     * @param dst        output block, 32-byte aligned
+     * @param dst_stride distance between the rows of dst in bytes,
+     *                   multiple of 32
+     * @param src        CONV2D_BLOCK_PIXELS rows of len floats
+     * @param src_stride distance between the rows of src in bytes
+     * @param kernel     len rows of CONV2D_BLOCK_OUTPUTS floats, 32-byte aligned
+     * @param len        number of products summed up, > 0
+     */
+    void (*gemm_block)(float *dst, ptrdiff_t dst_stride,
+                       const float *src, ptrdiff_t src_stride,
+                       const float *kernel, int len);
+} DNNConv2DDSPContext;
+
+typedef struct DNNConv2DContext {
+    DNNConv2DDSPContext dsp;
+    AVSliceThread *slicethread;
+    int nb_threads;
+
+    // per thread scratch buffers holding an im2col tile and its products
+    float **scratch;
+    unsigned *scratch_size;
+
+    // arguments of the running execution
+    const ConvolutionalParams *params;
+    const float *input;
+    float *output;
+    int width, height;
+} DNNConv2DContext;
+
+/**
+ * Allocate a conv2d execution context.
+ *
+ * @param nb_threads number of threads, 0 for automatic
+ */
+DNNConv2DContext *dnn_conv2d_alloc(int nb_threads);
+
+void dnn_conv2d_free(DNNConv2DContext **s);
+
+/**
+ * Reorder the kernel of a loaded layer into the layout used by
+ * dnn_execute_layer_conv2d(). Must be called once before executing the layer.
+ */
+int dnn_pack_conv2d_kernel(ConvolutionalParams *conv_params);
+
+/**
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int dnn_execute_layer_conv2d(DNNConv2DContext *s, const float *input, float *output,
+                             const ConvolutionalParams *conv_params, int width, int height);
+
+void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *dsp);
+
+#endif
@@ -32,7 +32,7 @@ DNNModule *ff_get_dnn_module(DNNBackendType backend_type)
 {
     DNNModule *dnn_module;
 
-    dnn_module = av_malloc(sizeof(DNNModule));
+    dnn_module = av_mallocz(sizeof(DNNModule));
     if(!dnn_module){
         return NULL;
     }
@@ -42,6 +42,9 @@ DNNModule *ff_get_dnn_module(DNNBackendType backend_type)
         dnn_module->load_model = &ff_dnn_load_model_native;
         dnn_module->execute_model = &ff_dnn_execute_model_native;
         dnn_module->free_model = &ff_dnn_free_model_native;
+        dnn_module->execute_model_async = &ff_dnn_execute_model_async_native;
+        dnn_module->flush = &ff_dnn_flush_native;
+        dnn_module->get_async_result = &ff_dnn_get_async_result_native;
         break;
     case DNN_TF:
     #if (CONFIG_LIBTENSORFLOW == 1)
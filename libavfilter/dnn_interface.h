@@ -34,6 +34,13 @@ typedef enum {DNN_NATIVE, DNN_TF} DNNBackendType;
 
 typedef enum {DNN_FLOAT, DNN_UINT8} DNNDataType;
 
+typedef enum {
+    DAST_FAIL,          // the execution failed
+    DAST_EMPTY_QUEUE,   // no execution is queued
+    DAST_NOT_READY,     // the oldest queued execution is not finished
+    DAST_SUCCESS        // got the output of the oldest queued execution
+} DNNAsyncStatusType;
+
 typedef struct DNNInputData{
     void *data;
     DNNDataType dt;
@@ -61,6 +68,21 @@ typedef struct DNNModule{
     DNNReturnType (*execute_model)(const DNNModel *model, DNNData *outputs, uint32_t nb_output);
     // Frees memory allocated for model.
     void (*free_model)(DNNModel **model);
+
+    // Asynchronous execution, NULL if not supported by the backend. It must
+    // not be mixed with execute_model, and set_input_output must not be
+    // called while executions are queued.
+
+    // Queues an execution of the model on the current content of the input
+    // data, which may be overwritten once this returns. The queued executions
+    // only start with flush, all of them are run together as one batch.
+    DNNReturnType (*execute_model_async)(const DNNModel *model, void *opaque);
+    // Starts the executions queued since the last flush.
+    DNNReturnType (*flush)(const DNNModel *model);
+    // Gets the output of the oldest queued execution and the opaque pointer
+    // it was queued with. If wait is set, starts it if needed and waits for
+    // it to finish. The output data is valid until the next call.
+    DNNAsyncStatusType (*get_async_result)(const DNNModel *model, DNNData *output, void **opaque, int wait);
 } DNNModule;
 
 // Initializes DNNModule depending on chosen backend.
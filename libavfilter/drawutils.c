@@ -556,15 +556,26 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     unsigned mbits = (1 << (1 << l2depth)) - 1;
     unsigned mmult = 255 / mbits;
 
-    for (y = 0; y < h; y++) {
-        xm = xm0;
-        for (x = 0; x < w; x++) {
-            t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
-                 * mmult;
-            xm++;
+    if (l2depth == 3) {
+        for (y = 0; y < h; y++) {
+            for (x = 0; x < w; x++)
+                t += mask[xm0 + x];
+            mask += mask_linesize;
+        }
+    } else {
+        for (y = 0; y < h; y++) {
+            xm = xm0;
+            for (x = 0; x < w; x++) {
+                t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
+                     * mmult;
+                xm++;
+            }
+            mask += mask_linesize;
         }
-        mask += mask_linesize;
     }
+    /* a fully transparent mask leaves the pixel unchanged */
+    if (!t)
+        return;
     alpha = (t >> shift) * alpha;
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
@@ -602,6 +613,17 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3 && !hsub && !vsub) {
+        /* one 8-bit mask value per pixel, same result as blend_pixel() */
+        for (x = 0; x < w; x++) {
+            unsigned a = mask[xm + x] * alpha;
+            if (a)
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
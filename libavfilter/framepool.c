@@ -281,6 +281,41 @@ fail:
     return NULL;
 }
 
+void ff_frame_pool_set_max_idle(FFFramePool *pool, int max_idle)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (!pool->pools[i])
+            continue;
+        /* audio frames take one buffer per plane from the same pool */
+        av_buffer_pool_set_max_idle(pool->pools[i],
+                                    max_idle < 0 || pool->type == AVMEDIA_TYPE_VIDEO ?
+                                    max_idle : max_idle * pool->planes);
+    }
+}
+
+void ff_frame_pool_get_stats(FFFramePool *pool, AVBufferPoolStats *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (i = 0; i < 4; i++) {
+        AVBufferPoolStats s;
+
+        if (!pool->pools[i])
+            continue;
+        av_buffer_pool_get_stats(pool->pools[i], &s);
+        stats->hits        += s.hits;
+        stats->misses      += s.misses;
+        stats->outstanding += s.outstanding;
+        stats->allocated   += s.allocated;
+        stats->peak        += s.peak;
+        stats->bytes       += s.bytes;
+    }
+}
+
 void ff_frame_pool_uninit(FFFramePool **pool)
 {
     int i;
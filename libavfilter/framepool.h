@@ -114,5 +114,19 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
  */
 AVFrame *ff_frame_pool_get(FFFramePool *pool);
 
+/**
+ * Limit the number of unused frames kept by the pool for reuse, see
+ * av_buffer_pool_set_max_idle().
+ *
+ * @param max_idle maximum number of unused frames, negative for no limit
+ */
+void ff_frame_pool_set_max_idle(FFFramePool *pool, int max_idle);
+
+/**
+ * Get the usage statistics of the buffer pools backing the frame pool.
+ * The counts are in buffers, i.e. one per plane of each frame.
+ */
+void ff_frame_pool_get_stats(FFFramePool *pool, AVBufferPoolStats *stats);
+
 
 #endif /* AVFILTER_FRAMEPOOL_H */
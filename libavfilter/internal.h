@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framepool.h"
@@ -149,6 +150,11 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /* parallel activation of independent filters, see graph_threads */
+    void *sched;
+    AVFilterContext **sched_batch;
+    AVMutex sched_lock; ///< protects the ready fields and the sink links heap
 };
 
 struct AVFilterInternal {
@@ -384,6 +390,12 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter accesses other filters of its graph (e.g. by sending them
+ * commands), so it must never be activated concurrently with another filter.
+ */
+#define FF_FILTER_FLAG_GRAPH_ACCESS (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_LUT3D_H
+#define AVFILTER_LUT3D_H
+
+#include <stddef.h>
+
+enum interp_mode {
+    INTERPOLATE_NEAREST,
+    INTERPOLATE_TRILINEAR,
+    INTERPOLATE_TETRAHEDRAL,
+    NB_INTERP_MODE
+};
+
+struct rgbvec {
+    float r, g, b;
+};
+
+/* 3D LUT don't often go up to level 32, but it is common to have a Hald CLUT
+ * of 512x512 (64x64x64) */
+#define MAX_LEVEL 128
+
+typedef struct LUT3DDSPContext {
+    /**
+     * Interpolate a row of colors in place.
+     *
+     * @param buf     the r, g and b planes of the row, scaled to LUT coordinates
+     *                between 0 and lutsize - 1 on input, replaced by the
+     *                interpolated colors; 32-byte aligned, and holding w
+     *                rounded up to a multiple of 8 valid coordinates per plane
+     * @param stride  distance between the planes in bytes, multiple of 32
+     * @param w       number of pixels, > 0
+     * @param lut     MAX_LEVEL x MAX_LEVEL x MAX_LEVEL table, indexed by r, g, b
+     * @param lutsize number of levels used in each dimension of lut
+     */
+    void (*interp[NB_INTERP_MODE])(float *buf, ptrdiff_t stride, int w,
+                                   const struct rgbvec *lut, int lutsize);
+} LUT3DDSPContext;
+
+void ff_lut3d_dsp_init(LUT3DDSPContext *dsp);
+
+#endif /* AVFILTER_LUT3D_H */
@@ -38,6 +38,9 @@ typedef struct ThreadContext {
     AVSliceThread *thread;
     avfilter_action_func *func;
 
+    /* filters activated in parallel may execute jobs at the same time */
+    pthread_mutex_t lock;
+
     /* per-execute parameters */
     AVFilterContext *ctx;
     void *arg;
@@ -52,9 +55,16 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+typedef struct SchedContext {
+    AVSliceThread *thread;
+    AVFilterContext **filters;
+    int *rets;
+} SchedContext;
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    pthread_mutex_destroy(&c->lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -64,21 +74,34 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+
+    pthread_mutex_lock(&c->lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    pthread_mutex_unlock(&c->lock);
     return 0;
 }
 
-static int thread_init_internal(ThreadContext *c, int nb_threads)
+static int thread_init_internal(ThreadContext *c, int nb_threads, int priority)
 {
+    int ret;
+
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
-    if (nb_threads <= 1)
+    if (nb_threads <= 1) {
         avpriv_slicethread_free(&c->thread);
-    return FFMAX(nb_threads, 1);
+        return FFMAX(nb_threads, 1);
+    }
+    avpriv_slicethread_set_priority(c->thread, priority);
+
+    if ((ret = pthread_mutex_init(&c->lock, NULL))) {
+        avpriv_slicethread_free(&c->thread);
+        return AVERROR(ret);
+    }
+    return nb_threads;
 }
 
 int ff_graph_thread_init(AVFilterGraph *graph)
@@ -94,7 +117,8 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     if (!graph->internal->thread)
         return AVERROR(ENOMEM);
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(graph->internal->thread, graph->nb_threads,
+                               graph->thread_priority);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
@@ -114,3 +138,73 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+static void sched_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    SchedContext *s = priv;
+    s->rets[jobnr] = ff_filter_activate(s->filters[jobnr]);
+}
+
+int ff_graph_sched_init(AVFilterGraph *graph)
+{
+    SchedContext *s;
+    int ret;
+
+    if (graph->graph_threads <= 1 || graph->internal->sched)
+        return 0;
+
+    s = av_mallocz(sizeof(*s));
+    if (!s)
+        return AVERROR(ENOMEM);
+
+    ret = avpriv_slicethread_create(&s->thread, s, sched_worker_func, NULL,
+                                    graph->graph_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&s->thread);
+        av_free(s);
+        return FFMIN(ret, 0);
+    }
+    avpriv_slicethread_set_priority(s->thread, graph->thread_priority);
+
+    s->rets = av_malloc_array(ret, sizeof(*s->rets));
+    graph->internal->sched_batch = av_malloc_array(ret, sizeof(*graph->internal->sched_batch));
+    if (!s->rets || !graph->internal->sched_batch) {
+        avpriv_slicethread_free(&s->thread);
+        av_freep(&s->rets);
+        av_freep(&graph->internal->sched_batch);
+        av_free(s);
+        return AVERROR(ENOMEM);
+    }
+
+    graph->graph_threads   = ret;
+    graph->internal->sched = s;
+    return 0;
+}
+
+void ff_graph_sched_free(AVFilterGraph *graph)
+{
+    SchedContext *s = graph->internal->sched;
+
+    if (!s)
+        return;
+
+    avpriv_slicethread_free(&s->thread);
+    av_freep(&s->rets);
+    av_freep(&graph->internal->sched_batch);
+    av_freep(&graph->internal->sched);
+}
+
+int ff_graph_sched_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                           int nb_filters)
+{
+    SchedContext *s = graph->internal->sched;
+    int i;
+
+    s->filters = filters;
+    avpriv_slicethread_execute(s->thread, nb_filters, 0);
+
+    for (i = 0; i < nb_filters; i++)
+        if (s->rets[i] < 0)
+            return s->rets[i];
+    return 0;
+}
@@ -25,4 +25,21 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Set up the worker threads used to activate independent filters of the
+ * graph in parallel, if graph_threads is greater than one.
+ */
+int ff_graph_sched_init(AVFilterGraph *graph);
+
+void ff_graph_sched_free(AVFilterGraph *graph);
+
+/**
+ * Activate the given filters concurrently. The filters must not share any
+ * link.
+ *
+ * @return the first error returned by a filter activation, 0 otherwise
+ */
+int ff_graph_sched_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                           int nb_filters);
+
 #endif /* AVFILTER_THREAD_H */
@@ -40,6 +40,11 @@ typedef struct DRContext {
     DNNModel          *model;
     DNNInputData       input;
     DNNData            output;
+    int                async;
+    int                batch_size;
+    // frames queued since the last flush, and not yet output
+    int                nb_queued;
+    int                nb_inflight;
 } DRContext;
 
 #define CLIP(x, min, max) (x < min ? min : (x > max ? max : x))
@@ -52,6 +57,8 @@ static const AVOption derain_options[] = {
     { "tensorflow",  "tensorflow backend flag", 0,                      AV_OPT_TYPE_CONST,  { .i64 = 1 },    0, 0, FLAGS, "backend" },
 #endif
     { "model",       "path to model file",      OFFSET(model_filename), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { "async",       "execute the model asynchronously",   OFFSET(async),      AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0,  1, FLAGS },
+    { "batch_size",  "number of frames executed together", OFFSET(batch_size), AV_OPT_TYPE_INT,  { .i64 = 1 }, 1, 64, FLAGS },
     { NULL }
 };
 
@@ -90,12 +97,9 @@ static int config_inputs(AVFilterLink *inlink)
     return 0;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+static int output_frame(AVFilterContext *ctx, AVFrame *in, const DNNData *output)
 {
-    AVFilterContext *ctx  = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
-    DRContext *dr_context = ctx->priv;
-    DNNReturnType dnn_result;
     int pad_size;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -107,6 +111,63 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     av_frame_copy_props(out, in);
 
+    out->height = output->height;
+    out->width  = output->width;
+    outlink->h  = output->height;
+    outlink->w  = output->width;
+    pad_size    = (in->height - out->height) >> 1;
+
+    for (int i = 0; i < out->height; i++){
+        for(int j = 0; j < out->width * 3; j++){
+            int k = i * out->linesize[0] + j;
+            int t = i * out->width * 3 + j;
+
+            int k_in = (i + pad_size) * in->linesize[0] + j + pad_size * 3;
+            float input = in->data[0][k_in] / 255.0;
+            out->data[0][k] = CLIP((int)((input - output->data[t]) * 255), 0, 255);
+        }
+    }
+
+    av_frame_free(&in);
+
+    return ff_filter_frame(outlink, out);
+}
+
+// Output the frames whose execution is finished, waiting for them until at
+// most max_inflight frames are left.
+static int output_results(AVFilterContext *ctx, int max_inflight)
+{
+    DRContext *dr_context = ctx->priv;
+    DNNAsyncStatusType status;
+    DNNData output;
+    void *opaque;
+    int ret;
+
+    while ((status = (dr_context->dnn_module->get_async_result)(dr_context->model, &output, &opaque,
+                                                                 dr_context->nb_inflight > max_inflight)) != DAST_EMPTY_QUEUE &&
+           status != DAST_NOT_READY) {
+        AVFrame *in = opaque;
+
+        dr_context->nb_inflight--;
+        if (status != DAST_SUCCESS) {
+            av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+            av_frame_free(&in);
+            return AVERROR(EIO);
+        }
+        ret = output_frame(ctx, in, &output);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx  = inlink->dst;
+    DRContext *dr_context = ctx->priv;
+    DNNReturnType dnn_result;
+
     for (int i = 0; i < in->height; i++){
         for(int j = 0; j < in->width * 3; j++){
             int k = i * in->linesize[0] + j;
@@ -115,31 +176,45 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         }
     }
 
+    if (dr_context->async) {
+        dnn_result = (dr_context->dnn_module->execute_model_async)(dr_context->model, in);
+        if (dnn_result != DNN_SUCCESS) {
+            av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+            av_frame_free(&in);
+            return AVERROR(EIO);
+        }
+        dr_context->nb_inflight++;
+        if (++dr_context->nb_queued == dr_context->batch_size) {
+            (dr_context->dnn_module->flush)(dr_context->model);
+            dr_context->nb_queued = 0;
+        }
+
+        // one batch may be executed while the next one is queued
+        return output_results(ctx, 2 * dr_context->batch_size - 1);
+    }
+
     dnn_result = (dr_context->dnn_module->execute_model)(dr_context->model, &dr_context->output, 1);
     if (dnn_result != DNN_SUCCESS){
         av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+        av_frame_free(&in);
         return AVERROR(EIO);
     }
 
-    out->height = dr_context->output.height;
-    out->width  = dr_context->output.width;
-    outlink->h  = dr_context->output.height;
-    outlink->w  = dr_context->output.width;
-    pad_size    = (in->height - out->height) >> 1;
+    return output_frame(ctx, in, &dr_context->output);
+}
 
-    for (int i = 0; i < out->height; i++){
-        for(int j = 0; j < out->width * 3; j++){
-            int k = i * out->linesize[0] + j;
-            int t = i * out->width * 3 + j;
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx  = outlink->src;
+    DRContext *dr_context = ctx->priv;
+    int ret;
 
-            int t_in =  (i + pad_size) * in->width * 3 + j + pad_size * 3;
-            out->data[0][k] = CLIP((int)((((float *)dr_context->input.data)[t_in] - dr_context->output.data[t]) * 255), 0, 255);
-        }
-    }
+    ret = ff_request_frame(ctx->inputs[0]);
 
-    av_frame_free(&in);
+    if (ret == AVERROR_EOF && dr_context->nb_inflight)
+        ret = output_results(ctx, 0);
 
-    return ff_filter_frame(outlink, out);
+    return ret;
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -166,6 +241,10 @@ static av_cold int init(AVFilterContext *ctx)
         av_log(ctx, AV_LOG_ERROR, "could not load DNN model\n");
         return AVERROR(EINVAL);
     }
+    if (dr_context->async && !dr_context->dnn_module->execute_model_async) {
+        av_log(ctx, AV_LOG_VERBOSE, "asynchronous execution is not supported by the DNN backend\n");
+        dr_context->async = 0;
+    }
 
     return 0;
 }
@@ -175,6 +254,15 @@ static av_cold void uninit(AVFilterContext *ctx)
     DRContext *dr_context = ctx->priv;
 
     if (dr_context->dnn_module) {
+        if (dr_context->async && dr_context->model) {
+            DNNData output;
+            void *opaque;
+
+            while ((dr_context->dnn_module->get_async_result)(dr_context->model, &output, &opaque, 1) != DAST_EMPTY_QUEUE) {
+                AVFrame *in = opaque;
+                av_frame_free(&in);
+            }
+        }
         (dr_context->dnn_module->free_model)(&dr_context->model);
         av_freep(&dr_context->dnn_module);
     }
@@ -192,8 +280,9 @@ static const AVFilterPad derain_inputs[] = {
 
 static const AVFilterPad derain_outputs[] = {
     {
-        .name = "default",
-        .type = AVMEDIA_TYPE_VIDEO,
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .request_frame = request_frame,
     },
     { NULL }
 };
@@ -225,6 +225,44 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int blocks_x, blocks_y;
+} ThreadData;
+
+/**
+ * Find the motion vectors of a band of block rows. Blocks with too low a
+ * contrast get the same (-1, -1) vector as the blocks without any match.
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    const ThreadData *td = arg;
+    const int slice_start = (td->blocks_y *  jobnr   ) / nb_jobs;
+    const int slice_end   = (td->blocks_y * (jobnr+1)) / nb_jobs;
+    IntMotionVector mv = {0, 0};
+    int i, j, x, y;
+
+    for (j = slice_start; j < slice_end; j++) {
+        IntMotionVector *mvs = deshake->mvs + j * td->blocks_x;
+
+        y = deshake->ry + j * deshake->blocksize * 2;
+        for (i = 0; i < td->blocks_x; i++) {
+            x = deshake->rx + i * 16;
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mv);
+                mvs[i] = mv;
+            } else {
+                mvs[i].x = mvs[i].y = -1;
+            }
+        }
+    }
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,19 +270,33 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData td;
+    int x, y, i, j;
     int count_max_value = 0;
-    int contrast;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
-    av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    td.src1     = src1;
+    td.src2     = src2;
+    td.stride   = stride;
+    td.blocks_x = 0;
+    td.blocks_y = 0;
+    // We use a width of 16 here to match the sad function
+    for (x = deshake->rx; x < width - deshake->rx - 16; x += 16)
+        td.blocks_x++;
+    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2)
+        td.blocks_y++;
+
+    av_fast_malloc(&deshake->angles, &deshake->angles_size, FFMAX(width * height / (16 * deshake->blocksize), 1) * sizeof(*deshake->angles));
+    av_fast_malloc(&deshake->mvs, &deshake->mvs_size, FFMAX(td.blocks_x * td.blocks_y, 1) * sizeof(*deshake->mvs));
+    if (!deshake->angles || !deshake->mvs)
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -253,25 +305,33 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // Find motion for every block. The smart search of a block starts from
+    // the vector of the previous one when the search range is empty in one
+    // direction, so it has to run in a single job then.
+    if (td.blocks_y) {
+        const int single = deshake->search == SMART_EXHAUSTIVE &&
+                           (deshake->rx < 1 || deshake->ry < 1);
+        ctx->internal->execute(ctx, find_motion_slice, &td, NULL,
+                               single ? 1 : FFMIN(td.blocks_y, ff_filter_get_nb_threads(ctx)));
+    }
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    // Store the motion vectors in the counts, in raster order
+    for (j = 0; j < td.blocks_y; j++) {
+        const IntMotionVector *mvs = deshake->mvs + j * td.blocks_x;
+
+        y = deshake->ry + j * deshake->blocksize * 2;
+        for (i = 0; i < td.blocks_x; i++) {
+            IntMotionVector mv = mvs[i];
+
+            x = deshake->rx + i * 16;
+            if (mv.x != -1 && mv.y != -1) {
+                deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+
+                center_x += mv.x;
+                center_y += mv.y;
             }
         }
     }
@@ -310,6 +370,7 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -402,6 +463,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     DeshakeContext *deshake = ctx->priv;
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
+    av_freep(&deshake->mvs);
     deshake->angles_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
@@ -436,7 +498,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -453,7 +515,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        av_frame_free(&out);
+        return ret;
     }
 
 
@@ -557,4 +624,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
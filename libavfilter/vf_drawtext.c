@@ -160,6 +160,9 @@ typedef struct DrawTextContext {
     int y;                          ///< y position to start drawing text
     int max_glyph_w;                ///< max glyph width
     int max_glyph_h;                ///< max glyph height
+    int text_w, text_h;             ///< size of the laid out text
+    int ascent, descent;            ///< max glyph ascent and descent of the laid out text
+    int text_top, text_bottom;      ///< vertical extent of the glyph bitmaps, relative to y
     int shadowx, shadowy;
     int borderw;                    ///< border width
     char *fontsize_expr;            ///< expression for fontsize
@@ -183,7 +186,7 @@ typedef struct DrawTextContext {
     FT_Library library;             ///< freetype font library handle
     FT_Face face;                   ///< freetype font face handle
     FT_Stroker stroker;             ///< freetype stroker handle
-    struct AVTreeNode *glyphs;      ///< rendered glyphs, stored using the UTF-32 char code
+    struct AVTreeNode *glyphs;      ///< rendered glyphs, stored using the UTF-32 char code and font size
     char *x_expr;                   ///< expression for x position
     char *y_expr;                   ///< expression for y position
     AVExpr *x_pexpr, *y_pexpr;      ///< parsed expressions for x and y
@@ -203,6 +206,9 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+
+    char *layout_text;              ///< text the positions were computed for
+    unsigned int layout_fontsize;   ///< font size the positions were computed for
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -381,6 +387,27 @@ error:
     return ret;
 }
 
+/**
+ * Get the glyph of the UTF-32 codepoint code at the current font size,
+ * loading it if it is not cached yet.
+ */
+static int get_glyph(AVFilterContext *ctx, Glyph **glyph_ptr, uint32_t code)
+{
+    DrawTextContext *s = ctx->priv;
+    Glyph dummy = { 0 };
+    Glyph *glyph;
+
+    dummy.code     = code;
+    dummy.fontsize = s->fontsize;
+    glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+    if (!glyph)
+        return load_glyph(ctx, glyph_ptr, code);
+
+    if (glyph_ptr)
+        *glyph_ptr = glyph;
+    return 0;
+}
+
 static av_cold int set_fontsize(AVFilterContext *ctx, unsigned int fontsize)
 {
     int err;
@@ -698,7 +725,8 @@ static av_cold int init(AVFilterContext *ctx)
     s->fontsize_pexpr = NULL;
 
     s->fontsize = 0;
-    s->default_fontsize = 16;
+    if (!s->face)
+        s->default_fontsize = 16;
 
     if (!s->fontfile && !CONFIG_LIBFONTCONFIG) {
         av_log(ctx, AV_LOG_ERROR, "No font filename provided\n");
@@ -741,19 +769,22 @@ static av_cold int init(AVFilterContext *ctx)
             return err;
 #endif
 
-    if ((err = FT_Init_FreeType(&(s->library)))) {
-        av_log(ctx, AV_LOG_ERROR,
-               "Could not load FreeType: %s\n", FT_ERRMSG(err));
-        return AVERROR(EINVAL);
-    }
+    /* the font may have been kept from before a reinit, with its glyphs */
+    if (!s->face) {
+        if ((err = FT_Init_FreeType(&(s->library)))) {
+            av_log(ctx, AV_LOG_ERROR,
+                   "Could not load FreeType: %s\n", FT_ERRMSG(err));
+            return AVERROR(EINVAL);
+        }
 
-    if ((err = load_font(ctx)) < 0)
-        return err;
+        if ((err = load_font(ctx)) < 0)
+            return err;
+    }
 
     if ((err = update_fontsize(ctx)) < 0)
         return err;
 
-    if (s->borderw) {
+    if (s->borderw && !s->stroker) {
         if (FT_Stroker_New(s->library, &s->stroker)) {
             av_log(ctx, AV_LOG_ERROR, "Coult not init FT stroker\n");
             return AVERROR_EXTERNAL;
@@ -765,10 +796,10 @@ static av_cold int init(AVFilterContext *ctx)
     s->use_kerning = FT_HAS_KERNING(s->face);
 
     /* load the fallback glyph with code 0 */
-    load_glyph(ctx, NULL, 0);
+    get_glyph(ctx, NULL, 0);
 
     /* set the tabsize in pixels */
-    if ((err = load_glyph(ctx, &glyph, ' ')) < 0) {
+    if ((err = get_glyph(ctx, &glyph, ' ')) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Could not set tabsize.\n");
         return err;
     }
@@ -821,6 +852,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     FT_Stroker_Done(s->stroker);
     FT_Done_FreeType(s->library);
 
+    av_freep(&s->layout_text);
+
     av_bprint_finalize(&s->expanded_text, NULL);
     av_bprint_finalize(&s->expanded_fontcolor, NULL);
 }
@@ -866,11 +899,45 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+static int str_equal(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp(a, b));
+}
+
+/**
+ * Check if the font loaded by old and the glyphs rendered from it can be
+ * used with the options of new.
+ */
+static int same_font(const DrawTextContext *old, const DrawTextContext *new)
+{
+#if CONFIG_LIBFONTCONFIG
+    if (!str_equal(old->font, new->font) ||
+        !str_equal(old->fontsize_expr, new->fontsize_expr))
+        return 0;
+#endif
+    return str_equal(old->fontfile, new->fontfile) &&
+           old->ft_load_flags == new->ft_load_flags &&
+           old->borderw == new->borderw;
+}
+
+static void move_font(DrawTextContext *dst, DrawTextContext *src)
+{
+    dst->library          = src->library;
+    dst->face             = src->face;
+    dst->stroker          = src->stroker;
+    dst->glyphs           = src->glyphs;
+    dst->default_fontsize = src->default_fontsize;
+    src->library = NULL;
+    src->face    = NULL;
+    src->stroker = NULL;
+    src->glyphs  = NULL;
+}
+
 static int command(AVFilterContext *ctx, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     DrawTextContext *old = ctx->priv;
     DrawTextContext *new = NULL;
-    int ret;
+    int ret, keep_font;
 
     if (!strcmp(cmd, "reinit")) {
         new = av_mallocz(sizeof(DrawTextContext));
@@ -889,8 +956,17 @@ static int command(AVFilterContext *ctx, const char *cmd, const char *arg, char
             goto fail;
         }
 
+        keep_font = same_font(old, new);
+        if (keep_font)
+            move_font(new, old);
+
         ret = init(ctx);
         if (ret < 0) {
+            if (keep_font) {
+                move_font(old, new);
+                /* the face may have been set to another size */
+                old->fontsize = 0;
+            }
             uninit(ctx);
             ctx->priv = old;
             goto fail;
@@ -1209,10 +1285,10 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+static void draw_glyphs(DrawTextContext *s, uint8_t *data[], int linesize[],
+                        int width, int height,
+                        FFDrawColor *color,
+                        int x, int y, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
@@ -1226,7 +1302,7 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         GET_UTF8(code, *p++, continue;);
 
         /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (is_newline(code) || code == '\t')
             continue;
 
         dummy.code = code;
@@ -1235,25 +1311,18 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
 
         bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
-
         x1 = s->positions[i].x+s->x+x - borderw;
         y1 = s->positions[i].y+s->y+y - borderw;
 
         ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
+                      data, linesize, width, height,
                       bitmap.buffer, bitmap.pitch,
                       bitmap.width, bitmap.rows,
                       bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
                       0, x1, y1);
     }
-
-    return 0;
 }
 
-
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
     *color = incolor;
@@ -1276,17 +1345,17 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+/**
+ * Load the glyphs of the expanded text and compute their positions,
+ * unless the text and font size did not change since the last frame.
+ */
+static int layout_text(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
-
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text;
+    char *text = s->expanded_text.str;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -1294,44 +1363,12 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
-
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
+    if (s->layout_text && s->layout_fontsize == s->fontsize &&
+        !strcmp(s->layout_text, text))
+        return 0;
 
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
+    av_freep(&s->layout_text);
 
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
@@ -1339,39 +1376,17 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->nb_positions = len;
     }
 
-    if (s->fontcolor_expr[0]) {
-        /* If expression is set, evaluate and replace the static value */
-        av_bprint_clear(&s->expanded_fontcolor);
-        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
-            return ret;
-        if (!av_bprint_is_complete(&s->expanded_fontcolor))
-            return AVERROR(ENOMEM);
-        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
-        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
-        if (ret)
-            return ret;
-        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
-    }
-
-    x = 0;
-    y = 0;
-
-    if ((ret = update_fontsize(ctx)) < 0)
-        return ret;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
 
         /* get glyph */
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-        if (!glyph) {
-            ret = load_glyph(ctx, &glyph, code);
-            if (ret < 0)
-                return ret;
-        }
+        if ((ret = get_glyph(ctx, &glyph, code)) < 0)
+            return ret;
+
+        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+            return AVERROR(EINVAL);
 
         y_min = FFMIN(glyph->bbox.yMin, y_min);
         y_max = FFMAX(glyph->bbox.yMax, y_max);
@@ -1383,6 +1398,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     /* compute and save position for each glyph */
     glyph = NULL;
+    s->text_top = s->text_bottom = 0;
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
 
@@ -1417,17 +1433,151 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->positions[i].y = y - glyph->bitmap_top + y_max;
         if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
         else              x += glyph->advance;
+
+        /* rows covered by the glyph and its border */
+        s->text_top    = FFMIN(s->text_top, s->positions[i].y - s->borderw);
+        s->text_bottom = FFMAX(s->text_bottom, s->positions[i].y + (int)glyph->bitmap.rows);
+        if (s->borderw)
+            s->text_bottom = FFMAX(s->text_bottom, s->positions[i].y - s->borderw +
+                                                   (int)glyph->border_bitmap.rows);
     }
 
-    max_text_line_w = FFMAX(x, max_text_line_w);
+    s->text_w  = FFMAX(x, max_text_line_w);
+    s->text_h  = y + s->max_glyph_h;
+    s->ascent  = y_max;
+    s->descent = y_min;
+
+    if (!(s->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+    s->layout_fontsize = s->fontsize;
+
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    FFDrawColor *fontcolor, *shadowcolor, *bordercolor, *boxcolor;
+    int box_w, box_h;
+    int y, h;                       ///< rows of the frame covered by the text
+} ThreadData;
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    /* keep the slices aligned to the chroma rows */
+    const int align = 1 << s->dc.vsub_max;
+    const int slice_start = td->y + ((td->h *  jobnr     ) / nb_jobs & ~(align - 1));
+    const int slice_end   = jobnr == nb_jobs - 1 ? td->y + td->h :
+                            td->y + ((td->h * (jobnr + 1)) / nb_jobs & ~(align - 1));
+    const int width = frame->width, height = slice_end - slice_start;
+    uint8_t *data[MAX_PLANES] = { NULL };
+    int plane;
+
+    if (height <= 0)
+        return 0;
+
+    for (plane = 0; plane < s->dc.nb_planes; plane++)
+        data[plane] = frame->data[plane] +
+                      (slice_start >> s->dc.vsub[plane]) * frame->linesize[plane];
+
+    /* draw box */
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, td->boxcolor,
+                           data, frame->linesize, width, height,
+                           s->x - s->boxborderw, s->y - s->boxborderw - slice_start,
+                           td->box_w + s->boxborderw * 2, td->box_h + s->boxborderw * 2);
+
+    if (s->shadowx || s->shadowy)
+        draw_glyphs(s, data, frame->linesize, width, height, td->shadowcolor,
+                    s->shadowx, s->shadowy - slice_start, 0);
+
+    if (s->borderw)
+        draw_glyphs(s, data, frame->linesize, width, height, td->bordercolor,
+                    0, -slice_start, s->borderw);
+
+    draw_glyphs(s, data, frame->linesize, width, height, td->fontcolor,
+                0, -slice_start, 0);
+
+    return 0;
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
 
-    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
-    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
+    int ret, y0, y1, nb_jobs;
+    const int align = 1 << s->dc.vsub_max;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+    ThreadData td;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
+    }
+
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+
+    if (s->fontcolor_expr[0]) {
+        /* If expression is set, evaluate and replace the static value */
+        av_bprint_clear(&s->expanded_fontcolor);
+        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
+            return ret;
+        if (!av_bprint_is_complete(&s->expanded_fontcolor))
+            return AVERROR(ENOMEM);
+        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
+        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
+        if (ret)
+            return ret;
+        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
+    }
+
+    if ((ret = update_fontsize(ctx)) < 0)
+        return ret;
+
+    if ((ret = layout_text(ctx)) < 0)
+        return ret;
+
+    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = s->text_w;
+    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = s->text_h;
 
     s->var_values[VAR_MAX_GLYPH_W] = s->max_glyph_w;
     s->var_values[VAR_MAX_GLYPH_H] = s->max_glyph_h;
-    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = y_max;
-    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = y_min;
+    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = s->ascent;
+    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = s->descent;
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
@@ -1442,8 +1592,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     update_color_with_alpha(s, &bordercolor, s->bordercolor);
     update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
 
-    box_w = max_text_line_w;
-    box_h = y + s->max_glyph_h;
+    td.box_w = s->text_w;
+    td.box_h = s->text_h;
 
     if (s->fix_bounds) {
 
@@ -1465,33 +1615,33 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         if (s->x - offsetleft < 0) s->x = offsetleft;
         if (s->y - offsettop < 0)  s->y = offsettop;
 
-        if (s->x + box_w + offsetright > width)
-            s->x = FFMAX(width - box_w - offsetright, 0);
-        if (s->y + box_h + offsetbottom > height)
-            s->y = FFMAX(height - box_h - offsetbottom, 0);
+        if (s->x + td.box_w + offsetright > width)
+            s->x = FFMAX(width - td.box_w - offsetright, 0);
+        if (s->y + td.box_h + offsetbottom > height)
+            s->y = FFMAX(height - td.box_h - offsetbottom, 0);
     }
 
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
+    /* only the rows covered by the text are split between the threads */
+    y0 = s->y + FFMIN(s->text_top, s->text_top + s->shadowy);
+    y1 = s->y + FFMAX(s->text_bottom, s->text_bottom + s->shadowy);
+    if (s->draw_box) {
+        y0 = FFMIN(y0, s->y - s->boxborderw);
+        y1 = FFMAX(y1, s->y + td.box_h + s->boxborderw);
     }
+    y0 = FFMAX(y0, 0) & ~(align - 1);
+    y1 = FFMIN(y1, height);
+    if (y1 <= y0)
+        return 0;
 
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    td.frame       = frame;
+    td.fontcolor   = &fontcolor;
+    td.shadowcolor = &shadowcolor;
+    td.bordercolor = &bordercolor;
+    td.boxcolor    = &boxcolor;
+    td.y           = y0;
+    td.h           = y1 - y0;
+    nb_jobs = FFMIN(ff_filter_get_nb_threads(ctx), (td.h + align - 1) / align);
+    ctx->internal->execute(ctx, draw_text_slice, &td, NULL, nb_jobs);
 
     return 0;
 }
@@ -1567,5 +1717,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
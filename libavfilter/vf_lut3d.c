@@ -35,6 +35,7 @@
 #include "formats.h"
 #include "framesync.h"
 #include "internal.h"
+#include "lut3d.h"
 #include "video.h"
 
 #define R 0
@@ -42,21 +43,6 @@
 #define B 2
 #define A 3
 
-enum interp_mode {
-    INTERPOLATE_NEAREST,
-    INTERPOLATE_TRILINEAR,
-    INTERPOLATE_TETRAHEDRAL,
-    NB_INTERP_MODE
-};
-
-struct rgbvec {
-    float r, g, b;
-};
-
-/* 3D LUT don't often go up to level 32, but it is common to have a Hald CLUT
- * of 512x512 (64x64x64) */
-#define MAX_LEVEL 128
-
 typedef struct LUT3DContext {
     const AVClass *class;
     int interpolation;          ///<interp_mode
@@ -67,6 +53,16 @@ typedef struct LUT3DContext {
     struct rgbvec scale;
     struct rgbvec lut[MAX_LEVEL][MAX_LEVEL][MAX_LEVEL];
     int lutsize;
+    LUT3DDSPContext dsp;
+
+    int use_int_lut;
+    int int_interp;             ///< the integer LUT is used for the input format
+    int32_t *int_lut;           ///< lutsize^3 r, g, b colors in 1/256 of 8-bit levels
+    unsigned int int_lut_size;
+    int int_prev[3][256];       ///< offsets in int_lut of the levels around each input value
+    int int_next[3][256];
+    int int_near[3][256];
+    int int_frac[3][256];       ///< weights of the next levels, INT_FRAC_BITS fractions
 #if CONFIG_HALDCLUT_FILTER
     uint8_t clut_rgba_map[4];
     int clut_step;
@@ -88,6 +84,7 @@ typedef struct ThreadData {
         { "nearest",     "use values from the nearest defined points",            0, AV_OPT_TYPE_CONST, {.i64=INTERPOLATE_NEAREST},     INT_MIN, INT_MAX, FLAGS, "interp_mode" }, \
         { "trilinear",   "interpolate values using the 8 points defining a cube", 0, AV_OPT_TYPE_CONST, {.i64=INTERPOLATE_TRILINEAR},   INT_MIN, INT_MAX, FLAGS, "interp_mode" }, \
         { "tetrahedral", "interpolate values using a tetrahedron",                0, AV_OPT_TYPE_CONST, {.i64=INTERPOLATE_TETRAHEDRAL}, INT_MIN, INT_MAX, FLAGS, "interp_mode" }, \
+    { "int_lut", "interpolate 8-bit input with a precomputed integer LUT", OFFSET(use_int_lut), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS }, \
     { NULL }
 
 static inline float lerpf(float v0, float v1, float f)
@@ -105,35 +102,35 @@ static inline struct rgbvec lerp(const struct rgbvec *v0, const struct rgbvec *v
 
 #define NEAR(x) ((int)((x) + .5))
 #define PREV(x) ((int)(x))
-#define NEXT(x) (FFMIN((int)(x) + 1, lut3d->lutsize - 1))
+#define NEXT(x) (FFMIN((int)(x) + 1, lutsize - 1))
 
 /**
  * Get the nearest defined point
  */
-static inline struct rgbvec interp_nearest(const LUT3DContext *lut3d,
-                                           const struct rgbvec *s)
+static inline struct rgbvec interp_nearest(const struct rgbvec (*lut)[MAX_LEVEL][MAX_LEVEL],
+                                           int lutsize, const struct rgbvec *s)
 {
-    return lut3d->lut[NEAR(s->r)][NEAR(s->g)][NEAR(s->b)];
+    return lut[NEAR(s->r)][NEAR(s->g)][NEAR(s->b)];
 }
 
 /**
  * Interpolate using the 8 vertices of a cube
  * @see https://en.wikipedia.org/wiki/Trilinear_interpolation
  */
-static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
-                                             const struct rgbvec *s)
+static inline struct rgbvec interp_trilinear(const struct rgbvec (*lut)[MAX_LEVEL][MAX_LEVEL],
+                                             int lutsize, const struct rgbvec *s)
 {
     const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
     const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
     const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0]][prev[1]][prev[2]];
-    const struct rgbvec c001 = lut3d->lut[prev[0]][prev[1]][next[2]];
-    const struct rgbvec c010 = lut3d->lut[prev[0]][next[1]][prev[2]];
-    const struct rgbvec c011 = lut3d->lut[prev[0]][next[1]][next[2]];
-    const struct rgbvec c100 = lut3d->lut[next[0]][prev[1]][prev[2]];
-    const struct rgbvec c101 = lut3d->lut[next[0]][prev[1]][next[2]];
-    const struct rgbvec c110 = lut3d->lut[next[0]][next[1]][prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0]][next[1]][next[2]];
+    const struct rgbvec c000 = lut[prev[0]][prev[1]][prev[2]];
+    const struct rgbvec c001 = lut[prev[0]][prev[1]][next[2]];
+    const struct rgbvec c010 = lut[prev[0]][next[1]][prev[2]];
+    const struct rgbvec c011 = lut[prev[0]][next[1]][next[2]];
+    const struct rgbvec c100 = lut[next[0]][prev[1]][prev[2]];
+    const struct rgbvec c101 = lut[next[0]][prev[1]][next[2]];
+    const struct rgbvec c110 = lut[next[0]][next[1]][prev[2]];
+    const struct rgbvec c111 = lut[next[0]][next[1]][next[2]];
     const struct rgbvec c00  = lerp(&c000, &c100, d.r);
     const struct rgbvec c10  = lerp(&c010, &c110, d.r);
     const struct rgbvec c01  = lerp(&c001, &c101, d.r);
@@ -148,51 +145,51 @@ static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
  * Tetrahedral interpolation. Based on code found in Truelight Software Library paper.
  * @see http://www.filmlight.ltd.uk/pdf/whitepapers/FL-TL-TN-0057-SoftwareLib.pdf
  */
-static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
-                                               const struct rgbvec *s)
+static inline struct rgbvec interp_tetrahedral(const struct rgbvec (*lut)[MAX_LEVEL][MAX_LEVEL],
+                                               int lutsize, const struct rgbvec *s)
 {
     const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
     const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
     const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0]][prev[1]][prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0]][next[1]][next[2]];
+    const struct rgbvec c000 = lut[prev[0]][prev[1]][prev[2]];
+    const struct rgbvec c111 = lut[next[0]][next[1]][next[2]];
     struct rgbvec c;
     if (d.r > d.g) {
         if (d.g > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0]][prev[1]][prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0]][next[1]][prev[2]];
+            const struct rgbvec c100 = lut[next[0]][prev[1]][prev[2]];
+            const struct rgbvec c110 = lut[next[0]][next[1]][prev[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.g) * c100.r + (d.g-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.g) * c100.g + (d.g-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.g) * c100.b + (d.g-d.b) * c110.b + (d.b) * c111.b;
         } else if (d.r > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0]][prev[1]][prev[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0]][prev[1]][next[2]];
+            const struct rgbvec c100 = lut[next[0]][prev[1]][prev[2]];
+            const struct rgbvec c101 = lut[next[0]][prev[1]][next[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.b) * c100.r + (d.b-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.b) * c100.g + (d.b-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.b) * c100.b + (d.b-d.g) * c101.b + (d.g) * c111.b;
         } else {
-            const struct rgbvec c001 = lut3d->lut[prev[0]][prev[1]][next[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0]][prev[1]][next[2]];
+            const struct rgbvec c001 = lut[prev[0]][prev[1]][next[2]];
+            const struct rgbvec c101 = lut[next[0]][prev[1]][next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.r) * c001.r + (d.r-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.r) * c001.g + (d.r-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.r) * c001.b + (d.r-d.g) * c101.b + (d.g) * c111.b;
         }
     } else {
         if (d.b > d.g) {
-            const struct rgbvec c001 = lut3d->lut[prev[0]][prev[1]][next[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0]][next[1]][next[2]];
+            const struct rgbvec c001 = lut[prev[0]][prev[1]][next[2]];
+            const struct rgbvec c011 = lut[prev[0]][next[1]][next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.g) * c001.r + (d.g-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.g) * c001.g + (d.g-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.g) * c001.b + (d.g-d.r) * c011.b + (d.r) * c111.b;
         } else if (d.b > d.r) {
-            const struct rgbvec c010 = lut3d->lut[prev[0]][next[1]][prev[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0]][next[1]][next[2]];
+            const struct rgbvec c010 = lut[prev[0]][next[1]][prev[2]];
+            const struct rgbvec c011 = lut[prev[0]][next[1]][next[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.b) * c010.r + (d.b-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.b) * c010.g + (d.b-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.b) * c010.b + (d.b-d.r) * c011.b + (d.r) * c111.b;
         } else {
-            const struct rgbvec c010 = lut3d->lut[prev[0]][next[1]][prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0]][next[1]][prev[2]];
+            const struct rgbvec c010 = lut[prev[0]][next[1]][prev[2]];
+            const struct rgbvec c110 = lut[next[0]][next[1]][prev[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.r) * c010.r + (d.r-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.r) * c010.g + (d.r-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.r) * c010.b + (d.r-d.b) * c110.b + (d.b) * c111.b;
@@ -201,134 +198,380 @@ static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
     return c;
 }
 
-#define DEFINE_INTERP_FUNC_PLANAR(name, nbits, depth)                                                  \
-static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
-{                                                                                                      \
-    int x, y;                                                                                          \
-    const LUT3DContext *lut3d = ctx->priv;                                                             \
-    const ThreadData *td = arg;                                                                        \
-    const AVFrame *in  = td->in;                                                                       \
-    const AVFrame *out = td->out;                                                                      \
-    const int direct = out == in;                                                                      \
-    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                                        \
-    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                                        \
-    uint8_t *grow = out->data[0] + slice_start * out->linesize[0];                                     \
-    uint8_t *brow = out->data[1] + slice_start * out->linesize[1];                                     \
-    uint8_t *rrow = out->data[2] + slice_start * out->linesize[2];                                     \
-    uint8_t *arow = out->data[3] + slice_start * out->linesize[3];                                     \
-    const uint8_t *srcgrow = in->data[0] + slice_start * in->linesize[0];                              \
-    const uint8_t *srcbrow = in->data[1] + slice_start * in->linesize[1];                              \
-    const uint8_t *srcrrow = in->data[2] + slice_start * in->linesize[2];                              \
-    const uint8_t *srcarow = in->data[3] + slice_start * in->linesize[3];                              \
-    const float scale_r = (lut3d->scale.r / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
-    const float scale_g = (lut3d->scale.g / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
-    const float scale_b = (lut3d->scale.b / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
-                                                                                                       \
-    for (y = slice_start; y < slice_end; y++) {                                                        \
-        uint##nbits##_t *dstg = (uint##nbits##_t *)grow;                                               \
-        uint##nbits##_t *dstb = (uint##nbits##_t *)brow;                                               \
-        uint##nbits##_t *dstr = (uint##nbits##_t *)rrow;                                               \
-        uint##nbits##_t *dsta = (uint##nbits##_t *)arow;                                               \
-        const uint##nbits##_t *srcg = (const uint##nbits##_t *)srcgrow;                                \
-        const uint##nbits##_t *srcb = (const uint##nbits##_t *)srcbrow;                                \
-        const uint##nbits##_t *srcr = (const uint##nbits##_t *)srcrrow;                                \
-        const uint##nbits##_t *srca = (const uint##nbits##_t *)srcarow;                                \
-        for (x = 0; x < in->width; x++) {                                                              \
-            const struct rgbvec scaled_rgb = {srcr[x] * scale_r,                                       \
-                                              srcg[x] * scale_g,                                       \
-                                              srcb[x] * scale_b};                                      \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                     \
-            dstr[x] = av_clip_uintp2(vec.r * (float)((1<<depth) - 1), depth);                          \
-            dstg[x] = av_clip_uintp2(vec.g * (float)((1<<depth) - 1), depth);                          \
-            dstb[x] = av_clip_uintp2(vec.b * (float)((1<<depth) - 1), depth);                          \
-            if (!direct && in->linesize[3])                                                            \
-                dsta[x] = srca[x];                                                                     \
-        }                                                                                              \
-        grow += out->linesize[0];                                                                      \
-        brow += out->linesize[1];                                                                      \
-        rrow += out->linesize[2];                                                                      \
-        arow += out->linesize[3];                                                                      \
-        srcgrow += in->linesize[0];                                                                    \
-        srcbrow += in->linesize[1];                                                                    \
-        srcrrow += in->linesize[2];                                                                    \
-        srcarow += in->linesize[3];                                                                    \
-    }                                                                                                  \
-    return 0;                                                                                          \
+#define DEFINE_INTERP_ROW(name)                                             \
+static void interp_row_##name##_c(float *buf, ptrdiff_t stride, int w,      \
+                                  const struct rgbvec *lut, int lutsize)    \
+{                                                                           \
+    const struct rgbvec (*table)[MAX_LEVEL][MAX_LEVEL] = (const void *)lut; \
+    float *r = buf;                                                         \
+    float *g = (float *)((uint8_t *)buf + stride);                          \
+    float *b = (float *)((uint8_t *)buf + stride * 2);                      \
+    int x;                                                                  \
+                                                                            \
+    for (x = 0; x < w; x++) {                                               \
+        const struct rgbvec s = {r[x], g[x], b[x]};                         \
+        const struct rgbvec c = interp_##name(table, lutsize, &s);          \
+        r[x] = c.r;                                                         \
+        g[x] = c.g;                                                         \
+        b[x] = c.b;                                                         \
+    }                                                                       \
+}
+DEFINE_INTERP_ROW(nearest)
+DEFINE_INTERP_ROW(trilinear)
+DEFINE_INTERP_ROW(tetrahedral)
+
+av_cold void ff_lut3d_dsp_init(LUT3DDSPContext *dsp)
+{
+    dsp->interp[INTERPOLATE_NEAREST]     = interp_row_nearest_c;
+    dsp->interp[INTERPOLATE_TRILINEAR]   = interp_row_trilinear_c;
+    dsp->interp[INTERPOLATE_TETRAHEDRAL] = interp_row_tetrahedral_c;
+}
+
+/* number of pixels converted to LUT coordinates and interpolated at once */
+#define ROW_CHUNK 256
+
+static inline void pad_chunk(float rgb[3][ROW_CHUNK], int n)
+{
+    for (; n & 7; n++)
+        rgb[0][n] = rgb[1][n] = rgb[2][n] = 0.f;
+}
+
+#define DEFINE_INTERP_FUNC_PLANAR(nbits, depth)                                               \
+static int interp_##nbits##_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+{                                                                                             \
+    int x, y, i;                                                                              \
+    const LUT3DContext *lut3d = ctx->priv;                                                    \
+    const ThreadData *td = arg;                                                               \
+    const AVFrame *in  = td->in;                                                              \
+    const AVFrame *out = td->out;                                                             \
+    const int direct = out == in;                                                             \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                               \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                               \
+    uint8_t *grow = out->data[0] + slice_start * out->linesize[0];                            \
+    uint8_t *brow = out->data[1] + slice_start * out->linesize[1];                            \
+    uint8_t *rrow = out->data[2] + slice_start * out->linesize[2];                            \
+    uint8_t *arow = out->data[3] + slice_start * out->linesize[3];                            \
+    const uint8_t *srcgrow = in->data[0] + slice_start * in->linesize[0];                     \
+    const uint8_t *srcbrow = in->data[1] + slice_start * in->linesize[1];                     \
+    const uint8_t *srcrrow = in->data[2] + slice_start * in->linesize[2];                     \
+    const uint8_t *srcarow = in->data[3] + slice_start * in->linesize[3];                     \
+    const float scale_r = (lut3d->scale.r / ((1<<depth) - 1)) * (lut3d->lutsize - 1);         \
+    const float scale_g = (lut3d->scale.g / ((1<<depth) - 1)) * (lut3d->lutsize - 1);         \
+    const float scale_b = (lut3d->scale.b / ((1<<depth) - 1)) * (lut3d->lutsize - 1);         \
+    void (*interp)(float *buf, ptrdiff_t stride, int w, const struct rgbvec *lut,             \
+                   int lutsize) = lut3d->dsp.interp[lut3d->interpolation];                    \
+    LOCAL_ALIGNED_32(float, rgb, [3], [ROW_CHUNK]);                                           \
+                                                                                              \
+    for (y = slice_start; y < slice_end; y++) {                                               \
+        uint##nbits##_t *dstg = (uint##nbits##_t *)grow;                                      \
+        uint##nbits##_t *dstb = (uint##nbits##_t *)brow;                                      \
+        uint##nbits##_t *dstr = (uint##nbits##_t *)rrow;                                      \
+        uint##nbits##_t *dsta = (uint##nbits##_t *)arow;                                      \
+        const uint##nbits##_t *srcg = (const uint##nbits##_t *)srcgrow;                       \
+        const uint##nbits##_t *srcb = (const uint##nbits##_t *)srcbrow;                       \
+        const uint##nbits##_t *srcr = (const uint##nbits##_t *)srcrrow;                       \
+        const uint##nbits##_t *srca = (const uint##nbits##_t *)srcarow;                       \
+        for (x = 0; x < in->width; x += ROW_CHUNK) {                                          \
+            const int n = FFMIN(ROW_CHUNK, in->width - x);                                    \
+            for (i = 0; i < n; i++) {                                                         \
+                rgb[0][i] = srcr[x + i] * scale_r;                                            \
+                rgb[1][i] = srcg[x + i] * scale_g;                                            \
+                rgb[2][i] = srcb[x + i] * scale_b;                                            \
+            }                                                                                 \
+            pad_chunk(rgb, n);                                                                \
+            interp(rgb[0], sizeof(rgb[0]), n, &lut3d->lut[0][0][0], lut3d->lutsize);          \
+            for (i = 0; i < n; i++) {                                                         \
+                dstr[x + i] = av_clip_uintp2(rgb[0][i] * (float)((1<<depth) - 1), depth);     \
+                dstg[x + i] = av_clip_uintp2(rgb[1][i] * (float)((1<<depth) - 1), depth);     \
+                dstb[x + i] = av_clip_uintp2(rgb[2][i] * (float)((1<<depth) - 1), depth);     \
+                if (!direct && in->linesize[3])                                               \
+                    dsta[x + i] = srca[x + i];                                                \
+            }                                                                                 \
+        }                                                                                     \
+        grow += out->linesize[0];                                                             \
+        brow += out->linesize[1];                                                             \
+        rrow += out->linesize[2];                                                             \
+        arow += out->linesize[3];                                                             \
+        srcgrow += in->linesize[0];                                                           \
+        srcbrow += in->linesize[1];                                                           \
+        srcrrow += in->linesize[2];                                                           \
+        srcarow += in->linesize[3];                                                           \
+    }                                                                                         \
+    return 0;                                                                                 \
+}
+DEFINE_INTERP_FUNC_PLANAR(8, 8)
+DEFINE_INTERP_FUNC_PLANAR(16, 9)
+DEFINE_INTERP_FUNC_PLANAR(16, 10)
+DEFINE_INTERP_FUNC_PLANAR(16, 12)
+DEFINE_INTERP_FUNC_PLANAR(16, 14)
+DEFINE_INTERP_FUNC_PLANAR(16, 16)
+
+#define DEFINE_INTERP_FUNC(nbits)                                                             \
+static int interp_##nbits(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)            \
+{                                                                                             \
+    int x, y, i;                                                                              \
+    const LUT3DContext *lut3d = ctx->priv;                                                    \
+    const ThreadData *td = arg;                                                               \
+    const AVFrame *in  = td->in;                                                              \
+    const AVFrame *out = td->out;                                                             \
+    const int direct = out == in;                                                             \
+    const int step = lut3d->step;                                                             \
+    const uint8_t r = lut3d->rgba_map[R];                                                     \
+    const uint8_t g = lut3d->rgba_map[G];                                                     \
+    const uint8_t b = lut3d->rgba_map[B];                                                     \
+    const uint8_t a = lut3d->rgba_map[A];                                                     \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                               \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                               \
+    uint8_t       *dstrow = out->data[0] + slice_start * out->linesize[0];                    \
+    const uint8_t *srcrow = in ->data[0] + slice_start * in ->linesize[0];                    \
+    const float scale_r = (lut3d->scale.r / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);         \
+    const float scale_g = (lut3d->scale.g / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);         \
+    const float scale_b = (lut3d->scale.b / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);         \
+    void (*interp)(float *buf, ptrdiff_t stride, int w, const struct rgbvec *lut,             \
+                   int lutsize) = lut3d->dsp.interp[lut3d->interpolation];                    \
+    LOCAL_ALIGNED_32(float, rgb, [3], [ROW_CHUNK]);                                           \
+                                                                                              \
+    for (y = slice_start; y < slice_end; y++) {                                               \
+        for (x = 0; x < in->width; x += ROW_CHUNK) {                                          \
+            const int n = FFMIN(ROW_CHUNK, in->width - x);                                    \
+            uint##nbits##_t *dst = (uint##nbits##_t *)dstrow + x * step;                      \
+            const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow + x * step;          \
+            for (i = 0; i < n; i++) {                                                         \
+                rgb[0][i] = src[i * step + r] * scale_r;                                      \
+                rgb[1][i] = src[i * step + g] * scale_g;                                      \
+                rgb[2][i] = src[i * step + b] * scale_b;                                      \
+            }                                                                                 \
+            pad_chunk(rgb, n);                                                                \
+            interp(rgb[0], sizeof(rgb[0]), n, &lut3d->lut[0][0][0], lut3d->lutsize);          \
+            for (i = 0; i < n; i++) {                                                         \
+                dst[i * step + r] = av_clip_uint##nbits(rgb[0][i] * (float)((1<<nbits) - 1)); \
+                dst[i * step + g] = av_clip_uint##nbits(rgb[1][i] * (float)((1<<nbits) - 1)); \
+                dst[i * step + b] = av_clip_uint##nbits(rgb[2][i] * (float)((1<<nbits) - 1)); \
+                if (!direct && step == 4)                                                     \
+                    dst[i * step + a] = src[i * step + a];                                    \
+            }                                                                                 \
+        }                                                                                     \
+        dstrow += out->linesize[0];                                                           \
+        srcrow += in ->linesize[0];                                                           \
+    }                                                                                         \
+    return 0;                                                                                 \
+}
+DEFINE_INTERP_FUNC(8)
+DEFINE_INTERP_FUNC(16)
+
+/* fractional bits of the weights and of the colors of the integer LUT */
+#define INT_FRAC_BITS 12
+#define INT_LUT_BITS   8
+
+/* the colors are clipped to [-1,2] for the weighted sums to fit in 32 bits */
+static inline int32_t lut_to_int(float v)
+{
+    return lrintf(av_clipf(v, -1.f, 2.f) * (255 << INT_LUT_BITS));
+}
+
+/**
+ * Convert the LUT to integers, and tabulate where the 256 levels of each
+ * component of 8-bit input fall in it, using the same coordinates as the
+ * float interpolation.
+ */
+static int init_int_lut(LUT3DContext *lut3d)
+{
+    const int size = lut3d->lutsize;
+    const float scale[3] = {lut3d->scale.r, lut3d->scale.g, lut3d->scale.b};
+    const int stride[3] = {size * size * 3, size * 3, 3};
+    int32_t *dst;
+    int i, j, k;
+
+    av_fast_malloc(&lut3d->int_lut, &lut3d->int_lut_size,
+                   size * size * size * 3 * sizeof(*lut3d->int_lut));
+    if (!lut3d->int_lut)
+        return AVERROR(ENOMEM);
+
+    dst = lut3d->int_lut;
+    for (k = 0; k < size; k++) {
+        for (j = 0; j < size; j++) {
+            for (i = 0; i < size; i++) {
+                const struct rgbvec *vec = &lut3d->lut[k][j][i];
+                *dst++ = lut_to_int(vec->r);
+                *dst++ = lut_to_int(vec->g);
+                *dst++ = lut_to_int(vec->b);
+            }
+        }
+    }
+
+    for (k = 0; k < 3; k++) {
+        const float scale_k = (scale[k] / 255) * (size - 1);
+        for (i = 0; i < 256; i++) {
+            const float s = i * scale_k;
+            const int prev = PREV(s);
+            lut3d->int_prev[k][i] = prev * stride[k];
+            lut3d->int_next[k][i] = FFMIN(prev + 1, size - 1) * stride[k];
+            lut3d->int_near[k][i] = NEAR(s) * stride[k];
+            lut3d->int_frac[k][i] = lrintf((s - prev) * (1 << INT_FRAC_BITS));
+        }
+    }
+    return 0;
+}
+
+static inline void interp_int_nearest(const LUT3DContext *lut3d, int c[3],
+                                      int r, int g, int b)
+{
+    const int32_t *v = lut3d->int_lut + lut3d->int_near[R][r] +
+                       lut3d->int_near[G][g] + lut3d->int_near[B][b];
+    c[0] = v[0] >> INT_LUT_BITS;
+    c[1] = v[1] >> INT_LUT_BITS;
+    c[2] = v[2] >> INT_LUT_BITS;
 }
 
-DEFINE_INTERP_FUNC_PLANAR(nearest,     8, 8)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   8, 8)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 8, 8)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 9)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 9)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 9)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 10)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 10)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 10)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 12)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 12)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 12)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 14)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 14)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 14)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 16)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 16)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 16)
-
-#define DEFINE_INTERP_FUNC(name, nbits)                                                             \
-static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)         \
-{                                                                                                   \
-    int x, y;                                                                                       \
-    const LUT3DContext *lut3d = ctx->priv;                                                          \
-    const ThreadData *td = arg;                                                                     \
-    const AVFrame *in  = td->in;                                                                    \
-    const AVFrame *out = td->out;                                                                   \
-    const int direct = out == in;                                                                   \
-    const int step = lut3d->step;                                                                   \
-    const uint8_t r = lut3d->rgba_map[R];                                                           \
-    const uint8_t g = lut3d->rgba_map[G];                                                           \
-    const uint8_t b = lut3d->rgba_map[B];                                                           \
-    const uint8_t a = lut3d->rgba_map[A];                                                           \
-    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                                     \
-    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                                     \
-    uint8_t       *dstrow = out->data[0] + slice_start * out->linesize[0];                          \
-    const uint8_t *srcrow = in ->data[0] + slice_start * in ->linesize[0];                          \
-    const float scale_r = (lut3d->scale.r / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
-    const float scale_g = (lut3d->scale.g / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
-    const float scale_b = (lut3d->scale.b / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
-                                                                                                    \
-    for (y = slice_start; y < slice_end; y++) {                                                     \
-        uint##nbits##_t *dst = (uint##nbits##_t *)dstrow;                                           \
-        const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow;                               \
-        for (x = 0; x < in->width * step; x += step) {                                              \
-            const struct rgbvec scaled_rgb = {src[x + r] * scale_r,                                 \
-                                              src[x + g] * scale_g,                                 \
-                                              src[x + b] * scale_b};                                \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                  \
-            dst[x + r] = av_clip_uint##nbits(vec.r * (float)((1<<nbits) - 1));                      \
-            dst[x + g] = av_clip_uint##nbits(vec.g * (float)((1<<nbits) - 1));                      \
-            dst[x + b] = av_clip_uint##nbits(vec.b * (float)((1<<nbits) - 1));                      \
-            if (!direct && step == 4)                                                               \
-                dst[x + a] = src[x + a];                                                            \
-        }                                                                                           \
-        dstrow += out->linesize[0];                                                                 \
-        srcrow += in ->linesize[0];                                                                 \
-    }                                                                                               \
-    return 0;                                                                                       \
+static inline int lerpi(int v0, int v1, int f)
+{
+    return v0 + ((v1 - v0) * f >> INT_FRAC_BITS);
+}
+
+static inline void interp_int_trilinear(const LUT3DContext *lut3d, int c[3],
+                                        int r, int g, int b)
+{
+    const int32_t *lut = lut3d->int_lut;
+    const int pr = lut3d->int_prev[R][r], nr = lut3d->int_next[R][r], dr = lut3d->int_frac[R][r];
+    const int pg = lut3d->int_prev[G][g], ng = lut3d->int_next[G][g], dg = lut3d->int_frac[G][g];
+    const int pb = lut3d->int_prev[B][b], nb = lut3d->int_next[B][b], db = lut3d->int_frac[B][b];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        const int c00 = lerpi(lut[pr + pg + pb + i], lut[nr + pg + pb + i], dr);
+        const int c10 = lerpi(lut[pr + ng + pb + i], lut[nr + ng + pb + i], dr);
+        const int c01 = lerpi(lut[pr + pg + nb + i], lut[nr + pg + nb + i], dr);
+        const int c11 = lerpi(lut[pr + ng + nb + i], lut[nr + ng + nb + i], dr);
+        const int c0  = lerpi(c00, c10, dg);
+        const int c1  = lerpi(c01, c11, dg);
+        c[i] = lerpi(c0, c1, db) >> INT_LUT_BITS;
+    }
 }
 
-DEFINE_INTERP_FUNC(nearest,     8)
-DEFINE_INTERP_FUNC(trilinear,   8)
-DEFINE_INTERP_FUNC(tetrahedral, 8)
+static inline void interp_int_tetrahedral(const LUT3DContext *lut3d, int c[3],
+                                          int r, int g, int b)
+{
+    const int32_t *lut = lut3d->int_lut;
+    const int pr = lut3d->int_prev[R][r], nr = lut3d->int_next[R][r], dr = lut3d->int_frac[R][r];
+    const int pg = lut3d->int_prev[G][g], ng = lut3d->int_next[G][g], dg = lut3d->int_frac[G][g];
+    const int pb = lut3d->int_prev[B][b], nb = lut3d->int_next[B][b], db = lut3d->int_frac[B][b];
+    const int one = 1 << INT_FRAC_BITS;
+    const int32_t *c000 = lut + pr + pg + pb;
+    const int32_t *c111 = lut + nr + ng + nb;
+    const int32_t *c1, *c2;
+    int w0, w1, w2, w3, i;
+
+    if (dr > dg) {
+        if (dg > db) {
+            c1 = lut + nr + pg + pb; c2 = lut + nr + ng + pb;
+            w0 = one - dr; w1 = dr - dg; w2 = dg - db; w3 = db;
+        } else if (dr > db) {
+            c1 = lut + nr + pg + pb; c2 = lut + nr + pg + nb;
+            w0 = one - dr; w1 = dr - db; w2 = db - dg; w3 = dg;
+        } else {
+            c1 = lut + pr + pg + nb; c2 = lut + nr + pg + nb;
+            w0 = one - db; w1 = db - dr; w2 = dr - dg; w3 = dg;
+        }
+    } else {
+        if (db > dg) {
+            c1 = lut + pr + pg + nb; c2 = lut + pr + ng + nb;
+            w0 = one - db; w1 = db - dg; w2 = dg - dr; w3 = dr;
+        } else if (db > dr) {
+            c1 = lut + pr + ng + pb; c2 = lut + pr + ng + nb;
+            w0 = one - dg; w1 = dg - db; w2 = db - dr; w3 = dr;
+        } else {
+            c1 = lut + pr + ng + pb; c2 = lut + nr + ng + pb;
+            w0 = one - dg; w1 = dg - dr; w2 = dr - db; w3 = db;
+        }
+    }
+
+    for (i = 0; i < 3; i++)
+        c[i] = (w0 * c000[i] + w1 * c1[i] + w2 * c2[i] + w3 * c111[i]) >>
+               (INT_FRAC_BITS + INT_LUT_BITS);
+}
 
-DEFINE_INTERP_FUNC(nearest,     16)
-DEFINE_INTERP_FUNC(trilinear,   16)
-DEFINE_INTERP_FUNC(tetrahedral, 16)
+#define DEFINE_INTERP_INT_FUNC_PLANAR(name)                                                  \
+static int interp_int_8_##name##_p8(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+{                                                                                            \
+    int x, y;                                                                                \
+    const LUT3DContext *lut3d = ctx->priv;                                                   \
+    const ThreadData *td = arg;                                                              \
+    const AVFrame *in  = td->in;                                                             \
+    const AVFrame *out = td->out;                                                            \
+    const int direct = out == in;                                                            \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                              \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                              \
+    uint8_t *dstg = out->data[0] + slice_start * out->linesize[0];                           \
+    uint8_t *dstb = out->data[1] + slice_start * out->linesize[1];                           \
+    uint8_t *dstr = out->data[2] + slice_start * out->linesize[2];                           \
+    uint8_t *dsta = out->data[3] + slice_start * out->linesize[3];                           \
+    const uint8_t *srcg = in->data[0] + slice_start * in->linesize[0];                       \
+    const uint8_t *srcb = in->data[1] + slice_start * in->linesize[1];                       \
+    const uint8_t *srcr = in->data[2] + slice_start * in->linesize[2];                       \
+    const uint8_t *srca = in->data[3] + slice_start * in->linesize[3];                       \
+                                                                                             \
+    for (y = slice_start; y < slice_end; y++) {                                              \
+        for (x = 0; x < in->width; x++) {                                                    \
+            int c[3];                                                                        \
+            interp_int_##name(lut3d, c, srcr[x], srcg[x], srcb[x]);                          \
+            dstr[x] = av_clip_uint8(c[0]);                                                   \
+            dstg[x] = av_clip_uint8(c[1]);                                                   \
+            dstb[x] = av_clip_uint8(c[2]);                                                   \
+            if (!direct && in->linesize[3])                                                  \
+                dsta[x] = srca[x];                                                           \
+        }                                                                                    \
+        dstg += out->linesize[0];                                                            \
+        dstb += out->linesize[1];                                                            \
+        dstr += out->linesize[2];                                                            \
+        dsta += out->linesize[3];                                                            \
+        srcg += in->linesize[0];                                                             \
+        srcb += in->linesize[1];                                                             \
+        srcr += in->linesize[2];                                                             \
+        srca += in->linesize[3];                                                             \
+    }                                                                                        \
+    return 0;                                                                                \
+}
+DEFINE_INTERP_INT_FUNC_PLANAR(nearest)
+DEFINE_INTERP_INT_FUNC_PLANAR(trilinear)
+DEFINE_INTERP_INT_FUNC_PLANAR(tetrahedral)
+
+#define DEFINE_INTERP_INT_FUNC(name)                                                    \
+static int interp_int_8_##name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+{                                                                                       \
+    int x, y;                                                                           \
+    const LUT3DContext *lut3d = ctx->priv;                                              \
+    const ThreadData *td = arg;                                                         \
+    const AVFrame *in  = td->in;                                                        \
+    const AVFrame *out = td->out;                                                       \
+    const int direct = out == in;                                                       \
+    const int step = lut3d->step;                                                       \
+    const uint8_t r = lut3d->rgba_map[R];                                               \
+    const uint8_t g = lut3d->rgba_map[G];                                               \
+    const uint8_t b = lut3d->rgba_map[B];                                               \
+    const uint8_t a = lut3d->rgba_map[A];                                               \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                         \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                         \
+    uint8_t       *dst = out->data[0] + slice_start * out->linesize[0];                 \
+    const uint8_t *src = in ->data[0] + slice_start * in ->linesize[0];                 \
+                                                                                        \
+    for (y = slice_start; y < slice_end; y++) {                                         \
+        for (x = 0; x < in->width * step; x += step) {                                  \
+            int c[3];                                                                   \
+            interp_int_##name(lut3d, c, src[x + r], src[x + g], src[x + b]);            \
+            dst[x + r] = av_clip_uint8(c[0]);                                           \
+            dst[x + g] = av_clip_uint8(c[1]);                                           \
+            dst[x + b] = av_clip_uint8(c[2]);                                           \
+            if (!direct && step == 4)                                                   \
+                dst[x + a] = src[x + a];                                                \
+        }                                                                               \
+        dst += out->linesize[0];                                                        \
+        src += in ->linesize[0];                                                        \
+    }                                                                                   \
+    return 0;                                                                           \
+}
+DEFINE_INTERP_INT_FUNC(nearest)
+DEFINE_INTERP_INT_FUNC(trilinear)
+DEFINE_INTERP_INT_FUNC(tetrahedral)
 
 #define MAX_LINE_SIZE 512
 
@@ -699,26 +942,40 @@ static int config_input(AVFilterLink *inlink)
     ff_fill_rgba_map(lut3d->rgba_map, inlink->format);
     lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + is16bit);
 
-#define SET_FUNC(name) do {                                     \
-    if (planar) {                                               \
-        switch (depth) {                                        \
-        case  8: lut3d->interp = interp_8_##name##_p8;   break; \
-        case  9: lut3d->interp = interp_16_##name##_p9;  break; \
-        case 10: lut3d->interp = interp_16_##name##_p10; break; \
-        case 12: lut3d->interp = interp_16_##name##_p12; break; \
-        case 14: lut3d->interp = interp_16_##name##_p14; break; \
-        case 16: lut3d->interp = interp_16_##name##_p16; break; \
-        }                                                       \
-    } else if (is16bit) { lut3d->interp = interp_16_##name;     \
-    } else {       lut3d->interp = interp_8_##name; }           \
+#define SET_INT_FUNC(name) do {                                              \
+    lut3d->interp = planar ? interp_int_8_##name##_p8 : interp_int_8_##name; \
 } while (0)
 
-    switch (lut3d->interpolation) {
-    case INTERPOLATE_NEAREST:     SET_FUNC(nearest);        break;
-    case INTERPOLATE_TRILINEAR:   SET_FUNC(trilinear);      break;
-    case INTERPOLATE_TETRAHEDRAL: SET_FUNC(tetrahedral);    break;
-    default:
-        av_assert0(0);
+    ff_lut3d_dsp_init(&lut3d->dsp);
+
+    lut3d->int_interp = lut3d->use_int_lut && depth == 8;
+    if (lut3d->int_interp) {
+        switch (lut3d->interpolation) {
+        case INTERPOLATE_NEAREST:     SET_INT_FUNC(nearest);     break;
+        case INTERPOLATE_TRILINEAR:   SET_INT_FUNC(trilinear);   break;
+        case INTERPOLATE_TETRAHEDRAL: SET_INT_FUNC(tetrahedral); break;
+        default:
+            av_assert0(0);
+        }
+        /* the Hald CLUT is only known with its first frame */
+        if (lut3d->lutsize) {
+            int ret = init_int_lut(lut3d);
+            if (ret < 0)
+                return ret;
+        }
+    } else if (planar) {
+        switch (depth) {
+        case  8: lut3d->interp = interp_8_p8;   break;
+        case  9: lut3d->interp = interp_16_p9;  break;
+        case 10: lut3d->interp = interp_16_p10; break;
+        case 12: lut3d->interp = interp_16_p12; break;
+        case 14: lut3d->interp = interp_16_p14; break;
+        case 16: lut3d->interp = interp_16_p16; break;
+        }
+    } else if (is16bit) {
+        lut3d->interp = interp_16;
+    } else {
+        lut3d->interp = interp_8;
     }
 
     return 0;
@@ -824,6 +1081,12 @@ end:
     return ret;
 }
 
+static av_cold void lut3d_uninit(AVFilterContext *ctx)
+{
+    LUT3DContext *lut3d = ctx->priv;
+    av_freep(&lut3d->int_lut);
+}
+
 static const AVFilterPad lut3d_inputs[] = {
     {
         .name         = "default",
@@ -847,6 +1110,7 @@ AVFilter ff_vf_lut3d = {
     .description   = NULL_IF_CONFIG_SMALL("Adjust colors using a 3D LUT."),
     .priv_size     = sizeof(LUT3DContext),
     .init          = lut3d_init,
+    .uninit        = lut3d_uninit,
     .query_formats = query_formats,
     .inputs        = lut3d_inputs,
     .outputs       = lut3d_outputs,
@@ -1023,6 +1287,10 @@ static int update_apply_clut(FFFrameSync *fs)
         update_clut_planar(ctx->priv, second);
     else
         update_clut_packed(ctx->priv, second);
+    if (lut3d->int_interp && (ret = init_int_lut(lut3d)) < 0) {
+        av_frame_free(&master);
+        return ret;
+    }
     out = apply_lut(inlink, master);
     return ff_filter_frame(ctx->outputs[0], out);
 }
@@ -1039,6 +1307,7 @@ static av_cold void haldclut_uninit(AVFilterContext *ctx)
 {
     LUT3DContext *lut3d = ctx->priv;
     ff_framesync_uninit(&lut3d->fs);
+    av_freep(&lut3d->int_lut);
 }
 
 static const AVOption haldclut_options[] = {
@@ -88,6 +88,7 @@ typedef struct ScaleContext {
     int force_original_aspect_ratio;
 
     int nb_slices;
+    int nb_bands;               ///< number of output bands scaled by separate threads
 
     int eval_mode;              ///< expression evaluation mode
 
@@ -334,6 +335,17 @@ static int config_props(AVFilterLink *outlink)
             if (!scale->interlaced)
                 break;
         }
+
+        scale->nb_bands = 1;
+        if (!scale->nb_slices && scale->interlaced <= 0) {
+            int nb_threads = ff_filter_get_nb_threads(ctx);
+
+            ret = sws_init_bands(scale->sws, nb_threads);
+            if (ret >= 0)
+                scale->nb_bands = nb_threads;
+            else if (ret != AVERROR(ENOSYS))
+                return ret;
+        }
     }
 
     if (inlink0->sample_aspect_ratio.num){
@@ -400,6 +412,20 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
                          out,out_stride);
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int scale_band(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleContext *scale = ctx->priv;
+    ThreadData *td = arg;
+    int ret = sws_scale_band(scale->sws, jobnr,
+                             (const uint8_t * const *)td->in->data, td->in->linesize,
+                             td->out->data, td->out->linesize);
+    return FFMIN(ret, 0);
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ScaleContext *scale = link->dst->priv;
@@ -516,6 +542,9 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             slice_h     = slice_end - slice_start;
             scale_slice(link, out, in, scale->sws, slice_start, slice_h, 1, 0);
         }
+    }else if (scale->nb_bands > 1) {
+        ThreadData td = { .in = in, .out = out };
+        link->dst->internal->execute(link->dst, scale_band, &td, NULL, scale->nb_bands);
     }else{
         scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
     }
@@ -647,6 +676,7 @@ AVFilter ff_vf_scale = {
     .inputs          = avfilter_vf_scale_inputs,
     .outputs         = avfilter_vf_scale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 static const AVClass scale2ref_class = {
@@ -699,4 +729,5 @@ AVFilter ff_vf_scale2ref = {
     .inputs          = avfilter_vf_scale2ref_inputs,
     .outputs         = avfilter_vf_scale2ref_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -46,6 +46,9 @@ typedef struct SRContext {
     int scale_factor;
     struct SwsContext *sws_contexts[3];
     int sws_slice_h, sws_input_linesize, sws_output_linesize;
+    int async, batch_size;
+    // frames queued since the last flush, and not yet output
+    int nb_queued, nb_inflight;
 } SRContext;
 
 #define OFFSET(x) offsetof(SRContext, x)
@@ -58,6 +61,8 @@ static const AVOption sr_options[] = {
 #endif
     { "scale_factor", "scale factor for SRCNN model", OFFSET(scale_factor), AV_OPT_TYPE_INT, { .i64 = 2 }, 2, 4, FLAGS },
     { "model", "path to model file specifying network architecture and its parameters", OFFSET(model_filename), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "async", "execute the model asynchronously", OFFSET(async), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, FLAGS },
+    { "batch_size", "number of frames executed together", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, 64, FLAGS },
     { NULL }
 };
 
@@ -87,6 +92,11 @@ static av_cold int init(AVFilterContext *context)
         return AVERROR(EIO);
     }
 
+    if (sr_context->async && !sr_context->dnn_module->execute_model_async){
+        av_log(context, AV_LOG_VERBOSE, "asynchronous execution is not supported by the DNN backend\n");
+        sr_context->async = 0;
+    }
+
     sr_context->input.dt = DNN_FLOAT;
     sr_context->sws_contexts[0] = NULL;
     sr_context->sws_contexts[1] = NULL;
@@ -224,6 +234,46 @@ static int config_props(AVFilterLink *inlink)
     return 0;
 }
 
+static int output_frame(AVFilterContext *context, AVFrame *out, const DNNData *output)
+{
+    SRContext *sr_context = context->priv;
+
+    sws_scale(sr_context->sws_contexts[2], (const uint8_t *[4]){(const uint8_t *)output->data, 0, 0, 0},
+              (const int[4]){sr_context->sws_output_linesize, 0, 0, 0},
+              0, out->height, (uint8_t * const*)out->data, out->linesize);
+
+    return ff_filter_frame(context->outputs[0], out);
+}
+
+// Output the frames whose execution is finished, waiting for them until at
+// most max_inflight frames are left.
+static int output_results(AVFilterContext *context, int max_inflight)
+{
+    SRContext *sr_context = context->priv;
+    DNNAsyncStatusType status;
+    DNNData output;
+    void *opaque;
+    int ret;
+
+    while ((status = (sr_context->dnn_module->get_async_result)(sr_context->model, &output, &opaque,
+                                                                 sr_context->nb_inflight > max_inflight)) != DAST_EMPTY_QUEUE &&
+           status != DAST_NOT_READY){
+        AVFrame *out = opaque;
+
+        sr_context->nb_inflight--;
+        if (status != DAST_SUCCESS){
+            av_log(context, AV_LOG_ERROR, "failed to execute loaded model\n");
+            av_frame_free(&out);
+            return AVERROR(EIO);
+        }
+        ret = output_frame(context, out, &output);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *context = inlink->dst;
@@ -261,17 +311,45 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_free(&in);
 
+    if (sr_context->async){
+        dnn_result = (sr_context->dnn_module->execute_model_async)(sr_context->model, out);
+        if (dnn_result != DNN_SUCCESS){
+            av_log(context, AV_LOG_ERROR, "failed to execute loaded model\n");
+            av_frame_free(&out);
+            return AVERROR(EIO);
+        }
+        sr_context->nb_inflight++;
+        if (++sr_context->nb_queued == sr_context->batch_size){
+            (sr_context->dnn_module->flush)(sr_context->model);
+            sr_context->nb_queued = 0;
+        }
+
+        // one batch may be executed while the next one is queued
+        return output_results(context, 2 * sr_context->batch_size - 1);
+    }
+
     dnn_result = (sr_context->dnn_module->execute_model)(sr_context->model, &sr_context->output, 1);
     if (dnn_result != DNN_SUCCESS){
         av_log(context, AV_LOG_ERROR, "failed to execute loaded model\n");
+        av_frame_free(&out);
         return AVERROR(EIO);
     }
 
-    sws_scale(sr_context->sws_contexts[2], (const uint8_t *[4]){(const uint8_t *)sr_context->output.data, 0, 0, 0},
-              (const int[4]){sr_context->sws_output_linesize, 0, 0, 0},
-              0, out->height, (uint8_t * const*)out->data, out->linesize);
+    return output_frame(context, out, &sr_context->output);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *context = outlink->src;
+    SRContext *sr_context = context->priv;
+    int ret;
 
-    return ff_filter_frame(outlink, out);
+    ret = ff_request_frame(context->inputs[0]);
+
+    if (ret == AVERROR_EOF && sr_context->nb_inflight)
+        ret = output_results(context, 0);
+
+    return ret;
 }
 
 static av_cold void uninit(AVFilterContext *context)
@@ -280,6 +358,15 @@ static av_cold void uninit(AVFilterContext *context)
     SRContext *sr_context = context->priv;
 
     if (sr_context->dnn_module){
+        if (sr_context->async && sr_context->model){
+            DNNData output;
+            void *opaque;
+
+            while ((sr_context->dnn_module->get_async_result)(sr_context->model, &output, &opaque, 1) != DAST_EMPTY_QUEUE){
+                AVFrame *out = opaque;
+                av_frame_free(&out);
+            }
+        }
         (sr_context->dnn_module->free_model)(&sr_context->model);
         av_freep(&sr_context->dnn_module);
     }
@@ -301,8 +388,9 @@ static const AVFilterPad sr_inputs[] = {
 
 static const AVFilterPad sr_outputs[] = {
     {
-        .name = "default",
-        .type = AVMEDIA_TYPE_VIDEO,
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .request_frame = request_frame,
     },
     { NULL }
 };
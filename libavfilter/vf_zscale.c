@@ -44,6 +44,11 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/avassert.h"
 
+#define MAX_THREADS 64
+/* Height multiple of the bands a frame is split into, which keeps the chroma
+ * planes and the ordered dither pattern aligned. */
+#define SLICE_ALIGN 16
+
 static const char *const var_names[] = {
     "in_w",   "iw",
     "in_h",   "ih",
@@ -110,21 +115,30 @@ typedef struct ZScaleContext {
 
     int force_original_aspect_ratio;
 
-    void *tmp;
-    size_t tmp_size;
+    int nb_slices;
+    int slice_start[MAX_THREADS];   ///< first output row of each band
+    int slice_end[MAX_THREADS];
+    int slice_src_offset;           ///< the bands read the same rows of the source
+    void *tmp[MAX_THREADS];         ///< temporary buffers of the bands, kept across frames
+    size_t tmp_size[MAX_THREADS];
 
     zimg_image_format src_format, dst_format;
     zimg_image_format alpha_src_format, alpha_dst_format;
     zimg_graph_builder_params alpha_params, params;
-    zimg_filter_graph *alpha_graph, *graph;
+    zimg_filter_graph *alpha_graph[MAX_THREADS], *graph[MAX_THREADS];
 
-    enum AVColorSpace in_colorspace, out_colorspace;
-    enum AVColorTransferCharacteristic in_trc, out_trc;
-    enum AVColorPrimaries in_primaries, out_primaries;
-    enum AVColorRange in_range, out_range;
-    enum AVChromaLocation in_chromal, out_chromal;
+    enum AVColorSpace in_colorspace;
+    enum AVColorTransferCharacteristic in_trc;
+    enum AVColorPrimaries in_primaries;
+    enum AVColorRange in_range;
+    enum AVChromaLocation in_chromal;
 } ZScaleContext;
 
+typedef struct ThreadData {
+    const AVPixFmtDescriptor *desc, *odesc;
+    AVFrame *in, *out;
+} ThreadData;
+
 static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
 {
     ZScaleContext *s = ctx->priv;
@@ -502,16 +516,162 @@ static int graph_build(zimg_filter_graph **graph, zimg_graph_builder_params *par
     return 0;
 }
 
+/* restrict the source of a band to the rows it is converted from */
+static void slice_src_format(ZScaleContext *s, zimg_image_format *format,
+                             int in_w, int in_h, int out_h, int start, int end)
+{
+    if (s->slice_src_offset) {
+        /* the plane pointers are offset by filter_slice() */
+        format->height = end - start;
+    } else {
+        format->active_region.left   = 0;
+        format->active_region.top    = (double)start * in_h / out_h;
+        format->active_region.width  = in_w;
+        format->active_region.height = (double)(end - start) * in_h / out_h;
+    }
+}
+
+/**
+ * Split the output into horizontal bands, and build the graphs converting
+ * each of them. Without vertical scaling, a band is converted from the same
+ * rows of the source. Otherwise the source region of a band is given as its
+ * active region, so that the resampling of the band matches the one of the
+ * whole frame.
+ *
+ * Without vertical scaling but with vertically subsampled chroma on either
+ * side, the chroma may still be resampled vertically, e.g. to convert the
+ * color matrix, and it would be clamped at the edges of the bands. The frame
+ * is not split then.
+ *
+ * The random and error diffusion dithers depend on the position of the
+ * pixels in the converted image, so the frame is not split when they are
+ * used, to keep the output independent of the number of threads.
+ */
+static int slice_graphs_build(AVFilterContext *ctx, int in_w, int in_h,
+                              int out_w, int out_h, int vsub, int alpha)
+{
+    ZScaleContext *s = ctx->priv;
+    const int nb_rows = FFMAX(out_h / SLICE_ALIGN, 1);
+    int i, ret;
+
+    s->nb_slices = av_clip(ff_filter_get_nb_threads(ctx), 1, FFMIN(nb_rows, MAX_THREADS));
+    if (s->dither == ZIMG_DITHER_RANDOM || s->dither == ZIMG_DITHER_ERROR_DIFFUSION)
+        s->nb_slices = 1;
+    s->slice_src_offset = in_h == out_h;
+    if (s->slice_src_offset && vsub)
+        s->nb_slices = 1;
+
+    for (i = 0; i < s->nb_slices; i++) {
+        zimg_image_format src_format = s->src_format;
+        zimg_image_format dst_format = s->dst_format;
+        int start, end;
+
+        s->slice_start[i] = start = (nb_rows *  i   ) / s->nb_slices * SLICE_ALIGN;
+        s->slice_end[i]   = end   = i == s->nb_slices - 1 ? out_h :
+                                    (nb_rows * (i+1)) / s->nb_slices * SLICE_ALIGN;
+
+        if (s->nb_slices > 1)
+            slice_src_format(s, &src_format, in_w, in_h, out_h, start, end);
+        dst_format.height = end - start;
+
+        ret = graph_build(&s->graph[i], &s->params, &src_format, &dst_format,
+                          &s->tmp[i], &s->tmp_size[i]);
+        if (ret < 0)
+            return ret;
+
+        if (alpha) {
+            src_format = s->alpha_src_format;
+            dst_format = s->alpha_dst_format;
+            if (s->nb_slices > 1)
+                slice_src_format(s, &src_format, in_w, in_h, out_h, start, end);
+            dst_format.height = end - start;
+
+            ret = graph_build(&s->alpha_graph[i], &s->alpha_params, &src_format, &dst_format,
+                              &s->tmp[i], &s->tmp_size[i]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ZScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVPixFmtDescriptor *desc = td->desc;
+    const AVPixFmtDescriptor *odesc = td->odesc;
+    AVFrame *in = td->in;
+    AVFrame *out = td->out;
+    const int slice_start = s->slice_start[jobnr];
+    const int slice_end   = s->slice_end[jobnr];
+    /* first source row of the band when it is not given as an active region */
+    const int src_start   = s->slice_src_offset ? slice_start : 0;
+    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
+    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    int ret, plane;
+
+    for (plane = 0; plane < 3; plane++) {
+        const int vsub = plane ? odesc->log2_chroma_h : 0;
+        const int src_vsub = plane ? desc->log2_chroma_h : 0;
+        int p = desc->comp[plane].plane;
+        src_buf.plane[plane].data   = in->data[p] + (src_start >> src_vsub) * in->linesize[p];
+        src_buf.plane[plane].stride = in->linesize[p];
+        src_buf.plane[plane].mask   = -1;
+
+        p = odesc->comp[plane].plane;
+        dst_buf.plane[plane].data   = out->data[p] + (slice_start >> vsub) * out->linesize[p];
+        dst_buf.plane[plane].stride = out->linesize[p];
+        dst_buf.plane[plane].mask   = -1;
+    }
+
+    ret = zimg_filter_graph_process(s->graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+    if (ret)
+        return print_zimg_error(ctx);
+
+    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        src_buf.plane[0].data   = in->data[3] + src_start * in->linesize[3];
+        src_buf.plane[0].stride = in->linesize[3];
+        src_buf.plane[0].mask   = -1;
+
+        dst_buf.plane[0].data   = out->data[3] + slice_start * out->linesize[3];
+        dst_buf.plane[0].stride = out->linesize[3];
+        dst_buf.plane[0].mask   = -1;
+
+        ret = zimg_filter_graph_process(s->alpha_graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+        if (ret)
+            return print_zimg_error(ctx);
+    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        int x, y;
+
+        if (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) {
+            for (y = slice_start; y < slice_end; y++) {
+                for (x = 0; x < out->width; x++) {
+                    AV_WN32(out->data[3] + x * odesc->comp[3].step + y * out->linesize[3],
+                            av_float2int(1.0f));
+                }
+            }
+        } else {
+            for (y = slice_start; y < slice_end; y++)
+                memset(out->data[3] + y * out->linesize[3], 0xff, out->width);
+        }
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ZScaleContext *s = link->dst->priv;
     AVFilterLink *outlink = link->dst->outputs[0];
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
-    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
-    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    AVFilterContext *ctx = link->dst;
+    ThreadData td;
+    int rets[MAX_THREADS];
     char buf[32];
-    int ret = 0, plane;
+    int ret = 0, i;
     AVFrame *out;
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -524,19 +684,19 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     out->width  = outlink->w;
     out->height = outlink->h;
 
-    if(   in->width  != link->w
+    /* The graphs only depend on the input properties and the output size:
+     * frames differing in anything else, like their side data, reuse them. */
+    if(   !s->nb_slices
+       || in->width  != link->w
        || in->height != link->h
        || in->format != link->format
+       || s->dst_format.width  != outlink->w
+       || s->dst_format.height != outlink->h
        || s->in_colorspace != in->colorspace
        || s->in_trc  != in->color_trc
        || s->in_primaries != in->color_primaries
        || s->in_range != in->color_range
-       || s->out_colorspace != out->colorspace
-       || s->out_trc  != out->color_trc
-       || s->out_primaries != out->color_primaries
-       || s->out_range != out->color_range
-       || s->in_chromal != in->chroma_location
-       || s->out_chromal != out->chroma_location) {
+       || s->in_chromal != in->chroma_location) {
         snprintf(buf, sizeof(buf)-1, "%d", outlink->w);
         av_opt_set(s, "w", buf, 0);
         snprintf(buf, sizeof(buf)-1, "%d", outlink->h);
@@ -568,35 +728,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         format_init(&s->dst_format, out, odesc, s->colorspace,
                     s->primaries, s->trc, s->range, s->chromal);
 
-        if (s->colorspace != -1)
-            out->colorspace = (int)s->dst_format.matrix_coefficients;
-
-        if (s->primaries != -1)
-            out->color_primaries = (int)s->dst_format.color_primaries;
-
-        if (s->range != -1)
-            out->color_range = (int)s->dst_format.pixel_range + 1;
-
-        if (s->trc != -1)
-            out->color_trc = (int)s->dst_format.transfer_characteristics;
-
-        if (s->chromal != -1)
-            out->chroma_location = (int)s->dst_format.chroma_location - 1;
-
-        ret = graph_build(&s->graph, &s->params, &s->src_format, &s->dst_format,
-                          &s->tmp, &s->tmp_size);
-        if (ret < 0)
-            goto fail;
-
-        s->in_colorspace  = in->colorspace;
-        s->in_trc         = in->color_trc;
-        s->in_primaries   = in->color_primaries;
-        s->in_range       = in->color_range;
-        s->out_colorspace = out->colorspace;
-        s->out_trc        = out->color_trc;
-        s->out_primaries  = out->color_primaries;
-        s->out_range      = out->color_range;
-
         if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
             zimg_image_format_default(&s->alpha_src_format, ZIMG_API_VERSION);
             zimg_image_format_default(&s->alpha_dst_format, ZIMG_API_VERSION);
@@ -617,14 +748,22 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             s->alpha_dst_format.depth = odesc->comp[0].depth;
             s->alpha_dst_format.pixel_type = (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) ? ZIMG_PIXEL_FLOAT : odesc->comp[0].depth > 8 ? ZIMG_PIXEL_WORD : ZIMG_PIXEL_BYTE;
             s->alpha_dst_format.color_family = ZIMG_COLOR_GREY;
+        }
 
-            zimg_filter_graph_free(s->alpha_graph);
-            s->alpha_graph = zimg_filter_graph_build(&s->alpha_src_format, &s->alpha_dst_format, &s->alpha_params);
-            if (!s->alpha_graph) {
-                ret = print_zimg_error(link->dst);
-                goto fail;
-            }
+        ret = slice_graphs_build(ctx, in->width, in->height, out->width, out->height,
+                                 desc->log2_chroma_h || odesc->log2_chroma_h,
+                                 desc->flags & AV_PIX_FMT_FLAG_ALPHA &&
+                                 odesc->flags & AV_PIX_FMT_FLAG_ALPHA);
+        if (ret < 0) {
+            s->nb_slices = 0;
+            goto fail;
         }
+
+        s->in_colorspace  = in->colorspace;
+        s->in_trc         = in->color_trc;
+        s->in_primaries   = in->color_primaries;
+        s->in_range       = in->color_range;
+        s->in_chromal     = in->chroma_location;
     }
 
     if (s->colorspace != -1)
@@ -639,57 +778,24 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     if (s->trc != -1)
         out->color_trc = (int)s->dst_format.transfer_characteristics;
 
+    if (s->chromal != -1)
+        out->chroma_location = (int)s->dst_format.chroma_location - 1;
+
     av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
               (int64_t)in->sample_aspect_ratio.num * outlink->h * link->w,
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    for (plane = 0; plane < 3; plane++) {
-        int p = desc->comp[plane].plane;
-        src_buf.plane[plane].data   = in->data[p];
-        src_buf.plane[plane].stride = in->linesize[p];
-        src_buf.plane[plane].mask   = -1;
-
-        p = odesc->comp[plane].plane;
-        dst_buf.plane[plane].data   = out->data[p];
-        dst_buf.plane[plane].stride = out->linesize[p];
-        dst_buf.plane[plane].mask   = -1;
-    }
-
-    ret = zimg_filter_graph_process(s->graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-    if (ret) {
-        ret = print_zimg_error(link->dst);
-        goto fail;
-    }
-
-    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        src_buf.plane[0].data   = in->data[3];
-        src_buf.plane[0].stride = in->linesize[3];
-        src_buf.plane[0].mask   = -1;
-
-        dst_buf.plane[0].data   = out->data[3];
-        dst_buf.plane[0].stride = out->linesize[3];
-        dst_buf.plane[0].mask   = -1;
-
-        ret = zimg_filter_graph_process(s->alpha_graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-        if (ret) {
-            ret = print_zimg_error(link->dst);
+    td.desc  = desc;
+    td.odesc = odesc;
+    td.in    = in;
+    td.out   = out;
+    ctx->internal->execute(ctx, filter_slice, &td, rets, s->nb_slices);
+    for (i = 0; i < s->nb_slices; i++) {
+        if (rets[i] < 0) {
+            ret = rets[i];
             goto fail;
         }
-    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        int x, y;
-
-        if (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) {
-            for (y = 0; y < out->height; y++) {
-                for (x = 0; x < out->width; x++) {
-                    AV_WN32(out->data[3] + x * odesc->comp[3].step + y * out->linesize[3],
-                            av_float2int(1.0f));
-                }
-            }
-        } else {
-            for (y = 0; y < outlink->h; y++)
-                memset(out->data[3] + y * out->linesize[3], 0xff, outlink->w);
-        }
     }
 
 fail:
@@ -705,11 +811,14 @@ fail:
 static void uninit(AVFilterContext *ctx)
 {
     ZScaleContext *s = ctx->priv;
+    int i;
 
-    zimg_filter_graph_free(s->graph);
-    zimg_filter_graph_free(s->alpha_graph);
-    av_freep(&s->tmp);
-    s->tmp_size = 0;
+    for (i = 0; i < MAX_THREADS; i++) {
+        zimg_filter_graph_free(s->graph[i]);
+        zimg_filter_graph_free(s->alpha_graph[i]);
+        av_freep(&s->tmp[i]);
+        s->tmp_size[i] = 0;
+    }
 }
 
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
@@ -890,4 +999,5 @@ AVFilter ff_vf_zscale = {
     .inputs          = avfilter_vf_zscale_inputs,
     .outputs         = avfilter_vf_zscale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -44,6 +44,8 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     AVFrame *frame = NULL;
+    /* the filter may not be in a graph yet */
+    int max_idle = link->dst->graph ? link->dst->graph->max_pool_frames : -1;
     int pool_width = 0;
     int pool_height = 0;
     int pool_align = 0;
@@ -69,6 +71,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
                                                     link->format, BUFFER_ALIGN);
         if (!link->frame_pool)
             return NULL;
+        ff_frame_pool_set_max_idle(link->frame_pool, max_idle);
     } else {
         if (ff_frame_pool_get_video_config(link->frame_pool,
                                            &pool_width, &pool_height,
@@ -84,6 +87,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
                                                         link->format, BUFFER_ALIGN);
             if (!link->frame_pool)
                 return NULL;
+            ff_frame_pool_set_max_idle(link->frame_pool, max_idle);
         }
     }
 
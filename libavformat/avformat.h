@@ -1099,7 +1099,11 @@ typedef struct AVStream {
     int64_t pts_buffer[MAX_REORDER_DELAY+1];
 
     AVIndexEntry *index_entries; /**< Only used if the format does not
-                                    support seeking natively. */
+                                    support seeking natively. Empty for the
+                                    streams with a compact index, see
+                                    AVFMT_FLAG_COMPACT_INDEX: use
+                                    avformat_index_get_entry() instead of
+                                    accessing it directly. */
     int nb_index_entries;
     unsigned int index_entries_allocated_size;
 
@@ -1501,6 +1505,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+#define AVFMT_FLAG_COMPACT_INDEX 0x400000 ///< Keep the index of the streams which support it in a compact form. AVStream.index_entries is then empty, the entries must be read with avformat_index_get_entry()
 
     /**
      * Maximum size of the data read from input for determining
@@ -2835,6 +2840,50 @@ int av_find_default_stream_index(AVFormatContext *s);
  */
 int av_index_search_timestamp(AVStream *st, int64_t timestamp, int flags);
 
+/**
+ * Get the number of entries of the index of a stream.
+ *
+ * Unlike AVStream.nb_index_entries, this also works for the streams
+ * whose index is kept in a compact form, see AVFMT_FLAG_COMPACT_INDEX.
+ *
+ * @param st stream
+ * @return the number of index entries in the stream
+ */
+int avformat_index_get_entries_count(const AVStream *st);
+
+/**
+ * Get the AVIndexEntry corresponding to the given index.
+ *
+ * @param st  stream containing the requested AVIndexEntry
+ * @param idx the desired index
+ * @return a pointer to the requested AVIndexEntry if it exists, NULL otherwise
+ *
+ * @note The pointer returned by this function is only guaranteed to be valid
+ *       until any function that takes the stream or the parent AVFormatContext
+ *       as input argument is called.
+ */
+const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx);
+
+/**
+ * Get the AVIndexEntry corresponding to the given timestamp.
+ *
+ * @param st        stream containing the requested AVIndexEntry
+ * @param wanted_timestamp timestamp to retrieve the index entry for
+ * @param flags     if AVSEEK_FLAG_BACKWARD then the returned entry will
+ *                  correspond to the timestamp which is <= the requested one,
+ *                  if backward is 0, then it will be >=
+ *                  if AVSEEK_FLAG_ANY seek to any frame, only keyframes
+ *                  otherwise
+ * @return a pointer to the requested AVIndexEntry if it exists, NULL otherwise
+ *
+ * @note The pointer returned by this function is only guaranteed to be valid
+ *       until any function that takes the stream or the parent AVFormatContext
+ *       as input argument is called.
+ */
+const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
+                                                            int64_t wanted_timestamp,
+                                                            int flags);
+
 /**
  * Add an index entry into a sorted list. Update the entry if the list
  * already contains it.
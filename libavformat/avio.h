@@ -680,6 +680,15 @@ int avio_get_str16be(AVIOContext *pb, int maxlen, char *buf, int buflen);
  */
 #define AVIO_FLAG_DIRECT 0x8000
 
+/**
+ * Read ahead in a background thread.
+ * The data following the current position is read while the caller
+ * processes the data already read, in a window which grows with the length
+ * of the sequential reads. This is ignored when writing, in direct mode,
+ * and for the protocols which do their own flow control.
+ */
+#define AVIO_FLAG_PREFETCH 0x10000
+
 /**
  * Create and initialize a AVIOContext for accessing the
  * resource indicated by url.
@@ -140,6 +140,17 @@ int ffio_fdopen(AVIOContext **s, URLContext *h);
  */
 URLContext *ffio_geturlcontext(AVIOContext *s);
 
+/**
+ * Copy size bytes from the current position of src to dst.
+ *
+ * When both contexts access file descriptors, the data is copied by the
+ * system without going through the buffers.
+ *
+ * @return the number of bytes copied, which is short of size at the end
+ *         of src, or a negative AVERROR code
+ */
+int64_t ffio_copy(AVIOContext *dst, AVIOContext *src, int64_t size);
+
 /**
  * Open a write-only fake memory stream. The written data is not stored
  * anywhere - this is only used for measuring the amount of data
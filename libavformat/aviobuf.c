@@ -30,6 +30,8 @@
 #include "avio.h"
 #include "avio_internal.h"
 #include "internal.h"
+#include "os_support.h"
+#include "prefetch.h"
 #include "url.h"
 #include <stdarg.h>
 
@@ -44,6 +46,7 @@
 
 typedef struct AVIOInternal {
     URLContext *h;
+    FFPrefetch *prefetch;
 } AVIOInternal;
 
 static void *ff_avio_child_next(void *obj, void *prev)
@@ -943,6 +946,12 @@ static int io_read_packet(void *opaque, uint8_t *buf, int buf_size)
     return ffurl_read(internal->h, buf, buf_size);
 }
 
+static int prefetch_read_packet(void *opaque, uint8_t *buf, int buf_size)
+{
+    AVIOInternal *internal = opaque;
+    return ff_prefetch_read(internal->prefetch, buf, buf_size);
+}
+
 static int io_write_packet(void *opaque, uint8_t *buf, int buf_size)
 {
     AVIOInternal *internal = opaque;
@@ -955,6 +964,12 @@ static int64_t io_seek(void *opaque, int64_t offset, int whence)
     return ffurl_seek(internal->h, offset, whence);
 }
 
+static int64_t prefetch_seek(void *opaque, int64_t offset, int whence)
+{
+    AVIOInternal *internal = opaque;
+    return ff_prefetch_seek(internal->prefetch, offset, whence);
+}
+
 static int io_short_seek(void *opaque)
 {
     AVIOInternal *internal = opaque;
@@ -1028,6 +1043,15 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     }
     (*s)->short_seek_get = io_short_seek;
     (*s)->av_class = &ff_avio_class;
+
+    /* the protocols with their own flow control are read directly */
+    if (h->flags & AVIO_FLAG_PREFETCH && !(*s)->write_flag && !(*s)->direct &&
+        !max_packet_size && h->prot && !h->prot->url_read_pause &&
+        !h->prot->url_read_seek && ff_prefetch_open(&internal->prefetch, h) >= 0) {
+        (*s)->read_packet    = prefetch_read_packet;
+        (*s)->seek           = prefetch_seek;
+        (*s)->short_seek_get = NULL;
+    }
     return 0;
 fail:
     av_freep(&internal);
@@ -1048,6 +1072,55 @@ URLContext* ffio_geturlcontext(AVIOContext *s)
         return NULL;
 }
 
+int64_t ffio_copy(AVIOContext *dst, AVIOContext *src, int64_t size)
+{
+    URLContext *dst_h = ffio_geturlcontext(dst);
+    URLContext *src_h = ffio_geturlcontext(src);
+    int64_t copied = 0;
+    uint8_t *buf;
+
+    avio_flush(dst);
+    if (dst->error)
+        return dst->error;
+
+    /* the data is not seen here, so the checksum of dst cannot be kept */
+    if (dst_h && src_h && src->buf_ptr == src->buf_end &&
+        !dst->update_checksum) {
+        int dst_fd = ffurl_get_file_handle(dst_h);
+        int src_fd = ffurl_get_file_handle(src_h);
+
+        if (dst_fd >= 0 && src_fd >= 0) {
+            copied = ff_copy_fd(dst_fd, src_fd, size);
+            if (copied < 0)
+                return copied;
+            src->pos        += copied;
+            src->bytes_read += copied;
+            dst->pos        += copied;
+            dst->written     = FFMAX(dst->written, dst->pos);
+        }
+    }
+
+    if (copied == size)
+        return copied;
+
+    buf = av_malloc(IO_BUFFER_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    while (copied < size) {
+        int len = avio_read(src, buf, FFMIN(size - copied, IO_BUFFER_SIZE));
+        if (len <= 0) {
+            if (len < 0 && len != AVERROR_EOF)
+                copied = len;
+            break;
+        }
+        avio_write(dst, buf, len);
+        copied += len;
+    }
+    av_free(buf);
+
+    return dst->error ? dst->error : copied;
+}
+
 int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 {
     uint8_t *buffer;
@@ -1192,6 +1265,7 @@ int avio_close(AVIOContext *s)
     internal = s->opaque;
     h        = internal->h;
 
+    ff_prefetch_close(&internal->prefetch);
     av_freep(&s->opaque);
     av_freep(&s->buffer);
     if (s->write_flag)
@@ -35,6 +35,7 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#include "file_uring.h"
 #include "os_support.h"
 #include "url.h"
 
@@ -74,6 +75,9 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int io_uring;
+    int direct;
+    FFFileURing *uring;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +88,8 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring", "use io_uring for reading or writing when available", offsetof(FileContext, io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "direct", "write aligned blocks with O_DIRECT, with io_uring", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -111,6 +117,8 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->uring)
+        return ff_file_uring_read(c->uring, buf, size);
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -124,6 +132,17 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->uring) {
+        ret = ff_file_uring_write(c->uring, buf, size);
+        /* less than a full buffer comes from avio_flush(), complete the
+         * writes so that the data is visible as after write() */
+        if (ret >= 0 && size < h->max_packet_size && c->blocksize >= h->max_packet_size) {
+            int err = ff_file_uring_flush(c->uring);
+            if (err < 0)
+                return err;
+        }
+        return ret;
+    }
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -131,6 +150,17 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
+
+    /* the file offset is not updated through the ring, so stop using it
+     * before letting the caller access the file directly */
+    if (c->uring) {
+        int64_t pos = ff_file_uring_seek(c->uring, 0, SEEK_CUR);
+        int ret = ff_file_uring_close(&c->uring);
+        if (ret < 0)
+            return ret;
+        if (lseek(c->fd, pos, SEEK_SET) < 0)
+            return AVERROR(errno);
+    }
     return c->fd;
 }
 
@@ -209,7 +239,7 @@ static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
     int access;
-    int fd;
+    int fd, ret;
     struct stat st;
 
     av_strstart(filename, "file:", &filename);
@@ -233,7 +263,8 @@ static int file_open(URLContext *h, const char *filename, int flags)
         return AVERROR(errno);
     c->fd = fd;
 
-    h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+    ret = fstat(fd, &st);
+    h->is_streamed = !ret && S_ISFIFO(st.st_mode);
 
     /* Buffer writes more than the default 32k to improve throughput especially
      * with networked file systems */
@@ -243,6 +274,24 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    /* a followed file never ends, reading it ahead would keep a thread
+     * polling it for as long as it is open */
+    if (c->follow)
+        h->flags &= ~AVIO_FLAG_PREFETCH;
+
+    if (c->io_uring) {
+        if (!ret && S_ISREG(st.st_mode) && !h->is_streamed && !c->follow &&
+            (flags & AVIO_FLAG_READ_WRITE) != AVIO_FLAG_READ_WRITE) {
+            ret = ff_file_uring_open(&c->uring, h, fd, filename,
+                                     (flags & AVIO_FLAG_WRITE ? FF_FILE_URING_WRITE  : 0) |
+                                     (c->direct               ? FF_FILE_URING_DIRECT : 0));
+            if (ret < 0)
+                av_log(h, AV_LOG_VERBOSE, "Not using io_uring: %s\n", av_err2str(ret));
+        } else {
+            av_log(h, AV_LOG_VERBOSE, "Not using io_uring for this file\n");
+        }
+    }
+
     return 0;
 }
 
@@ -254,10 +303,15 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
     if (whence == AVSEEK_SIZE) {
         struct stat st;
+        if (c->uring && (ret = ff_file_uring_flush(c->uring)) < 0)
+            return ret;
         ret = fstat(c->fd, &st);
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->uring)
+        return ff_file_uring_seek(c->uring, pos, whence);
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -266,7 +320,11 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = ff_file_uring_close(&c->uring);
+
+    if (close(c->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 static int file_open_dir(URLContext *h)
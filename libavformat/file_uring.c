@@ -0,0 +1,615 @@
+/*
+ * io_uring backend for the file protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* needed by O_DIRECT and syscall() */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/internal.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "file_uring.h"
+
+#if HAVE_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define NB_BLOCKS        8
+#define URING_BLOCK_SIZE (256 * 1024)
+/* number of blocks a writer waits for when all are in use */
+#define WRITE_BATCH      (NB_BLOCKS / 2)
+/* alignment of the offsets and sizes written with O_DIRECT */
+#define DIRECT_ALIGN     4096
+
+enum URingBlockState {
+    BLOCK_FREE,
+    BLOCK_FILLING,  ///< being filled by the writer
+    BLOCK_INFLIGHT, ///< queued or submitted to the kernel
+    BLOCK_DONE,     ///< read completed
+};
+
+typedef struct URingBlock {
+    uint8_t     *data;
+    struct iovec iov;
+    int64_t      pos;     ///< offset in the file
+    int          size;    ///< number of bytes to read or to write
+    int          ret;     ///< result of the request
+    int          state;
+    int          discard; ///< read no longer needed, free it once completed
+    int          direct;  ///< written to the O_DIRECT file descriptor
+} URingBlock;
+
+struct FFFileURing {
+    void        *logctx;
+    int          fd;
+    int          direct_fd;
+    int          write;
+
+    int          ring_fd;
+    void        *sq_ring;
+    void        *cq_ring;
+    size_t       sq_ring_size;
+    size_t       cq_ring_size;
+    size_t       sqes_size;
+    unsigned    *sq_tail;
+    unsigned    *sq_mask;
+    unsigned    *sq_array;
+    unsigned    *cq_head;
+    unsigned    *cq_tail;
+    unsigned    *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned     to_submit;
+    int          nb_inflight;
+    int          fixed;   ///< blocks registered with the kernel
+
+    uint8_t     *pool;
+    URingBlock   blocks[NB_BLOCKS];
+    int64_t      pos;
+
+    /* reading: blocks queued from pos on */
+    int          queue[NB_BLOCKS];
+    int          queue_start;
+    int          nb_queued;
+    int          depth;
+
+    /* writing */
+    URingBlock  *cur;
+    int          cur_capacity;
+    int          error;
+};
+
+static int uring_setup(FFFileURing *r)
+{
+    struct io_uring_params p = { 0 };
+    uint8_t *sq, *cq;
+    int single_mmap = 0;
+
+    r->ring_fd = syscall(__NR_io_uring_setup, NB_BLOCKS, &p);
+    if (r->ring_fd < 0)
+        return AVERROR(errno);
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        single_mmap     = 1;
+        r->sq_ring_size = r->cq_ring_size = FFMAX(r->sq_ring_size, r->cq_ring_size);
+    }
+#endif
+
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        r->sq_ring = NULL;
+        return AVERROR(errno);
+    }
+    if (single_mmap) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            return AVERROR(errno);
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        return AVERROR(errno);
+    }
+
+    sq = r->sq_ring;
+    cq = r->cq_ring;
+    r->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return 0;
+}
+
+/* queue a request for b, which is submitted by the next uring_wait() */
+static void uring_queue(FFFileURing *r, URingBlock *b, int fd,
+                        int fixed_opcode, int vectored_opcode)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned idx  = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    /* there are no more requests than blocks, nor blocks than entries */
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd        = fd;
+    sqe->off       = b->pos;
+    sqe->user_data = b - r->blocks;
+    if (r->fixed) {
+        sqe->opcode    = fixed_opcode;
+        sqe->addr      = (uintptr_t)b->data;
+        sqe->len       = b->size;
+        sqe->buf_index = b - r->blocks;
+    } else {
+        b->iov.iov_base = b->data;
+        b->iov.iov_len  = b->size;
+        sqe->opcode     = vectored_opcode;
+        sqe->addr       = (uintptr_t)&b->iov;
+        sqe->len        = 1;
+    }
+    r->sq_array[idx] = idx;
+    atomic_store_explicit((atomic_uint *)r->sq_tail, tail + 1, memory_order_release);
+
+    b->state = BLOCK_INFLIGHT;
+    r->to_submit++;
+    r->nb_inflight++;
+}
+
+static void write_done(FFFileURing *r, URingBlock *b)
+{
+    int done = b->ret;
+
+    if (done == -EINVAL && b->direct && r->direct_fd >= 0) {
+        av_log(r->logctx, AV_LOG_WARNING,
+               "O_DIRECT write failed, writing through the page cache\n");
+        /* the requests in flight hold their own reference to the file */
+        close(r->direct_fd);
+        r->direct_fd = -1;
+    }
+    if ((done == -EINVAL && b->direct) || done == -EINTR || done == -EAGAIN)
+        done = 0;
+    if (done < 0) {
+        if (!r->error)
+            r->error = AVERROR(-done);
+        return;
+    }
+
+    /* complete short writes synchronously */
+    while (done < b->size) {
+        ssize_t ret = pwrite(r->fd, b->data + done, b->size - done, b->pos + done);
+        if (ret <= 0) {
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (!r->error)
+                r->error = ret < 0 ? AVERROR(errno) : AVERROR(EIO);
+            return;
+        }
+        done += ret;
+    }
+}
+
+static void uring_reap(FFFileURing *r)
+{
+    unsigned head = *r->cq_head;
+    unsigned tail = atomic_load_explicit((atomic_uint *)r->cq_tail, memory_order_acquire);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        URingBlock *b = &r->blocks[cqe->user_data];
+
+        b->ret = cqe->res;
+        r->nb_inflight--;
+        if (r->write) {
+            write_done(r, b);
+            b->state = BLOCK_FREE;
+        } else {
+            b->state   = b->discard ? BLOCK_FREE : BLOCK_DONE;
+            b->discard = 0;
+        }
+    }
+    atomic_store_explicit((atomic_uint *)r->cq_head, head, memory_order_release);
+}
+
+/* submit the queued requests, and wait until at most max_inflight remain */
+static int uring_wait(FFFileURing *r, int max_inflight)
+{
+    uring_reap(r);
+    while (r->to_submit || r->nb_inflight > max_inflight) {
+        unsigned min_complete = FFMAX(r->nb_inflight - max_inflight, 0);
+        int ret = syscall(__NR_io_uring_enter, r->ring_fd, r->to_submit, min_complete,
+                          min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                return AVERROR(errno);
+        } else {
+            r->to_submit -= ret;
+        }
+        uring_reap(r);
+    }
+    return 0;
+}
+
+static URingBlock *get_free_block(FFFileURing *r)
+{
+    int i;
+
+    for (i = 0; i < NB_BLOCKS; i++)
+        if (r->blocks[i].state == BLOCK_FREE)
+            return &r->blocks[i];
+    return NULL;
+}
+
+static void read_pop(FFFileURing *r)
+{
+    URingBlock *b = &r->blocks[r->queue[r->queue_start]];
+
+    if (b->state == BLOCK_INFLIGHT)
+        b->discard = 1;
+    else
+        b->state = BLOCK_FREE;
+    r->queue_start = (r->queue_start + 1) % NB_BLOCKS;
+    r->nb_queued--;
+}
+
+static void read_reset(FFFileURing *r)
+{
+    while (r->nb_queued)
+        read_pop(r);
+    r->depth = 1;
+}
+
+static int read_fill(FFFileURing *r)
+{
+    while (r->nb_queued < r->depth) {
+        URingBlock *b = get_free_block(r);
+        int ret;
+
+        if (!b) {
+            if (r->nb_queued)
+                break;
+            /* only reads discarded by a seek are in flight */
+            if ((ret = uring_wait(r, r->nb_inflight - 1)) < 0)
+                return ret;
+            continue;
+        }
+
+        if (r->nb_queued) {
+            URingBlock *last = &r->blocks[r->queue[(r->queue_start + r->nb_queued - 1) % NB_BLOCKS]];
+            b->pos = last->pos + last->size;
+        } else {
+            b->pos = r->pos;
+        }
+        b->size = URING_BLOCK_SIZE;
+        uring_queue(r, b, r->fd, IORING_OP_READ_FIXED, IORING_OP_READV);
+        r->queue[(r->queue_start + r->nb_queued++) % NB_BLOCKS] = b - r->blocks;
+    }
+    return 0;
+}
+
+int ff_file_uring_read(FFFileURing *r, uint8_t *buf, int size)
+{
+    while (1) {
+        URingBlock *b;
+        int ret, offset;
+
+        if ((ret = read_fill(r)) < 0)
+            return ret;
+
+        /* submit the blocks queued, and wait for the first one */
+        b = &r->blocks[r->queue[r->queue_start]];
+        do {
+            ret = uring_wait(r, r->nb_inflight - (b->state == BLOCK_INFLIGHT));
+            if (ret < 0)
+                return ret;
+        } while (b->state == BLOCK_INFLIGHT);
+
+        ret = b->ret;
+        if (ret < 0) {
+            read_reset(r);
+            if (ret == -EINTR || ret == -EAGAIN)
+                continue;
+            return AVERROR(-ret);
+        }
+
+        offset = r->pos - b->pos;
+        if (offset >= ret) {
+            /* end of file, or short read: read again from the position */
+            read_reset(r);
+            if (!offset)
+                return AVERROR_EOF;
+            continue;
+        }
+
+        size = FFMIN(size, ret - offset);
+        memcpy(buf, b->data + offset, size);
+        r->pos += size;
+        if (r->pos == b->pos + b->size) {
+            read_pop(r);
+            r->depth = FFMIN(2 * r->depth, NB_BLOCKS);
+        }
+        return size;
+    }
+}
+
+static void read_seek(FFFileURing *r, int64_t pos)
+{
+    while (r->nb_queued) {
+        URingBlock *b = &r->blocks[r->queue[r->queue_start]];
+
+        if (pos < b->pos) {
+            read_reset(r);
+        } else if (pos >= b->pos + b->size) {
+            read_pop(r);
+            if (!r->nb_queued)
+                r->depth = 1;
+        } else {
+            break;
+        }
+    }
+}
+
+static void write_submit(FFFileURing *r)
+{
+    URingBlock *b = r->cur;
+
+    b->direct = r->direct_fd >= 0 &&
+                !(b->pos % DIRECT_ALIGN) && !(b->size % DIRECT_ALIGN);
+    uring_queue(r, b, b->direct ? r->direct_fd : r->fd,
+                IORING_OP_WRITE_FIXED, IORING_OP_WRITEV);
+    r->cur = NULL;
+}
+
+int ff_file_uring_write(FFFileURing *r, const uint8_t *buf, int size)
+{
+    int done = 0, ret;
+
+    while (done < size && !r->error) {
+        URingBlock *b = r->cur;
+        int len;
+
+        if (!b) {
+            /* submit the blocks filled in batches */
+            while (!(b = get_free_block(r)))
+                if ((ret = uring_wait(r, r->nb_inflight - WRITE_BATCH)) < 0)
+                    return ret;
+            b->state = BLOCK_FILLING;
+            b->pos   = r->pos;
+            b->size  = 0;
+            r->cur   = b;
+            /* end the block at an aligned offset, so that the next ones
+             * can be written directly */
+            r->cur_capacity = URING_BLOCK_SIZE;
+            if (r->direct_fd >= 0)
+                r->cur_capacity -= r->pos % DIRECT_ALIGN;
+        }
+
+        len = FFMIN(size - done, r->cur_capacity - b->size);
+        memcpy(b->data + b->size, buf + done, len);
+        b->size += len;
+        r->pos  += len;
+        done    += len;
+        if (b->size == r->cur_capacity)
+            write_submit(r);
+    }
+    return r->error ? r->error : size;
+}
+
+int ff_file_uring_flush(FFFileURing *r)
+{
+    int ret;
+
+    if (!r->write)
+        return 0;
+    if (r->cur)
+        write_submit(r);
+    if ((ret = uring_wait(r, 0)) < 0)
+        return ret;
+    return r->error;
+}
+
+int64_t ff_file_uring_seek(FFFileURing *r, int64_t pos, int whence)
+{
+    int ret;
+
+    if (whence == SEEK_CUR) {
+        pos += r->pos;
+    } else if (whence == SEEK_END) {
+        struct stat st;
+        if ((ret = ff_file_uring_flush(r)) < 0)
+            return ret;
+        if (fstat(r->fd, &st) < 0)
+            return AVERROR(errno);
+        pos += st.st_size;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+    if (pos == r->pos)
+        return pos;
+
+    if (r->write) {
+        /* the writes in flight could overlap the following ones */
+        if ((ret = ff_file_uring_flush(r)) < 0)
+            return ret;
+    } else {
+        read_seek(r, pos);
+    }
+    r->pos = pos;
+    return pos;
+}
+
+static void uring_free(FFFileURing *r)
+{
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring)
+        munmap(r->sq_ring, r->sq_ring_size);
+    if (r->ring_fd >= 0)
+        close(r->ring_fd);
+    if (r->pool)
+        munmap(r->pool, NB_BLOCKS * URING_BLOCK_SIZE);
+    if (r->direct_fd >= 0)
+        close(r->direct_fd);
+    av_free(r);
+}
+
+int ff_file_uring_open(FFFileURing **pr, void *logctx, int fd,
+                       const char *filename, int flags)
+{
+    struct iovec iov[NB_BLOCKS];
+    FFFileURing *r;
+    int i, ret;
+
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->logctx    = logctx;
+    r->fd        = fd;
+    r->direct_fd = -1;
+    r->ring_fd   = -1;
+    r->write     = !!(flags & FF_FILE_URING_WRITE);
+    r->depth     = 1;
+
+    r->pos = lseek(fd, 0, SEEK_CUR);
+    if (r->pos < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    if ((ret = uring_setup(r)) < 0)
+        goto fail;
+
+    r->pool = mmap(NULL, NB_BLOCKS * URING_BLOCK_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->pool == MAP_FAILED) {
+        r->pool = NULL;
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < NB_BLOCKS; i++) {
+        r->blocks[i].data = r->pool + i * URING_BLOCK_SIZE;
+        iov[i].iov_base   = r->blocks[i].data;
+        iov[i].iov_len    = URING_BLOCK_SIZE;
+    }
+
+    /* the registered memory is pinned, which RLIMIT_MEMLOCK may not allow */
+    r->fixed = syscall(__NR_io_uring_register, r->ring_fd,
+                       IORING_REGISTER_BUFFERS, iov, NB_BLOCKS) >= 0;
+    if (!r->fixed)
+        av_log(logctx, AV_LOG_VERBOSE, "Could not register the buffers: %s\n",
+               av_err2str(AVERROR(errno)));
+
+    if (r->write && flags & FF_FILE_URING_DIRECT) {
+#ifdef O_DIRECT
+        r->direct_fd = avpriv_open(filename, O_WRONLY | O_DIRECT);
+        if (r->direct_fd < 0)
+            av_log(logctx, AV_LOG_WARNING, "Could not open the file with O_DIRECT: %s\n",
+                   av_err2str(AVERROR(errno)));
+#else
+        av_log(logctx, AV_LOG_WARNING, "O_DIRECT is not supported\n");
+#endif
+    }
+
+    *pr = r;
+    return 0;
+
+fail:
+    uring_free(r);
+    return ret;
+}
+
+int ff_file_uring_close(FFFileURing **pr)
+{
+    FFFileURing *r = *pr;
+    int ret;
+
+    if (!r)
+        return 0;
+
+    ret = ff_file_uring_flush(r);
+    /* the kernel may still be reading into blocks discarded by a seek */
+    uring_wait(r, 0);
+
+    uring_free(r);
+    *pr = NULL;
+    return ret;
+}
+
+#else /* HAVE_IO_URING */
+
+int ff_file_uring_open(FFFileURing **r, void *logctx, int fd,
+                       const char *filename, int flags)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_file_uring_close(FFFileURing **r)
+{
+    return 0;
+}
+
+int ff_file_uring_read(FFFileURing *r, uint8_t *buf, int size)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_file_uring_write(FFFileURing *r, const uint8_t *buf, int size)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_file_uring_flush(FFFileURing *r)
+{
+    return AVERROR(ENOSYS);
+}
+
+int64_t ff_file_uring_seek(FFFileURing *r, int64_t pos, int whence)
+{
+    return AVERROR(ENOSYS);
+}
+
+#endif /* HAVE_IO_URING */
@@ -0,0 +1,85 @@
+/*
+ * io_uring backend for the file protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_FILE_URING_H
+#define AVFORMAT_FILE_URING_H
+
+#include <stdint.h>
+
+/**
+ * Reader or writer of a regular file through an io_uring.
+ *
+ * Reads are queued ahead of the reader in fixed size blocks, the number
+ * of blocks in flight growing while the file is read sequentially.
+ * Writes are copied into blocks which are submitted in batches, and
+ * completed asynchronously; an error is returned by the next call.
+ * The blocks are registered with the kernel when possible.
+ *
+ * The file offset of the file descriptor is not used nor updated.
+ */
+typedef struct FFFileURing FFFileURing;
+
+#define FF_FILE_URING_WRITE  1 ///< open for writing instead of reading
+#define FF_FILE_URING_DIRECT 2 ///< write aligned blocks with O_DIRECT
+
+/**
+ * Set up a ring for fd, starting at its current file offset.
+ *
+ * @param logctx   context used for logging
+ * @param filename name of the file, used to open it again with O_DIRECT
+ * @param flags    a combination of FF_FILE_URING_* flags
+ * @return 0 on success, AVERROR(ENOSYS) if io_uring is not available,
+ *         or another negative AVERROR code
+ */
+int ff_file_uring_open(FFFileURing **r, void *logctx, int fd,
+                       const char *filename, int flags);
+
+/**
+ * Complete the pending writes and free the ring, fd is not closed.
+ *
+ * @return 0 or the first write error which was not returned yet
+ */
+int ff_file_uring_close(FFFileURing **r);
+
+/**
+ * Read up to size bytes, like read().
+ *
+ * @return number of bytes read, AVERROR_EOF or another negative AVERROR code
+ */
+int ff_file_uring_read(FFFileURing *r, uint8_t *buf, int size);
+
+/**
+ * Queue size bytes for writing.
+ *
+ * @return size, or a negative AVERROR code
+ */
+int ff_file_uring_write(FFFileURing *r, const uint8_t *buf, int size);
+
+/**
+ * Wait for the completion of all the writes queued.
+ */
+int ff_file_uring_flush(FFFileURing *r);
+
+/**
+ * Seek, like lseek().
+ */
+int64_t ff_file_uring_seek(FFFileURing *r, int64_t pos, int whence);
+
+#endif /* AVFORMAT_FILE_URING_H */
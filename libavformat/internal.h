@@ -146,6 +146,25 @@ struct AVFormatInternal {
     int prefer_codec_framerate;
 };
 
+/**
+ * Index of a stream kept by the demuxer in its own form, e.g. resolved on
+ * demand from the sample tables of the file.
+ */
+typedef struct FFStreamIndexCallbacks {
+    /**
+     * @return the number of entries of the index
+     */
+    int (*get_entries_count)(const AVStream *st);
+    /**
+     * @return the entry idx, which exists, valid until the next call
+     */
+    const AVIndexEntry *(*get_entry)(AVStream *st, int idx);
+    /**
+     * Search the index, like ff_index_search_timestamp().
+     */
+    int (*search_timestamp)(AVStream *st, int64_t wanted_timestamp, int flags);
+} FFStreamIndexCallbacks;
+
 struct AVStreamInternal {
     /**
      * Set to 1 if the codec allows reordering, so pts can be different
@@ -192,6 +211,19 @@ struct AVStreamInternal {
     int need_context_update;
 
     FFFrac *priv_pts;
+
+    /**
+     * Compact index holding the index entries instead of
+     * AVStream.index_entries, see ff_stream_enable_compact_index().
+     */
+    struct FFStreamIndex *index;
+
+    /**
+     * Index kept by the demuxer, used instead of AVStream.index_entries by
+     * av_index_search_timestamp() and the avformat_index_get_entry*()
+     * functions if set.
+     */
+    const FFStreamIndexCallbacks *index_callbacks;
 };
 
 #ifdef __GNUC__
@@ -399,6 +431,29 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance);
 
+/**
+ * Keep the index of a stream in a compact form instead of
+ * AVStream.index_entries if AVFMT_FLAG_COMPACT_INDEX is set. The demuxer
+ * must then only access the index through av_add_index_entry(),
+ * av_index_search_timestamp() and the avformat_index_get_entry*()
+ * functions.
+ *
+ * The entries already in AVStream.index_entries are moved as they are to
+ * the compact index, so their numbers are kept even if they are not
+ * sorted by timestamp.
+ *
+ * @return 0 on success, a negative AVERROR on error
+ */
+int ff_stream_enable_compact_index(AVFormatContext *s, AVStream *st);
+
+/**
+ * Move the entries of the compact index of a stream back to
+ * AVStream.index_entries, for the demuxers which need to modify them.
+ *
+ * @return 0 on success, a negative AVERROR on error
+ */
+int ff_stream_disable_compact_index(AVStream *st);
+
 /**
  * Add a new chapter.
  *
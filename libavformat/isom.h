@@ -154,6 +154,26 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Index of a track resolved on demand from its sample tables, which are
+ * kept in their compressed form, instead of being expanded into
+ * AVStream.index_entries.
+ */
+typedef struct MOVLazyIndex {
+    int nb_entries;
+    int chunk_mode;              ///< entries are parts of uncompressed audio chunks
+    unsigned int chunk_step;     ///< samples per entry in chunk mode
+    int key_off;
+    int64_t first_dts;           ///< timestamp of the first entry
+    int64_t *stsc_first_entry;   ///< first entry of each stsc run
+    int64_t *stsc_first_dts;     ///< timestamp of each stsc run relative to first_dts, chunk mode
+    int64_t *stts_first_sample;  ///< first sample of each stts run
+    int64_t *stts_first_dts;     ///< timestamp of each stts run relative to first_dts
+    int cached;                  ///< number of the entry in entry, -1 if none
+    int64_t cached_end;          ///< end of the cached entry in the file
+    AVIndexEntry entry;
+} MOVLazyIndex;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -190,6 +210,7 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    MOVLazyIndex *lazy_index;  ///< set instead of the index entries of the AVStream
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -288,6 +309,7 @@ typedef struct MOVContext {
     int decryption_key_len;
     int enable_drefs;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
+    int lazy_index;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -2416,6 +2416,10 @@ static int matroska_parse_tracks(AVFormatContext *s)
             av_free(key_id_base64);
             return AVERROR(ENOMEM);
         }
+        if ((ret = ff_stream_enable_compact_index(s, st)) < 0) {
+            av_free(key_id_base64);
+            return ret;
+        }
 
         if (key_id_base64) {
             /* export encryption key id as base64 metadata tag */
@@ -3745,7 +3749,9 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     MatroskaDemuxContext *matroska = s->priv_data;
     MatroskaTrack *tracks = NULL;
     AVStream *st = s->streams[stream_index];
-    int i, index;
+    const AVIndexEntry *ie;
+    int64_t index_ts;
+    int i, index, nb_index_entries;
 
     /* Parse the CUES now since we need the index data to seek. */
     if (matroska->cues_parsing_deferred > 0) {
@@ -3753,13 +3759,15 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         matroska_parse_cues(matroska);
     }
 
-    if (!st->nb_index_entries)
+    nb_index_entries = avformat_index_get_entries_count(st);
+    if (!nb_index_entries)
         goto err;
-    timestamp = FFMAX(timestamp, st->index_entries[0].timestamp);
+    timestamp = FFMAX(timestamp, avformat_index_get_entry(st, 0)->timestamp);
 
-    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
-        matroska_reset_status(matroska, 0, st->index_entries[st->nb_index_entries - 1].pos);
-        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == st->nb_index_entries - 1) {
+    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 || index == nb_index_entries - 1) {
+        matroska_reset_status(matroska, 0, avformat_index_get_entry(st, nb_index_entries - 1)->pos);
+        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
+               index == avformat_index_get_entries_count(st) - 1) {
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
                 break;
@@ -3767,7 +3775,8 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     matroska_clear_queue(matroska);
-    if (index < 0 || (matroska->cues_parsing_deferred < 0 && index == st->nb_index_entries - 1))
+    if (index < 0 || (matroska->cues_parsing_deferred < 0 &&
+                      index == avformat_index_get_entries_count(st) - 1))
         goto err;
 
     tracks = matroska->tracks.elem;
@@ -3779,17 +3788,19 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     /* We seek to a level 1 element, so set the appropriate status. */
-    matroska_reset_status(matroska, 0, st->index_entries[index].pos);
+    ie = avformat_index_get_entry(st, index);
+    index_ts = ie->timestamp;
+    matroska_reset_status(matroska, 0, ie->pos);
     if (flags & AVSEEK_FLAG_ANY) {
         st->skip_to_keyframe = 0;
         matroska->skip_to_timecode = timestamp;
     } else {
         st->skip_to_keyframe = 1;
-        matroska->skip_to_timecode = st->index_entries[index].timestamp;
+        matroska->skip_to_timecode = index_ts;
     }
     matroska->skip_to_keyframe = 1;
     matroska->done             = 0;
-    ff_update_cur_dts(s, st, st->index_entries[index].timestamp);
+    ff_update_cur_dts(s, st, index_ts);
     return 0;
 err:
     // slightly hackish but allows proper fallback to
@@ -3833,22 +3844,29 @@ typedef struct {
 static CueDesc get_cue_desc(AVFormatContext *s, int64_t ts, int64_t cues_start) {
     MatroskaDemuxContext *matroska = s->priv_data;
     CueDesc cue_desc;
+    AVStream *st = s->streams[0];
+    const AVIndexEntry *ie;
+    int64_t prev_ts;
     int i;
-    int nb_index_entries = s->streams[0]->nb_index_entries;
-    AVIndexEntry *index_entries = s->streams[0]->index_entries;
+    int nb_index_entries = avformat_index_get_entries_count(st);
     if (ts >= matroska->duration * matroska->time_scale) return (CueDesc) {-1, -1, -1, -1};
+    prev_ts = avformat_index_get_entry(st, 0)->timestamp;
     for (i = 1; i < nb_index_entries; i++) {
-        if (index_entries[i - 1].timestamp * matroska->time_scale <= ts &&
-            index_entries[i].timestamp * matroska->time_scale > ts) {
+        int64_t cur_ts = avformat_index_get_entry(st, i)->timestamp;
+        if (prev_ts * matroska->time_scale <= ts &&
+            cur_ts  * matroska->time_scale > ts) {
             break;
         }
+        prev_ts = cur_ts;
     }
     --i;
-    cue_desc.start_time_ns = index_entries[i].timestamp * matroska->time_scale;
-    cue_desc.start_offset = index_entries[i].pos - matroska->segment_start;
+    ie = avformat_index_get_entry(st, i);
+    cue_desc.start_time_ns = ie->timestamp * matroska->time_scale;
+    cue_desc.start_offset = ie->pos - matroska->segment_start;
     if (i != nb_index_entries - 1) {
-        cue_desc.end_time_ns = index_entries[i + 1].timestamp * matroska->time_scale;
-        cue_desc.end_offset = index_entries[i + 1].pos - matroska->segment_start;
+        ie = avformat_index_get_entry(st, i + 1);
+        cue_desc.end_time_ns = ie->timestamp * matroska->time_scale;
+        cue_desc.end_offset = ie->pos - matroska->segment_start;
     } else {
         cue_desc.end_time_ns = matroska->duration * matroska->time_scale;
         // FIXME: this needs special handling for files where Cues appear
@@ -3865,11 +3883,11 @@ static int webm_clusters_start_with_keyframe(AVFormatContext *s)
     uint32_t id = matroska->current_id;
     int64_t cluster_pos, before_pos;
     int index, rv = 1;
-    if (s->streams[0]->nb_index_entries <= 0) return 0;
+    if (avformat_index_get_entries_count(s->streams[0]) <= 0) return 0;
     // seek to the first cluster using cues.
     index = av_index_search_timestamp(s->streams[0], 0, 0);
     if (index < 0)  return 0;
-    cluster_pos = s->streams[0]->index_entries[index].pos;
+    cluster_pos = avformat_index_get_entry(s->streams[0], index)->pos;
     before_pos = avio_tell(s->pb);
     while (1) {
         uint64_t cluster_id, cluster_length;
@@ -3993,9 +4011,9 @@ static int64_t webm_dash_manifest_compute_bandwidth(AVFormatContext *s, int64_t
     double bandwidth = 0.0;
     int i;
 
-    for (i = 0; i < st->nb_index_entries; i++) {
+    for (i = 0; i < avformat_index_get_entries_count(st); i++) {
         int64_t prebuffer_ns = 1000000000;
-        int64_t time_ns = st->index_entries[i].timestamp * matroska->time_scale;
+        int64_t time_ns = avformat_index_get_entry(st, i)->timestamp * matroska->time_scale;
         double nano_seconds_per_second = 1000000000.0;
         int64_t prebuffered_ns = time_ns + prebuffer_ns;
         double prebuffer_bytes = 0.0;
@@ -4080,7 +4098,7 @@ static int webm_dash_manifest_cues(AVFormatContext *s, int64_t init_range)
     MatroskaSeekhead *seekhead = seekhead_list->elem;
     char *buf;
     int64_t cues_start = -1, cues_end = -1, before_pos, bandwidth;
-    int i;
+    int i, nb_index_entries;
     int end = 0;
 
     // determine cues start and end positions
@@ -4133,14 +4151,15 @@ static int webm_dash_manifest_cues(AVFormatContext *s, int64_t init_range)
 
     // store cue point timestamps as a comma separated list for checking subsegment alignment in
     // the muxer. assumes that each timestamp cannot be more than 20 characters long.
-    buf = av_malloc_array(s->streams[0]->nb_index_entries, 20);
+    nb_index_entries = avformat_index_get_entries_count(s->streams[0]);
+    buf = av_malloc_array(nb_index_entries, 20);
     if (!buf) return -1;
     strcpy(buf, "");
-    for (i = 0; i < s->streams[0]->nb_index_entries; i++) {
+    for (i = 0; i < nb_index_entries; i++) {
         int ret = snprintf(buf + end, 20,
-                           "%" PRId64"%s", s->streams[0]->index_entries[i].timestamp,
-                           i != s->streams[0]->nb_index_entries - 1 ? "," : "");
-        if (ret <= 0 || (ret == 20 && i ==  s->streams[0]->nb_index_entries - 1)) {
+                           "%" PRId64"%s", avformat_index_get_entry(s->streams[0], i)->timestamp,
+                           i != nb_index_entries - 1 ? "," : "");
+        if (ret <= 0 || (ret == 20 && i == nb_index_entries - 1)) {
             av_log(s, AV_LOG_ERROR, "timestamp too long.\n");
             av_free(buf);
             return AVERROR_INVALIDDATA;
@@ -3305,6 +3305,482 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
     return *ctts_count;
 }
 
+static void mov_free_lazy_index(MOVStreamContext *sc)
+{
+    if (!sc->lazy_index)
+        return;
+    av_freep(&sc->lazy_index->stsc_first_entry);
+    av_freep(&sc->lazy_index->stsc_first_dts);
+    av_freep(&sc->lazy_index->stts_first_sample);
+    av_freep(&sc->lazy_index->stts_first_dts);
+    av_freep(&sc->lazy_index);
+}
+
+/* Find the stsc entry describing the chunk of the lazy index entry n. */
+static unsigned int lazy_stsc_index(const MOVStreamContext *sc, int n)
+{
+    const MOVLazyIndex *li = sc->lazy_index;
+    unsigned int a = 0, b = sc->stsc_count, m;
+
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (li->stsc_first_entry[m] <= n)
+            a = m;
+        else
+            b = m;
+    }
+    return a;
+}
+
+static unsigned int lazy_stsc_first_chunk(const MOVStreamContext *sc, unsigned int index)
+{
+    return index ? sc->stsc_data[index].first - 1 : 0;
+}
+
+static unsigned int lazy_chunk_entries(const MOVStreamContext *sc, unsigned int index)
+{
+    const MOVLazyIndex *li = sc->lazy_index;
+    unsigned int count = sc->stsc_data[index].count;
+
+    return li->chunk_mode ? (count + li->chunk_step - 1) / li->chunk_step : count;
+}
+
+static int64_t lazy_chunk_size(const MOVStreamContext *sc, unsigned int samples)
+{
+    if (sc->samples_per_frame > 1)
+        return samples / sc->samples_per_frame * (int64_t)sc->bytes_per_frame;
+    return samples * (int64_t)sc->sample_size;
+}
+
+static int64_t lazy_timestamp(const MOVStreamContext *sc, int n)
+{
+    const MOVLazyIndex *li = sc->lazy_index;
+    unsigned int a = 0, b = sc->stts_count, m;
+
+    if (li->chunk_mode) {
+        unsigned int index = lazy_stsc_index(sc, n);
+        unsigned int chunk_entries = lazy_chunk_entries(sc, index);
+        int64_t entry = n - li->stsc_first_entry[index];
+
+        return li->first_dts + li->stsc_first_dts[index] +
+               entry / chunk_entries * sc->stsc_data[index].count +
+               entry % chunk_entries * li->chunk_step;
+    }
+
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (li->stts_first_sample[m] <= n)
+            a = m;
+        else
+            b = m;
+    }
+    return li->first_dts + li->stts_first_dts[a] +
+           (n - li->stts_first_sample[a]) * sc->stts_data[a].duration;
+}
+
+static int lazy_all_keyframes(const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    if (sc->lazy_index->chunk_mode)
+        return 1;
+    if (sc->keyframe_absent)
+        return st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+    return !sc->keyframe_count;
+}
+
+/* Return the last keyframe at or before the entry n, -1 if there is none. */
+static int lazy_prev_keyframe(const AVStream *st, int n)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    int key_off = sc->lazy_index->key_off;
+    unsigned int a = 0, b = sc->keyframe_count, m;
+
+    if (lazy_all_keyframes(st))
+        return n;
+    if (sc->keyframe_absent)
+        return 0;
+    if (sc->keyframes[0] - key_off > n)
+        return -1;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (sc->keyframes[m] - key_off <= n)
+            a = m;
+        else
+            b = m;
+    }
+    return sc->keyframes[a] - key_off;
+}
+
+/* Return the first keyframe at or after the entry n, the number of entries
+ * if there is none. */
+static int lazy_next_keyframe(const AVStream *st, int n)
+{
+    const MOVStreamContext *sc = st->priv_data;
+    const MOVLazyIndex *li = sc->lazy_index;
+    int a = -1, b = sc->keyframe_count, m;
+
+    if (lazy_all_keyframes(st))
+        return n;
+    if (sc->keyframe_absent)
+        return n ? li->nb_entries : 0;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (sc->keyframes[m] - li->key_off >= n)
+            b = m;
+        else
+            a = m;
+    }
+    if (b == sc->keyframe_count)
+        return li->nb_entries;
+    return FFMIN(sc->keyframes[b] - li->key_off, li->nb_entries);
+}
+
+static AVIndexEntry *lazy_index_entry(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVLazyIndex *li = sc->lazy_index;
+    AVIndexEntry *e = &li->entry;
+    unsigned int index, chunk_entries, chunk, k;
+    int64_t pos;
+    int i;
+
+    if (n == li->cached)
+        return e;
+
+    index         = lazy_stsc_index(sc, n);
+    chunk_entries = lazy_chunk_entries(sc, index);
+    chunk         = lazy_stsc_first_chunk(sc, index) + (n - li->stsc_first_entry[index]) / chunk_entries;
+    k             = (n - li->stsc_first_entry[index]) % chunk_entries;
+
+    if (li->chunk_mode) {
+        unsigned int samples = FFMIN(li->chunk_step, sc->stsc_data[index].count - k * li->chunk_step);
+
+        e->pos          = sc->chunk_offsets[chunk] + k * lazy_chunk_size(sc, li->chunk_step);
+        e->size         = lazy_chunk_size(sc, samples);
+        e->min_distance = 0;
+        e->flags        = AVINDEX_KEYFRAME;
+    } else {
+        int keyframe = lazy_prev_keyframe(st, n);
+
+        if (k && li->cached == n - 1) {
+            pos = li->cached_end;
+        } else if (sc->stsz_sample_size > 0) {
+            pos = sc->chunk_offsets[chunk] + k * (int64_t)sc->stsz_sample_size;
+        } else {
+            pos = sc->chunk_offsets[chunk];
+            for (i = n - k; i < n; i++)
+                pos += sc->sample_sizes[i];
+        }
+        e->pos          = pos;
+        e->size         = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[n];
+        e->min_distance = keyframe < 0 ? n : n - keyframe;
+        e->flags        = keyframe == n ? AVINDEX_KEYFRAME : 0;
+    }
+    e->timestamp   = lazy_timestamp(sc, n);
+    li->cached     = n;
+    li->cached_end = e->pos + e->size;
+    return e;
+}
+
+/* Same as ff_index_search_timestamp() on the expanded index. */
+static int lazy_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int nb_entries = sc->lazy_index->nb_entries;
+    int a = -1, b = nb_entries, m;
+    int64_t timestamp;
+
+    if (b && lazy_timestamp(sc, b - 1) < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        m         = (a + b) >> 1;
+        timestamp = lazy_timestamp(sc, m);
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY) && m >= 0 && m < nb_entries)
+        m = (flags & AVSEEK_FLAG_BACKWARD) ? lazy_prev_keyframe(st, m) :
+                                             lazy_next_keyframe(st, m);
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
+static int lazy_get_entries_count(const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    return sc->lazy_index->nb_entries;
+}
+
+static const AVIndexEntry *lazy_get_entry(AVStream *st, int n)
+{
+    return lazy_index_entry(st, n);
+}
+
+/* makes the lazy index visible to the generic index functions */
+static const FFStreamIndexCallbacks lazy_index_callbacks = {
+    .get_entries_count = lazy_get_entries_count,
+    .get_entry         = lazy_get_entry,
+    .search_timestamp  = lazy_search_timestamp,
+};
+
+static int mov_index_entries_count(const AVStream *st)
+{
+    return avformat_index_get_entries_count(st);
+}
+
+/**
+ * Get the index entry n of a stream, which must exist. With a lazy or a
+ * compact index, the entry is only valid until the next call for the same
+ * stream.
+ */
+static const AVIndexEntry *mov_index_entry(AVStream *st, int n)
+{
+    return avformat_index_get_entry(st, n);
+}
+
+static int64_t mov_index_timestamp(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    return sc->lazy_index ? lazy_timestamp(sc, n) : avformat_index_get_entry(st, n)->timestamp;
+}
+
+static int mov_index_search_timestamp(AVStream *st, int64_t timestamp, int flags)
+{
+    return av_index_search_timestamp(st, timestamp, flags);
+}
+
+/**
+ * Set up a lazy index for the track instead of filling st->index_entries.
+ * This is only done when the entries are a plain function of the sample
+ * tables, i.e. when expanding them would not involve any of the
+ * corrections mov_build_index() and mov_fix_index() apply to broken or
+ * edited tracks.
+ *
+ * @param current_dts timestamp of the first sample before the dts shift
+ * @return 1 if the lazy index was set up, 0 if the index should be built
+ */
+static int mov_build_lazy_index(MOVContext *mov, AVStream *st, int64_t current_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVLazyIndex *li;
+    int chunk_mode = st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                     sc->stts_count == 1 && sc->stts_data[0].duration == 1;
+    int64_t edit_list_duration = 0, total = 0, dts = 0;
+    uint64_t stream_size = 0;
+    unsigned int chunk_step = 1, i;
+    int edit_list = 0;
+
+    if (!sc->chunk_count)
+        return 0;
+
+    if (!mov->ignore_editlist && mov->advanced_editlist && sc->elst_data && sc->elst_count) {
+        /* a single edit covering the whole media leaves the index unchanged */
+        if (sc->elst_count != 1 || sc->elst_data[0].time || sc->ctts_data ||
+            mov->time_scale <= 0)
+            return 0;
+        edit_list_duration = av_rescale(sc->elst_data[0].duration,
+                                        sc->time_scale, mov->time_scale);
+        edit_list = 1;
+    }
+
+    if (chunk_mode) {
+        if (sc->samples_per_frame >= 160 ||
+            (sc->samples_per_frame > 1 && !sc->bytes_per_frame))
+            return 0;
+        chunk_step = sc->samples_per_frame > 1 ?
+                     1024 / sc->samples_per_frame * sc->samples_per_frame : 1024;
+        for (i = 0; i < sc->stsc_count; i++) {
+            unsigned int count = sc->stsc_data[i].count;
+            if ((i != sc->stsc_count - 1 && sc->samples_per_frame &&
+                 count % sc->samples_per_frame) ||
+                lazy_chunk_size(sc, FFMIN(count, chunk_step)) > 0x3FFFFFFF)
+                return 0;
+        }
+    } else {
+        if (!sc->sample_count || sc->stps_count ||
+            (sc->rap_group_count && sc->rap_group) ||
+            sc->sample_count >= UINT_MAX / sizeof(*st->index_entries))
+            return 0;
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->pseudo_stream_id != -1 &&
+                sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return 0;
+        for (i = 0; i < sc->stts_count; i++)
+            if (sc->stts_data[i].duration < 0 ||
+                (!sc->stts_data[i].count && i + 1 < sc->stts_count))
+                return 0;
+        for (i = 0; i < sc->keyframe_count; i++)
+            if (sc->keyframes[i] < 0 || (i && sc->keyframes[i] <= sc->keyframes[i - 1]))
+                return 0;
+        if (sc->stsz_sample_size > 0 && sc->stsz_sample_size < sc->sample_size)
+            return 0;
+        if (sc->sample_size > 0 && sc->sample_size < sc->stsz_sample_size) {
+            unsigned int stsc_index = 0;
+            for (i = 0; i + 1 < sc->chunk_count; i++) {
+                int64_t chunk_size = sc->chunk_offsets[i + 1] - sc->chunk_offsets[i];
+                while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
+                       i + 1 == sc->stsc_data[stsc_index + 1].first)
+                    stsc_index++;
+                if (chunk_size > 0 &&
+                    sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > chunk_size)
+                    return 0;
+            }
+        }
+    }
+
+    li = av_mallocz(sizeof(*li));
+    if (!li)
+        return 0;
+    sc->lazy_index    = li;
+    li->chunk_mode    = chunk_mode;
+    li->chunk_step    = chunk_step;
+    li->cached        = -1;
+    li->first_dts     = chunk_mode ? current_dts : current_dts - sc->dts_shift;
+    li->key_off       = sc->keyframe_count && sc->keyframes[0] > 0;
+    li->stsc_first_entry = av_malloc_array(sc->stsc_count, sizeof(*li->stsc_first_entry));
+    li->stsc_first_dts   = av_malloc_array(sc->stsc_count, sizeof(*li->stsc_first_dts));
+    if (!li->stsc_first_entry || !li->stsc_first_dts)
+        goto fail;
+
+    for (i = 0; i < sc->stsc_count; i++) {
+        unsigned int chunks = (i + 1 < sc->stsc_count ? sc->stsc_data[i + 1].first - 1 : sc->chunk_count) -
+                              lazy_stsc_first_chunk(sc, i);
+        li->stsc_first_entry[i] = total;
+        li->stsc_first_dts[i]   = dts;
+        total += chunks * (int64_t)lazy_chunk_entries(sc, i);
+        dts   += chunks * (int64_t)sc->stsc_data[i].count;
+    }
+    if (total >= UINT_MAX / sizeof(*st->index_entries) ||
+        (!chunk_mode && total > sc->sample_count))
+        goto fail;
+    li->nb_entries = total;
+
+    if (!chunk_mode) {
+        li->stts_first_sample = av_malloc_array(sc->stts_count, sizeof(*li->stts_first_sample));
+        li->stts_first_dts    = av_malloc_array(sc->stts_count, sizeof(*li->stts_first_dts));
+        if (!li->stts_first_sample || !li->stts_first_dts)
+            goto fail;
+        for (i = 0, total = 0, dts = 0; i < sc->stts_count; i++) {
+            li->stts_first_sample[i] = total;
+            li->stts_first_dts[i]    = dts;
+            total += sc->stts_data[i].count;
+            dts   += sc->stts_data[i].count * (int64_t)sc->stts_data[i].duration;
+        }
+
+        for (i = 0; i < li->nb_entries; i++) {
+            unsigned int sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[i];
+            if (sample_size > 0x3FFFFFFF)
+                goto fail;
+            stream_size += sample_size;
+        }
+    }
+
+    if (edit_list) {
+        if (lazy_timestamp(sc, li->nb_entries - 1) >= edit_list_duration ||
+            (li->nb_entries > 1 && lazy_timestamp(sc, 1) <= 0))
+            goto fail;
+        st->start_time = 0;
+        st->duration   = FFMIN(st->duration, edit_list_duration);
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+            st->skip_samples = 0;
+        sc->start_pad = st->skip_samples;
+    }
+
+    if (!chunk_mode) {
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            for (i = 0; i < FFMIN(li->nb_entries, 99); i++)
+                ff_rfps_add_frame(mov->fc, st, lazy_timestamp(sc, i));
+        if (st->duration > 0)
+            st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+    }
+
+    st->internal->index_callbacks = &lazy_index_callbacks;
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: %d index entries resolved on demand\n",
+           st->index, li->nb_entries);
+    return 1;
+fail:
+    mov_free_lazy_index(sc);
+    return 0;
+}
+
+/**
+ * Expand the ctts entries such that there is a 1-1 mapping with the samples.
+ */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVStts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    unsigned int i, j;
+
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR_INVALIDDATA;
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (i = 0; i < ctts_count_old &&
+                sc->ctts_count < sc->sample_count; i++)
+        for (j = 0; j < ctts_data_old[i].count &&
+                    sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/**
+ * Replace the lazy index of a track by the index entries it describes,
+ * for the code which needs to modify them.
+ */
+static int mov_expand_lazy_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *entries;
+    int i, ret;
+
+    if (!sc->lazy_index)
+        return 0;
+
+    if (!sc->lazy_index->chunk_mode && sc->ctts_data) {
+        if ((ret = mov_expand_ctts(sc)) < 0)
+            return ret;
+        sc->ctts_index  = FFMIN(sc->current_sample, sc->ctts_count);
+        sc->ctts_sample = 0;
+    }
+
+    entries = av_malloc_array(sc->lazy_index->nb_entries, sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < sc->lazy_index->nb_entries; i++)
+        entries[i] = *lazy_index_entry(st, i);
+
+    av_freep(&st->index_entries);
+    st->index_entries = entries;
+    st->nb_index_entries = sc->lazy_index->nb_entries;
+    st->index_entries_allocated_size = st->nb_index_entries * sizeof(*entries);
+    st->internal->index_callbacks = NULL;
+    mov_free_lazy_index(sc);
+    return 0;
+}
+
 #define MAX_REORDER_DELAY 16
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st) {
     MOVStreamContext *msc = st->priv_data;
@@ -3321,14 +3797,14 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st) {
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
         st->codecpar->video_delay = 0;
-        for(ind = 0; ind < st->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        for(ind = 0; ind < mov_index_entries_count(st) && ctts_ind < msc->ctts_count; ++ind) {
             // Point j to the last elem of the buffer and insert the current pts there.
             j = buf_start;
             buf_start = (buf_start + 1);
             if (buf_start == MAX_REORDER_DELAY + 1)
                 buf_start = 0;
 
-            pts_buf[j] = st->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            pts_buf[j] = mov_index_timestamp(st, ind) + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3728,8 +4204,6 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     unsigned int stps_index = 0;
     unsigned int i, j;
     uint64_t stream_size = 0;
-    MOVStts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
 
     if (sc->elst_count) {
         int i, edit_start_index = 0, multiple_edits = 0;
@@ -3771,8 +4245,11 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-          sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
+    if (mov->lazy_index && !st->nb_index_entries &&
+        mov_build_lazy_index(mov, st, current_dts)) {
+        /* the entries are resolved from the sample tables when needed */
+    } else if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                 sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
         unsigned int sample_size;
@@ -3799,30 +4276,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
-                return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
-                return;
-            }
-
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
+        if (sc->ctts_data && mov_expand_ctts(sc) < 0)
+            return;
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -4035,8 +4490,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 
     // Update start time of the stream.
-    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries > 0) {
-        st->start_time = st->index_entries[0].timestamp + sc->dts_shift;
+    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && mov_index_entries_count(st) > 0) {
+        st->start_time = mov_index_timestamp(st, 0) + sc->dts_shift;
         if (sc->ctts_data) {
             st->start_time += sc->ctts_data[0].duration;
         }
@@ -4273,11 +4728,13 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
+    /* Do not need those anymore, unless the samples are resolved from them. */
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+    }
     av_freep(&sc->stps_data);
     av_freep(&sc->elst_data);
     av_freep(&sc->rap_group);
@@ -4690,7 +5147,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -4716,6 +5173,9 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if ((ret = mov_expand_lazy_index(st)) < 0 ||
+        (ret = ff_stream_disable_compact_index(st)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -7011,10 +7471,10 @@ static void mov_read_chapters(AVFormatContext *s)
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
             st->disposition |= AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS;
-            if (st->nb_index_entries) {
+            if (mov_index_entries_count(st)) {
                 // Retrieve the first frame, if possible
                 AVPacket pkt;
-                AVIndexEntry *sample = &st->index_entries[0];
+                const AVIndexEntry *sample = mov_index_entry(st, 0);
                 if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
                     av_log(s, AV_LOG_ERROR, "Failed to retrieve first frame\n");
                     goto finish;
@@ -7031,9 +7491,9 @@ static void mov_read_chapters(AVFormatContext *s)
             st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
             st->codecpar->codec_id = AV_CODEC_ID_BIN_DATA;
             st->discard = AVDISCARD_ALL;
-            for (i = 0; i < st->nb_index_entries; i++) {
-                AVIndexEntry *sample = &st->index_entries[i];
-                int64_t end = i+1 < st->nb_index_entries ? st->index_entries[i+1].timestamp : st->duration;
+            for (i = 0; i < mov_index_entries_count(st); i++) {
+                int64_t end = i+1 < mov_index_entries_count(st) ? mov_index_timestamp(st, i+1) : st->duration;
+                const AVIndexEntry *sample = mov_index_entry(st, i);
                 uint8_t *title;
                 uint16_t ch;
                 int len, title_len;
@@ -7106,10 +7566,10 @@ static int mov_read_rtmd_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     int hh, mm, ss, ff, drop;
 
-    if (!st->nb_index_entries)
+    if (!mov_index_entries_count(st))
         return -1;
 
-    avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
+    avio_seek(sc->pb, mov_index_entry(st, 0)->pos, SEEK_SET);
     avio_skip(s->pb, 13);
     hh = avio_r8(s->pb);
     mm = avio_r8(s->pb);
@@ -7131,10 +7591,10 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     uint32_t value;
 
-    if (!st->nb_index_entries)
+    if (!mov_index_entries_count(st))
         return -1;
 
-    avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
+    avio_seek(sc->pb, mov_index_entry(st, 0)->pos, SEEK_SET);
     value = avio_rb32(s->pb);
 
     if (sc->tmcd_flags & 0x0001) flags |= AV_TIMECODE_FLAG_DROPFRAME;
@@ -7199,6 +7659,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->rap_group);
         av_freep(&sc->display_matrix);
         av_freep(&sc->index_ranges);
+        mov_free_lazy_index(sc);
 
         if (sc->extradata)
             for (j = 0; j < sc->stsd_count; j++)
@@ -7581,6 +8042,16 @@ static int mov_read_header(AVFormatContext *s)
             break;
         }
     }
+    /* the index of fragmented files is updated while demuxing */
+    if (!mov->trex_count && !mov->frag_index.nb_items) {
+        for (i = 0; i < s->nb_streams; i++) {
+            MOVStreamContext *sc = s->streams[i]->priv_data;
+            if (!sc->lazy_index &&
+                (err = ff_stream_enable_compact_index(s, s->streams[i])) < 0)
+                return err;
+        }
+    }
+
     ff_configure_buffers_for_index(s, AV_TIME_BASE);
 
     for (i = 0; i < mov->frag_index.nb_items; i++)
@@ -7590,16 +8061,16 @@ static int mov_read_header(AVFormatContext *s)
     return 0;
 }
 
-static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
+static const AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
 {
-    AVIndexEntry *sample = NULL;
+    const AVIndexEntry *sample = NULL;
     int64_t best_dts = INT64_MAX;
     int i;
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_index_entries_count(avst)) {
+            const AVIndexEntry *current_sample = mov_index_entry(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -7685,20 +8156,23 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    const AVIndexEntry *next;
+    AVIndexEntry entry, *sample = &entry;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
     mov->fc = s;
  retry:
-    sample = mov_find_next_sample(s, &st);
-    if (!sample || (mov->next_root_atom && sample->pos > mov->next_root_atom)) {
+    next = mov_find_next_sample(s, &st);
+    if (!next || (mov->next_root_atom && next->pos > mov->next_root_atom)) {
         if (!mov->next_root_atom)
             return AVERROR_EOF;
         if ((ret = mov_switch_root(s, mov->next_root_atom, -1)) < 0)
             return ret;
         goto retry;
     }
+    /* the entry returned may be overwritten by the next index accesses */
+    entry = *next;
     sc = st->priv_data;
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
@@ -7774,8 +8248,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_index_entries_count(st)) ?
+            mov_index_timestamp(st, sc->current_sample) : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -7848,9 +8322,9 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    sample = mov_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_index_entries_count(st) && timestamp < mov_index_timestamp(st, 0))
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -7905,7 +8379,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
+        int64_t seek_timestamp = mov_index_timestamp(st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
             int64_t timestamp;
@@ -7928,7 +8402,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         }
         while (1) {
             MOVStreamContext *sc;
-            AVIndexEntry *entry = mov_find_next_sample(s, &st);
+            const AVIndexEntry *entry = mov_find_next_sample(s, &st);
             if (!entry)
                 return AVERROR_INVALIDDATA;
             sc = st->priv_data;
@@ -7959,6 +8433,10 @@ static const AVOption mov_options[] = {
         0, 1, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
+    {"lazy_index",
+        "Resolve the samples from the sample tables when needed instead of building the whole index",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"use_mfra_for",
         "use mfra for fragment timestamps",
         OFFSET(use_mfra_for), AV_OPT_TYPE_INT, {.i64 = FF_MOV_FLAG_MFRA_AUTO},
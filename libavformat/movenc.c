@@ -49,14 +49,21 @@
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/random_seed.h"
 #include "libavutil/stereo3d.h"
 #include "libavutil/timecode.h"
 #include "libavutil/color_utils.h"
 #include "hevc.h"
 #include "rtpenc.h"
 #include "mov_chan.h"
+#include "os_support.h"
 #include "vpcc.h"
 
+#include <fcntl.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -104,6 +111,9 @@ static const AVOption options[] = {
     { "wallclock", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_WALLCLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "pts", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_PTS}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "empty_hdlr_name", "write zero-length name string in hdlr atoms within mdia and minf atoms", offsetof(MOVMuxContext, empty_hdlr_name), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "faststart_mode", "How to put the moov atom at the beginning of the file with faststart", offsetof(MOVMuxContext, faststart_mode), AV_OPT_TYPE_INT, {.i64 = MOV_FASTSTART_SHIFT}, 0, MOV_FASTSTART_TEMP, AV_OPT_FLAG_ENCODING_PARAM, "faststart_mode"},
+    { "shift", "Move the media data in a second pass", 0, AV_OPT_TYPE_CONST, {.i64 = MOV_FASTSTART_SHIFT}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "faststart_mode"},
+    { "temp", "Write the media data to a temporary file, and append it after the moov atom", 0, AV_OPT_TYPE_CONST, {.i64 = MOV_FASTSTART_TEMP}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "faststart_mode"},
     { NULL },
 };
 
@@ -5287,6 +5297,8 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             }
             pb = mov->mdat_buf;
         }
+    } else if (mov->mdat_pb) {
+        pb = mov->mdat_pb;
     }
 
     if (par->codec_id == AV_CODEC_ID_AMR_NB) {
@@ -5978,6 +5990,12 @@ static void mov_free(AVFormatContext *s)
     }
 
     av_freep(&mov->tracks);
+
+    avio_closep(&mov->mdat_pb);
+    if (mov->mdat_temp_url) {
+        avpriv_io_delete(mov->mdat_temp_url);
+        av_freep(&mov->mdat_temp_url);
+    }
 }
 
 static uint32_t rgb_to_yuv(uint32_t rgb)
@@ -6097,6 +6115,12 @@ static int mov_init(AVFormatContext *s)
     }
 
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->faststart_mode == MOV_FASTSTART_TEMP && mov->reserved_moov_size &&
+            !(mov->flags & FF_MOV_FLAG_FRAGMENT)) {
+            av_log(s, AV_LOG_ERROR,
+                   "faststart_mode temp is incompatible with moov_size\n");
+            return AVERROR(EINVAL);
+        }
         mov->reserved_moov_size = -1;
     }
 
@@ -6134,10 +6158,15 @@ static int mov_init(AVFormatContext *s)
         return AVERROR(EINVAL);
     }
 
-    /* Non-seekable output is ok if using fragmentation. If ism_lookahead
-     * is enabled, we don't support non-seekable output at all. */
+    if (!(mov->flags & FF_MOV_FLAG_FASTSTART) || mov->flags & FF_MOV_FLAG_FRAGMENT)
+        mov->faststart_mode = MOV_FASTSTART_SHIFT;
+
+    /* Non-seekable output is ok if using fragmentation, or if the media data
+     * is written to a temporary file. If ism_lookahead is enabled, we don't
+     * support non-seekable output at all. */
     if (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
-        (!(mov->flags & FF_MOV_FLAG_FRAGMENT) || mov->ism_lookahead)) {
+        (!(mov->flags & FF_MOV_FLAG_FRAGMENT) || mov->ism_lookahead) &&
+        mov->faststart_mode != MOV_FASTSTART_TEMP) {
         av_log(s, AV_LOG_ERROR, "muxer does not support non seekable output\n");
         return AVERROR(EINVAL);
     }
@@ -6362,6 +6391,74 @@ static int mov_init(AVFormatContext *s)
     return 0;
 }
 
+/* create a new file with a unique name next to the output, never reusing an
+ * existing one */
+static int mov_create_mdat_temp(const char *path, char **url)
+{
+    int i, fd;
+
+    for (i = 0; i < 100; i++) {
+        char *filename = av_asprintf("%s.%08"PRIx32".mdat", path,
+                                     av_get_random_seed());
+        if (!filename)
+            return AVERROR(ENOMEM);
+        fd = avpriv_open(filename, O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            close(fd);
+            *url = av_asprintf("file:%s", filename);
+            av_free(filename);
+            return *url ? 0 : AVERROR(ENOMEM);
+        }
+        av_free(filename);
+        if (errno != EEXIST)
+            return AVERROR(errno);
+    }
+    return AVERROR(EEXIST);
+}
+
+static int mov_open_mdat_temp(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    const char *proto = avio_find_protocol_name(s->url);
+    const char *path = s->url;
+    int ret;
+
+    /* next to the output, so that the system can copy it within the same
+     * file system */
+    if (proto && !strcmp(proto, "file")) {
+        av_strstart(path, "file:", &path);
+        ret = mov_create_mdat_temp(path, &mov->mdat_temp_url);
+    } else {
+        char *filename;
+        int fd = avpriv_tempfile("ffmpeg-mdat-", &filename, 0, s);
+        if (fd < 0)
+            return fd;
+        close(fd);
+        mov->mdat_temp_url = av_asprintf("file:%s", filename);
+        ret = mov->mdat_temp_url ? 0 : AVERROR(ENOMEM);
+        if (ret < 0)
+            unlink(filename);
+        av_free(filename);
+    }
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to create a temporary file for the "
+               "media data\n");
+        return ret;
+    }
+
+    ret = ffio_open_whitelist(&mov->mdat_pb, mov->mdat_temp_url, AVIO_FLAG_WRITE,
+                              &s->interrupt_callback, NULL,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to open the temporary file %s "
+               "for the media data\n", mov->mdat_temp_url);
+        avpriv_io_delete(mov->mdat_temp_url);
+        av_freep(&mov->mdat_temp_url);
+        return ret;
+    }
+    return 0;
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -6442,7 +6539,12 @@ static int mov_write_header(AVFormatContext *s)
     } else {
         if (mov->flags & FF_MOV_FLAG_FASTSTART)
             mov->reserved_header_pos = avio_tell(pb);
-        mov_write_mdat_tag(pb, mov);
+        if (mov->faststart_mode == MOV_FASTSTART_TEMP) {
+            if ((ret = mov_open_mdat_temp(s)) < 0)
+                return ret;
+        } else {
+            mov_write_mdat_tag(pb, mov);
+        }
     }
 
     ff_parse_creation_time_metadata(s, &mov->time, 1);
@@ -6639,6 +6741,69 @@ end:
     return ret;
 }
 
+/* The media data is in the temporary file, so the moov atom can be written
+ * at the current position, and the media data appended after it. The output
+ * is not seeked, and the layout is the same as with the second pass. */
+static int mov_write_moov_and_mdat(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb, *moov_buf;
+    uint8_t *buf;
+    int64_t copied;
+    int i, size, ret;
+
+    avio_flush(mov->mdat_pb);
+    ret = mov->mdat_pb->error;
+    avio_closep(&mov->mdat_pb);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < mov->nb_streams; i++)
+        mov->tracks[i].data_offset = mov->reserved_header_pos + 16;
+    if ((ret = compute_moov_size(s)) < 0)
+        return ret;
+
+    if ((ret = avio_open_dyn_buf(&moov_buf)) < 0)
+        return ret;
+    ret  = mov_write_moov_tag(moov_buf, mov, s);
+    size = avio_close_dyn_buf(moov_buf, &buf);
+    if (ret >= 0)
+        avio_write(pb, buf, size);
+    av_free(buf);
+    if (ret < 0)
+        return ret;
+
+    if (mov->mdat_size + 8 <= UINT32_MAX) {
+        avio_wb32(pb, 8);
+        ffio_wfourcc(pb, mov->mode == MODE_MOV ? "wide" : "free");
+        avio_wb32(pb, mov->mdat_size + 8);
+        ffio_wfourcc(pb, "mdat");
+    } else {
+        avio_wb32(pb, 1);
+        ffio_wfourcc(pb, "mdat");
+        avio_wb64(pb, mov->mdat_size + 16);
+    }
+
+    ret = ffio_open_whitelist(&mov->mdat_pb, mov->mdat_temp_url, AVIO_FLAG_READ,
+                              &s->interrupt_callback, NULL,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to reopen the temporary file %s\n",
+               mov->mdat_temp_url);
+        return ret;
+    }
+    copied = ffio_copy(pb, mov->mdat_pb, mov->mdat_size);
+    if (copied < 0)
+        return copied;
+    if (copied != mov->mdat_size) {
+        av_log(s, AV_LOG_ERROR, "Only %"PRId64" of %"PRIu64" bytes of media "
+               "data could be read back from %s\n", copied, mov->mdat_size,
+               mov->mdat_temp_url);
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6685,7 +6850,9 @@ static int mov_write_trailer(AVFormatContext *s)
         }
     }
 
-    if (!(mov->flags & FF_MOV_FLAG_FRAGMENT)) {
+    if (mov->mdat_pb) {
+        res = mov_write_moov_and_mdat(s);
+    } else if (!(mov->flags & FF_MOV_FLAG_FRAGMENT)) {
         moov_pos = avio_tell(pb);
 
         /* Write size of mdat tag */
@@ -177,6 +177,11 @@ typedef enum {
     MOV_PRFT_NB
 } MOVPrftBox;
 
+typedef enum {
+    MOV_FASTSTART_SHIFT = 0, ///< move the media data in a second pass
+    MOV_FASTSTART_TEMP,      ///< write the media data to a temporary file
+} MOVFastStartMode;
+
 typedef struct MOVMuxContext {
     const AVClass *av_class;
     int     mode;
@@ -234,6 +239,10 @@ typedef struct MOVMuxContext {
     int write_tmcd;
     MOVPrftBox write_prft;
     int empty_hdlr_name;
+
+    MOVFastStartMode faststart_mode;
+    AVIOContext *mdat_pb;   ///< temporary file holding the media data with MOV_FASTSTART_TEMP
+    char *mdat_temp_url;
 } MOVMuxContext;
 
 #define FF_MOV_FLAG_RTP_HINT              (1 <<  0)
@@ -23,11 +23,66 @@
 /* needed by inet_aton() */
 #define _DEFAULT_SOURCE
 #define _SVID_SOURCE
+/* needed by copy_file_range() */
+#define _GNU_SOURCE
 
 #include "config.h"
 #include "avformat.h"
 #include "os_support.h"
 
+#if HAVE_COPY_FILE_RANGE || HAVE_SENDFILE
+#include <errno.h>
+#include <unistd.h>
+#endif
+#if HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
+int64_t ff_copy_fd(int dst_fd, int src_fd, int64_t size)
+{
+    int64_t copied = 0;
+#if HAVE_COPY_FILE_RANGE || HAVE_SENDFILE
+    int use_copy_file_range = HAVE_COPY_FILE_RANGE;
+
+    while (copied < size) {
+        size_t len = FFMIN(size - copied, 1 << 30);
+        ssize_t ret;
+
+#if HAVE_COPY_FILE_RANGE
+        if (use_copy_file_range) {
+            ret = copy_file_range(src_fd, NULL, dst_fd, NULL, len, 0);
+            /* not regular files, or not on the same file system with
+             * older kernels */
+            if (ret < 0 && (errno == EXDEV || errno == EINVAL ||
+                            errno == EBADF || errno == ENOSYS ||
+                            errno == EOPNOTSUPP)) {
+                use_copy_file_range = 0;
+                continue;
+            }
+        } else
+#endif
+        {
+#if HAVE_SENDFILE
+            ret = sendfile(dst_fd, src_fd, NULL, len);
+            if (ret < 0 && (errno == EINVAL || errno == ENOSYS))
+                break;
+#else
+            break;
+#endif
+        }
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        if (!ret)
+            break;
+        copied += ret;
+    }
+#endif
+    return copied;
+}
+
 #if CONFIG_NETWORK
 #include <fcntl.h>
 #if !HAVE_POLL_H
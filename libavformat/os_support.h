@@ -29,6 +29,7 @@
 
 #include "config.h"
 
+#include <stdint.h>
 #include <sys/stat.h>
 
 #ifdef _WIN32
@@ -85,6 +86,17 @@ static inline int is_dos_path(const char *path)
 #endif
 #endif
 
+/**
+ * Copy up to size bytes from the current position of the file descriptor
+ * src_fd to the current position of dst_fd within the kernel, with
+ * copy_file_range() or sendfile().
+ *
+ * @return the number of bytes copied, which is short of size if the
+ *         system cannot copy between these descriptors, or a negative
+ *         AVERROR code on I/O error
+ */
+int64_t ff_copy_fd(int dst_fd, int src_fd, int64_t size);
+
 #if CONFIG_NETWORK
 #if defined(_WIN32)
 #define SHUT_RD SD_RECEIVE
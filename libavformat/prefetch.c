@@ -0,0 +1,365 @@
+/*
+ * Background readahead for AVIOContext
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Based on libavformat/async.c
+ */
+
+#include "config.h"
+
+#include <stdatomic.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/error.h"
+#include "libavutil/fifo.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "avio.h"
+#include "prefetch.h"
+#include "url.h"
+
+#if HAVE_THREADS
+
+#define MIN_CAPACITY        (256 * 1024)
+#define MAX_CAPACITY        (64 * 1024 * 1024)
+#define READ_BACK_CAPACITY  (256 * 1024)
+#define MAX_READ_SIZE       (1024 * 1024)
+
+struct FFPrefetch {
+    URLContext     *h;
+    AVIOInterruptCB interrupt_callback; ///< the callback of h, which is replaced
+
+    /* the data before the position of the reader, up to READ_BACK_CAPACITY,
+     * then the data read ahead, up to capacity */
+    AVFifoBuffer   *fifo;
+    int             read_pos;
+    uint8_t        *read_buf;
+
+    int             capacity;
+    int64_t         sequential; ///< bytes read since the last seek
+    int64_t         pos;
+
+    int             seek_request;
+    int64_t         seek_pos;
+    int             seek_whence;
+    int             seek_completed;
+    int64_t         seek_ret;
+
+    int             eof;
+    int             io_error;
+    int             abort_request;
+    atomic_int      interrupt;  ///< a seek or the end was requested
+
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_wakeup_main;
+    pthread_cond_t  cond_wakeup_background;
+};
+
+static void prefetch_reset(FFPrefetch *p)
+{
+    av_fifo_reset(p->fifo);
+    p->read_pos = 0;
+    p->eof      = 0;
+    p->io_error = 0;
+
+    /* give back the memory of a window which shrank */
+    if (av_fifo_space(p->fifo) > 2 * (p->capacity + READ_BACK_CAPACITY)) {
+        AVFifoBuffer *fifo = av_fifo_alloc(p->capacity + READ_BACK_CAPACITY);
+        if (fifo) {
+            av_fifo_freep(&p->fifo);
+            p->fifo = fifo;
+        }
+    }
+}
+
+/* interrupt the blocking I/O of the thread when the reader needs it */
+static int prefetch_check_interrupt(void *arg)
+{
+    FFPrefetch *p = arg;
+
+    return atomic_load(&p->interrupt) || ff_check_interrupt(&p->interrupt_callback);
+}
+
+static void *prefetch_task(void *arg)
+{
+    FFPrefetch *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    while (!p->abort_request) {
+        int ahead = av_fifo_size(p->fifo) - p->read_pos;
+        int ret, to_read;
+
+        if (p->seek_request) {
+            int64_t seek_ret = ffurl_seek(p->h, p->seek_pos, p->seek_whence);
+            if (seek_ret >= 0 && p->seek_whence != AVSEEK_SIZE)
+                prefetch_reset(p);
+
+            p->seek_ret       = seek_ret;
+            p->seek_request   = 0;
+            p->seek_completed = 1;
+            atomic_store(&p->interrupt, 0);
+            pthread_cond_signal(&p->cond_wakeup_main);
+            continue;
+        }
+
+        if (p->eof || ahead >= p->capacity) {
+            pthread_cond_wait(&p->cond_wakeup_background, &p->mutex);
+            continue;
+        }
+
+        to_read = FFMIN(p->capacity - ahead, MAX_READ_SIZE);
+        pthread_mutex_unlock(&p->mutex);
+        ret = ffurl_read(p->h, p->read_buf, to_read);
+        pthread_mutex_lock(&p->mutex);
+
+        /* the window can only have grown meanwhile, and the data is kept
+         * even if a seek was requested, in case it fails */
+        if (ret > 0) {
+            av_assert2(ret <= av_fifo_space(p->fifo));
+            av_fifo_generic_write(p->fifo, p->read_buf, ret, NULL);
+        } else if (p->seek_request || p->abort_request) {
+            /* interrupted, not the end of the file */
+        } else {
+            p->eof = 1;
+            if (ret < 0 && ret != AVERROR_EOF)
+                p->io_error = ret;
+        }
+        pthread_cond_signal(&p->cond_wakeup_main);
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return NULL;
+}
+
+int ff_prefetch_open(FFPrefetch **pp, URLContext *h)
+{
+    FFPrefetch *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+
+    p->h        = h;
+    p->capacity = MIN_CAPACITY;
+    p->interrupt_callback = h->interrupt_callback;
+    atomic_init(&p->interrupt, 0);
+    p->fifo     = av_fifo_alloc(MIN_CAPACITY + READ_BACK_CAPACITY);
+    p->read_buf = av_malloc(MAX_READ_SIZE);
+    if (!p->fifo || !p->read_buf) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    if ((ret = pthread_mutex_init(&p->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&p->cond_wakeup_main, NULL))) {
+        ret = AVERROR(ret);
+        goto cond_wakeup_main_fail;
+    }
+    if ((ret = pthread_cond_init(&p->cond_wakeup_background, NULL))) {
+        ret = AVERROR(ret);
+        goto cond_wakeup_background_fail;
+    }
+    /* like the async protocol, make the blocking calls of the thread return
+     * when the reader seeks or stops */
+    h->interrupt_callback.callback = prefetch_check_interrupt;
+    h->interrupt_callback.opaque   = p;
+    if ((ret = pthread_create(&p->thread, NULL, prefetch_task, p))) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        h->interrupt_callback = p->interrupt_callback;
+        ret = AVERROR(ret);
+        goto thread_fail;
+    }
+
+    *pp = p;
+    return 0;
+
+thread_fail:
+    pthread_cond_destroy(&p->cond_wakeup_background);
+cond_wakeup_background_fail:
+    pthread_cond_destroy(&p->cond_wakeup_main);
+cond_wakeup_main_fail:
+    pthread_mutex_destroy(&p->mutex);
+fail:
+    av_fifo_freep(&p->fifo);
+    av_freep(&p->read_buf);
+    av_freep(&p);
+    return ret;
+}
+
+void ff_prefetch_close(FFPrefetch **pp)
+{
+    FFPrefetch *p = *pp;
+    int ret;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    p->abort_request = 1;
+    atomic_store(&p->interrupt, 1);
+    pthread_cond_signal(&p->cond_wakeup_background);
+    pthread_mutex_unlock(&p->mutex);
+
+    ret = pthread_join(p->thread, NULL);
+    if (ret)
+        av_log(p->h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+    p->h->interrupt_callback = p->interrupt_callback;
+
+    pthread_cond_destroy(&p->cond_wakeup_background);
+    pthread_cond_destroy(&p->cond_wakeup_main);
+    pthread_mutex_destroy(&p->mutex);
+    av_fifo_freep(&p->fifo);
+    av_freep(&p->read_buf);
+    av_freep(pp);
+}
+
+/* move the reader forward by size bytes, which are in the fifo */
+static void prefetch_advance(FFPrefetch *p, int size)
+{
+    p->read_pos   += size;
+    p->pos        += size;
+    p->sequential += size;
+
+    if (p->read_pos > READ_BACK_CAPACITY) {
+        av_fifo_drain(p->fifo, p->read_pos - READ_BACK_CAPACITY);
+        p->read_pos = READ_BACK_CAPACITY;
+    }
+
+    if (p->sequential >= p->capacity && p->capacity < MAX_CAPACITY &&
+        av_fifo_realloc2(p->fifo, 2 * p->capacity + READ_BACK_CAPACITY) >= 0) {
+        p->capacity *= 2;
+        av_log(p->h, AV_LOG_DEBUG, "Reading %d KiB ahead\n", p->capacity >> 10);
+    }
+}
+
+int ff_prefetch_read(FFPrefetch *p, uint8_t *buf, int size)
+{
+    int ret;
+
+    pthread_mutex_lock(&p->mutex);
+    while (1) {
+        int ahead = av_fifo_size(p->fifo) - p->read_pos;
+
+        if (ahead > 0) {
+            ret = FFMIN(size, ahead);
+            av_fifo_generic_peek_at(p->fifo, buf, p->read_pos, ret, NULL);
+            prefetch_advance(p, ret);
+            break;
+        } else if (p->eof) {
+            ret = p->io_error ? p->io_error : AVERROR_EOF;
+            break;
+        } else if (ff_check_interrupt(&p->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_signal(&p->cond_wakeup_background);
+        pthread_cond_wait(&p->cond_wakeup_main, &p->mutex);
+    }
+    pthread_cond_signal(&p->cond_wakeup_background);
+    pthread_mutex_unlock(&p->mutex);
+
+    return ret;
+}
+
+int64_t ff_prefetch_seek(FFPrefetch *p, int64_t pos, int whence)
+{
+    int64_t ret;
+
+    if (whence == SEEK_CUR)
+        pos += p->pos;
+    else if (whence != SEEK_SET && whence != AVSEEK_SIZE)
+        return AVERROR(EINVAL);
+    if (pos < 0 && whence != AVSEEK_SIZE)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&p->mutex);
+
+    /* within the data read back, or read ahead or about to be */
+    if (whence != AVSEEK_SIZE &&
+        pos >= p->pos - p->read_pos && pos <= p->pos + p->capacity) {
+        while (1) {
+            int ahead = av_fifo_size(p->fifo) - p->read_pos;
+
+            if (pos <= p->pos + ahead) {
+                if (pos >= p->pos) {
+                    prefetch_advance(p, pos - p->pos);
+                } else {
+                    p->read_pos -= p->pos - pos;
+                    p->pos       = pos;
+                }
+                pthread_cond_signal(&p->cond_wakeup_background);
+                pthread_mutex_unlock(&p->mutex);
+                return pos;
+            }
+            if (p->eof || ff_check_interrupt(&p->interrupt_callback))
+                break;
+            prefetch_advance(p, ahead);
+            pthread_cond_signal(&p->cond_wakeup_background);
+            pthread_cond_wait(&p->cond_wakeup_main, &p->mutex);
+        }
+    }
+
+    if (whence != AVSEEK_SIZE) {
+        p->sequential = 0;
+        p->capacity   = FFMAX(p->capacity / 2, MIN_CAPACITY);
+    }
+    p->seek_request   = 1;
+    p->seek_pos       = pos;
+    p->seek_whence    = whence == AVSEEK_SIZE ? AVSEEK_SIZE : SEEK_SET;
+    p->seek_completed = 0;
+    atomic_store(&p->interrupt, 1);
+    pthread_cond_signal(&p->cond_wakeup_background);
+    while (!p->seek_completed)
+        pthread_cond_wait(&p->cond_wakeup_main, &p->mutex);
+
+    ret = p->seek_ret;
+    if (ret >= 0 && whence != AVSEEK_SIZE)
+        p->pos = ret;
+    pthread_mutex_unlock(&p->mutex);
+
+    return ret;
+}
+
+#else /* HAVE_THREADS */
+
+int ff_prefetch_open(FFPrefetch **p, URLContext *h)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_prefetch_close(FFPrefetch **p)
+{
+}
+
+int ff_prefetch_read(FFPrefetch *p, uint8_t *buf, int size)
+{
+    return AVERROR(ENOSYS);
+}
+
+int64_t ff_prefetch_seek(FFPrefetch *p, int64_t pos, int whence)
+{
+    return AVERROR(ENOSYS);
+}
+
+#endif /* HAVE_THREADS */
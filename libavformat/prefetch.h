@@ -0,0 +1,65 @@
+/*
+ * Background readahead for AVIOContext
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_PREFETCH_H
+#define AVFORMAT_PREFETCH_H
+
+#include <stdint.h>
+
+#include "url.h"
+
+/**
+ * Reader of a URLContext which reads ahead of the caller in a background
+ * thread, as the async protocol does.
+ *
+ * The window read ahead starts small, and doubles each time a whole
+ * window has been read sequentially, so that long sequential reads get
+ * a large window while seek heavy access patterns do not waste bandwidth.
+ * Each seek outside of the buffered data halves it again.
+ *
+ * Once opened, the URLContext must only be accessed through the reader
+ * until it is closed.
+ */
+typedef struct FFPrefetch FFPrefetch;
+
+/**
+ * Start reading ahead of h.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if threads are not available,
+ *         or another negative AVERROR code
+ */
+int ff_prefetch_open(FFPrefetch **p, URLContext *h);
+
+/**
+ * Stop reading ahead, the URLContext is not closed.
+ */
+void ff_prefetch_close(FFPrefetch **p);
+
+/**
+ * Read up to size bytes, like ffurl_read().
+ */
+int ff_prefetch_read(FFPrefetch *p, uint8_t *buf, int size);
+
+/**
+ * Seek, like ffurl_seek().
+ */
+int64_t ff_prefetch_seek(FFPrefetch *p, int64_t pos, int whence);
+
+#endif /* AVFORMAT_PREFETCH_H */
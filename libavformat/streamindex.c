@@ -0,0 +1,532 @@
+/*
+ * Compact stream index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "streamindex.h"
+
+#define CHUNK_ENTRIES 256
+
+/* header byte and up to 4 values of up to 10 bytes each */
+#define MAX_ENTRY_SIZE 41
+
+/* The 2 low bits of the header of an entry are its flags, the other ones
+ * tell which differences to the prediction from the previous entry follow. */
+#define HAS_POS      0x04
+#define HAS_DURATION 0x08
+#define HAS_SIZE     0x10
+#define HAS_DISTANCE 0x20
+
+typedef struct IndexChunk {
+    int first;                  ///< number of the first entry of the chunk
+    int nb_entries;
+    AVIndexEntry last;          ///< last entry, the reference of the next one
+    int64_t last_duration;      ///< timestamp difference of the last 2 entries
+    uint8_t *data;
+    unsigned data_size;
+    unsigned data_allocated;
+} IndexChunk;
+
+struct FFStreamIndex {
+    IndexChunk *chunks;
+    unsigned chunks_allocated;
+    int nb_chunks;
+    int nb_entries;
+
+    int cached;                 ///< chunk decoded in entries, -1 if none
+    /* room for the largest chunk, plus one entry for an insertion before
+     * the chunk is split */
+    AVIndexEntry *entries;
+    unsigned entries_allocated;
+};
+
+/**
+ * Make room in entries for a chunk of nb_entries entries and an insertion.
+ */
+static int reserve_entries(FFStreamIndex *idx, int nb_entries)
+{
+    AVIndexEntry *entries = av_fast_realloc(idx->entries, &idx->entries_allocated,
+                                            (nb_entries + 1) * sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    idx->entries = entries;
+    return 0;
+}
+
+static uint8_t *put_value(uint8_t *p, int64_t v)
+{
+    uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+
+    while (u > 0x7F) {
+        *p++ = u | 0x80;
+        u  >>= 7;
+    }
+    *p++ = u;
+    return p;
+}
+
+static const uint8_t *get_value(const uint8_t *p, int64_t *v)
+{
+    uint64_t u = 0;
+    int shift = 0;
+
+    do {
+        u |= (uint64_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    return p;
+}
+
+/**
+ * Code an entry: the position is predicted to follow the previous entry,
+ * and the duration, size and distance to be the same as before.
+ */
+static uint8_t *put_entry(uint8_t *p, const AVIndexEntry *e,
+                          const AVIndexEntry *prev, int64_t prev_duration)
+{
+    const int64_t dpos      = (uint64_t)e->pos - prev->pos - prev->size;
+    const int64_t dduration = (uint64_t)e->timestamp - prev->timestamp - prev_duration;
+    const int64_t dsize     = (int64_t)e->size - prev->size;
+    const int64_t ddistance = (int64_t)e->min_distance - prev->min_distance;
+
+    *p++ = (e->flags & 3)                   |
+           (dpos      ? HAS_POS      : 0) |
+           (dduration ? HAS_DURATION : 0) |
+           (dsize     ? HAS_SIZE     : 0) |
+           (ddistance ? HAS_DISTANCE : 0);
+    if (dpos)
+        p = put_value(p, dpos);
+    if (dduration)
+        p = put_value(p, dduration);
+    if (dsize)
+        p = put_value(p, dsize);
+    if (ddistance)
+        p = put_value(p, ddistance);
+    return p;
+}
+
+static void decode_chunk(FFStreamIndex *idx, int ci)
+{
+    const IndexChunk *c = &idx->chunks[ci];
+    const uint8_t *p = c->data;
+    AVIndexEntry prev = { 0 };
+    int64_t duration = 0, v;
+    int i;
+
+    for (i = 0; i < c->nb_entries; i++) {
+        AVIndexEntry *e = &idx->entries[i];
+        const int header = *p++;
+
+        e->pos = (uint64_t)prev.pos + prev.size;
+        if (header & HAS_POS) {
+            p = get_value(p, &v);
+            e->pos = (uint64_t)e->pos + v;
+        }
+        if (header & HAS_DURATION) {
+            p = get_value(p, &v);
+            duration = (uint64_t)duration + v;
+        }
+        e->timestamp = (uint64_t)prev.timestamp + duration;
+        e->size = prev.size;
+        if (header & HAS_SIZE) {
+            p = get_value(p, &v);
+            e->size += v;
+        }
+        e->min_distance = prev.min_distance;
+        if (header & HAS_DISTANCE) {
+            p = get_value(p, &v);
+            e->min_distance += v;
+        }
+        e->flags = header & 3;
+        prev = *e;
+    }
+    idx->cached = ci;
+}
+
+/**
+ * Replace the entries of a chunk. The chunk is left untouched on error.
+ */
+static int encode_chunk(FFStreamIndex *idx, IndexChunk *c,
+                        const AVIndexEntry *entries, int nb_entries)
+{
+    AVIndexEntry prev = { 0 };
+    int64_t duration = 0;
+    uint8_t *p, *data;
+    unsigned size;
+    int i;
+
+    data = av_malloc(nb_entries * MAX_ENTRY_SIZE);
+    if (!data)
+        return AVERROR(ENOMEM);
+
+    for (i = 0, p = data; i < nb_entries; i++) {
+        p = put_entry(p, &entries[i], &prev, duration);
+        duration = (uint64_t)entries[i].timestamp - prev.timestamp;
+        prev     = entries[i];
+    }
+
+    size = p - data;
+    p    = av_realloc(data, size);
+    if (p)
+        data = p;
+
+    av_free(c->data);
+    c->data           = data;
+    c->data_size      = size;
+    c->data_allocated = size;
+    c->nb_entries     = nb_entries;
+    c->last           = prev;
+    c->last_duration  = duration;
+    return 0;
+}
+
+static IndexChunk *insert_chunk(FFStreamIndex *idx, int ci)
+{
+    IndexChunk *chunks;
+
+    if (idx->nb_chunks >= INT_MAX / sizeof(*chunks) - 1)
+        return NULL;
+    chunks = av_fast_realloc(idx->chunks, &idx->chunks_allocated,
+                             (idx->nb_chunks + 1) * sizeof(*chunks));
+    if (!chunks)
+        return NULL;
+    idx->chunks = chunks;
+
+    memmove(chunks + ci + 1, chunks + ci, (idx->nb_chunks - ci) * sizeof(*chunks));
+    memset(&chunks[ci], 0, sizeof(*chunks));
+    idx->nb_chunks++;
+    if (idx->cached >= ci)
+        idx->cached++;
+    return &chunks[ci];
+}
+
+static void remove_chunk(FFStreamIndex *idx, int ci)
+{
+    av_freep(&idx->chunks[ci].data);
+    idx->nb_chunks--;
+    memmove(idx->chunks + ci, idx->chunks + ci + 1,
+            (idx->nb_chunks - ci) * sizeof(*idx->chunks));
+    if (idx->cached == ci)
+        idx->cached = -1;
+    else if (idx->cached > ci)
+        idx->cached--;
+}
+
+static int find_chunk(const FFStreamIndex *idx, int n)
+{
+    int lo = 0, hi = idx->nb_chunks - 1;
+
+    while (lo < hi) {
+        const int mid = (lo + hi + 1) >> 1;
+        if (idx->chunks[mid].first <= n)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/**
+ * Decode the chunk holding the entry n, if it is not the cached one.
+ *
+ * @return the index of the chunk
+ */
+static int load_chunk(FFStreamIndex *idx, int n)
+{
+    int ci = idx->cached;
+
+    if (ci < 0 || n <  idx->chunks[ci].first ||
+                  n >= idx->chunks[ci].first + idx->chunks[ci].nb_entries) {
+        ci = find_chunk(idx, n);
+        decode_chunk(idx, ci);
+    }
+    return ci;
+}
+
+static int append_entry(FFStreamIndex *idx, const AVIndexEntry *e)
+{
+    IndexChunk *c = idx->nb_chunks ? &idx->chunks[idx->nb_chunks - 1] : NULL;
+    uint8_t *data;
+
+    if (!c || c->nb_entries >= CHUNK_ENTRIES) {
+        c = insert_chunk(idx, idx->nb_chunks);
+        if (!c)
+            return AVERROR(ENOMEM);
+        c->first = idx->nb_entries;
+    }
+
+    if (reserve_entries(idx, c->nb_entries + 1) < 0)
+        data = NULL;
+    else
+        data = av_fast_realloc(c->data, &c->data_allocated, c->data_size + MAX_ENTRY_SIZE);
+    if (!data) {
+        if (!c->nb_entries)
+            remove_chunk(idx, idx->nb_chunks - 1);
+        return AVERROR(ENOMEM);
+    }
+    c->data = data;
+
+    c->data_size = put_entry(c->data + c->data_size, e, &c->last, c->last_duration) - c->data;
+    c->last_duration = (uint64_t)e->timestamp - c->last.timestamp;
+    c->last = *e;
+    if (idx->cached == idx->nb_chunks - 1)
+        idx->entries[c->nb_entries] = *e;
+    c->nb_entries++;
+
+    // full chunks do not grow anymore
+    if (c->nb_entries == CHUNK_ENTRIES && c->data_allocated > c->data_size) {
+        data = av_realloc(c->data, c->data_size);
+        if (data) {
+            c->data           = data;
+            c->data_allocated = c->data_size;
+        }
+    }
+
+    return idx->nb_entries++;
+}
+
+int ff_stream_index_append(FFStreamIndex *idx, const AVIndexEntry *e)
+{
+    if (idx->nb_entries >= INT_MAX - 1)
+        return AVERROR(ERANGE);
+    return append_entry(idx, e);
+}
+
+FFStreamIndex *ff_stream_index_alloc(void)
+{
+    FFStreamIndex *idx = av_mallocz(sizeof(*idx));
+
+    if (idx)
+        idx->cached = -1;
+    return idx;
+}
+
+void ff_stream_index_free(FFStreamIndex **pidx)
+{
+    FFStreamIndex *idx = *pidx;
+    int i;
+
+    if (!idx)
+        return;
+    for (i = 0; i < idx->nb_chunks; i++)
+        av_freep(&idx->chunks[i].data);
+    av_freep(&idx->chunks);
+    av_freep(&idx->entries);
+    av_freep(pidx);
+}
+
+int ff_stream_index_count(const FFStreamIndex *idx)
+{
+    return idx->nb_entries;
+}
+
+size_t ff_stream_index_size(const FFStreamIndex *idx)
+{
+    size_t size = sizeof(*idx) + idx->chunks_allocated + idx->entries_allocated;
+    int i;
+
+    for (i = 0; i < idx->nb_chunks; i++)
+        size += idx->chunks[i].data_allocated;
+    return size;
+}
+
+const AVIndexEntry *ff_stream_index_get(FFStreamIndex *idx, int n)
+{
+    if (n < 0 || n >= idx->nb_entries)
+        return NULL;
+    if (n == idx->nb_entries - 1)
+        return &idx->chunks[idx->nb_chunks - 1].last;
+    return &idx->entries[n - idx->chunks[load_chunk(idx, n)].first];
+}
+
+#define ENTRY(n) ff_stream_index_get(idx, n)
+
+int ff_stream_index_search(FFStreamIndex *idx, int64_t wanted_timestamp,
+                           int flags)
+{
+    const int nb_entries = idx->nb_entries;
+    int a, b, m;
+    int64_t timestamp;
+
+    a = -1;
+    b = nb_entries;
+
+    // Optimize appending index entries at the end.
+    if (b && ENTRY(b - 1)->timestamp < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        m         = (a + b) >> 1;
+
+        // Search for the next non-discarded packet.
+        while ((ENTRY(m)->flags & AVINDEX_DISCARD_FRAME) && m < b && m < nb_entries - 1) {
+            m++;
+            if (m == b && ENTRY(m)->timestamp >= wanted_timestamp) {
+                m = b - 1;
+                break;
+            }
+        }
+
+        timestamp = ENTRY(m)->timestamp;
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < nb_entries &&
+               !(ENTRY(m)->flags & AVINDEX_KEYFRAME))
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
+int ff_stream_index_add(FFStreamIndex *idx, int64_t pos, int64_t timestamp,
+                        int size, int distance, int flags)
+{
+    IndexChunk *c, *c2;
+    AVIndexEntry *ie;
+    int n, ci, i, k, nb, inserted = 0, ret;
+
+    if (idx->nb_entries >= INT_MAX - 1)
+        return -1;
+
+    if (timestamp == AV_NOPTS_VALUE)
+        return AVERROR(EINVAL);
+
+    if (size < 0 || size > 0x3FFFFFFF)
+        return AVERROR(EINVAL);
+
+    n = ff_stream_index_search(idx, timestamp, AVSEEK_FLAG_ANY);
+
+    if (n < 0) {
+        AVIndexEntry e = { 0 };
+
+        e.pos          = pos;
+        e.timestamp    = timestamp;
+        e.min_distance = distance;
+        e.size         = size;
+        e.flags        = flags;
+        return append_entry(idx, &e);
+    }
+
+    ci = load_chunk(idx, n);
+    c  = &idx->chunks[ci];
+    nb = c->nb_entries;
+    k  = n - c->first;
+    ie = &idx->entries[k];
+    if (ie->timestamp != timestamp) {
+        if (ie->timestamp <= timestamp)
+            return -1;
+        if ((ret = reserve_entries(idx, nb + 1)) < 0)
+            return ret;
+        ie = &idx->entries[k];
+        memmove(ie + 1, ie, sizeof(*ie) * (nb - k));
+        nb++;
+        inserted = 1;
+    } else if (ie->pos == pos && distance < ie->min_distance)
+        // do not reduce the distance
+        distance = ie->min_distance;
+
+    ie->pos          = pos;
+    ie->timestamp    = timestamp;
+    ie->min_distance = distance;
+    ie->size         = size;
+    ie->flags        = flags;
+
+    if (nb <= CHUNK_ENTRIES) {
+        ret = encode_chunk(idx, c, idx->entries, nb);
+        if (ret < 0)
+            goto fail;
+    } else {
+        // split the chunk in 2 halves
+        const int half = nb / 2;
+
+        c2 = insert_chunk(idx, ci + 1);
+        if (!c2) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        c = &idx->chunks[ci];
+        if ((ret = encode_chunk(idx, c2, idx->entries + half, nb - half)) < 0 ||
+            (ret = encode_chunk(idx, c,  idx->entries,        half))      < 0) {
+            remove_chunk(idx, ci + 1);
+            goto fail;
+        }
+        c2->first   = c->first + half;
+        idx->cached = -1;
+        ci++;
+    }
+
+    if (inserted) {
+        for (i = ci + 1; i < idx->nb_chunks; i++)
+            idx->chunks[i].first++;
+        idx->nb_entries++;
+    }
+    return n;
+
+fail:
+    idx->cached = -1;
+    return ret;
+}
+
+int ff_stream_index_reduce(FFStreamIndex *idx, int max_entries)
+{
+    FFStreamIndex *tmp;
+    int i, ret;
+
+    if ((unsigned)idx->nb_entries < max_entries)
+        return 0;
+
+    tmp = ff_stream_index_alloc();
+    if (!tmp)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < idx->nb_entries; i += 2) {
+        ret = append_entry(tmp, ff_stream_index_get(idx, i));
+        if (ret < 0) {
+            ff_stream_index_free(&tmp);
+            return ret;
+        }
+    }
+
+    for (i = 0; i < idx->nb_chunks; i++)
+        av_freep(&idx->chunks[i].data);
+    av_freep(&idx->chunks);
+    av_freep(&idx->entries);
+    idx->chunks            = tmp->chunks;
+    idx->chunks_allocated  = tmp->chunks_allocated;
+    idx->nb_chunks         = tmp->nb_chunks;
+    idx->nb_entries        = tmp->nb_entries;
+    idx->entries           = tmp->entries;
+    idx->entries_allocated = tmp->entries_allocated;
+    idx->cached            = -1;
+    tmp->chunks    = NULL;
+    tmp->nb_chunks = 0;
+    tmp->entries   = NULL;
+    ff_stream_index_free(&tmp);
+    return 0;
+}
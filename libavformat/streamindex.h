@@ -0,0 +1,96 @@
+/*
+ * Compact stream index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_STREAMINDEX_H
+#define AVFORMAT_STREAMINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avformat.h"
+
+/**
+ * Index of a stream, holding the same entries as a sorted AVIndexEntry
+ * array in a fraction of its size.
+ *
+ * The entries are stored in chunks of up to 256 entries, each entry being
+ * delta coded against the previous one: an entry which follows its
+ * predecessor in the file with the same size, duration and distance
+ * takes a single byte. Appending an entry is O(1), looking up an entry by
+ * number or timestamp is O(log n), and inserting one in the middle only
+ * recodes its chunk.
+ */
+typedef struct FFStreamIndex FFStreamIndex;
+
+FFStreamIndex *ff_stream_index_alloc(void);
+
+void ff_stream_index_free(FFStreamIndex **idx);
+
+/**
+ * @return the number of entries of the index
+ */
+int ff_stream_index_count(const FFStreamIndex *idx);
+
+/**
+ * @return the number of bytes used by the index
+ */
+size_t ff_stream_index_size(const FFStreamIndex *idx);
+
+/**
+ * Add an entry to the index, in the same way as ff_add_index_entry().
+ *
+ * @return the number of the entry, or < 0 on error
+ */
+int ff_stream_index_add(FFStreamIndex *idx, int64_t pos, int64_t timestamp,
+                        int size, int distance, int flags);
+
+/**
+ * Add an entry at the end of the index, whatever its timestamp, unlike
+ * ff_stream_index_add(). To be used to keep an index which is not sorted
+ * by timestamp, accessed by entry number only.
+ *
+ * @return the number of the entry, or < 0 on error
+ */
+int ff_stream_index_append(FFStreamIndex *idx, const AVIndexEntry *e);
+
+/**
+ * Get an entry of the index.
+ *
+ * @return the entry n, or NULL if it does not exist; the entry is only
+ *         valid until the next call to any function on idx
+ */
+const AVIndexEntry *ff_stream_index_get(FFStreamIndex *idx, int n);
+
+/**
+ * Search the index for a timestamp, in the same way as
+ * ff_index_search_timestamp().
+ *
+ * @return the number of the entry found, or -1
+ */
+int ff_stream_index_search(FFStreamIndex *idx, int64_t wanted_timestamp,
+                           int flags);
+
+/**
+ * Drop every second entry of the index if it has max_entries entries or
+ * more, like ff_reduce_index().
+ */
+int ff_stream_index_reduce(FFStreamIndex *idx, int max_entries);
+
+#endif /* AVFORMAT_STREAMINDEX_H */
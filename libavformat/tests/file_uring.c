@@ -0,0 +1,219 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/avio.h"
+
+#define FILE_SIZE (6 * 1024 * 1024 + 1234)
+#define MAX_READ  (300 * 1000)
+
+static int uring_unused;
+
+static void log_callback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    if (!strncmp(fmt, "Not using io_uring", 18))
+        uring_unused = 1;
+    av_log_default_callback(avcl, level, fmt, vl);
+}
+
+static int open_uring(AVIOContext **pb, const char *url, int flags)
+{
+    AVDictionary *opts = NULL;
+    int ret;
+
+    av_dict_set(&opts, "io_uring", "1", 0);
+    if (flags & AVIO_FLAG_WRITE)
+        av_dict_set(&opts, "direct", "1", 0);
+    ret = avio_open2(pb, url, flags, NULL, &opts);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* write data in random chunks, going back now and then to overwrite what
+ * was written, first with garbage, then with data again */
+static int test_write(const char *url, const uint8_t *data, AVLFG *lfg)
+{
+    AVIOContext *pb, *ref;
+    uint8_t *buf = av_malloc(FILE_SIZE);
+    int64_t pos = 0;
+    int ret = 1;
+
+    if (!buf || open_uring(&pb, url, AVIO_FLAG_WRITE) < 0)
+        goto end;
+
+    while (pos < FILE_SIZE) {
+        int size = FFMIN(av_lfg_get(lfg) % 200000 + 1, FILE_SIZE - pos);
+
+        avio_write(pb, data + pos, size);
+        pos += size;
+        if (!(av_lfg_get(lfg) % 8)) {
+            int64_t back = av_lfg_get(lfg) % pos;
+            size = FFMIN(av_lfg_get(lfg) % 600000 + 1, pos - back);
+            memset(buf, 0x55, size);
+            avio_seek(pb, back, SEEK_SET);
+            avio_write(pb, buf, size);
+            avio_seek(pb, back, SEEK_SET);
+            avio_write(pb, data + back, size);
+            avio_seek(pb, pos, SEEK_SET);
+        }
+    }
+    /* the data must be visible to other readers once flushed */
+    avio_flush(pb);
+    if (avio_open(&ref, url, AVIO_FLAG_READ) < 0) {
+        avio_closep(&pb);
+        goto end;
+    }
+    if (avio_size(ref) != FILE_SIZE) {
+        printf("size %"PRId64" instead of %d after flushing\n", avio_size(ref), FILE_SIZE);
+        avio_closep(&ref);
+        avio_closep(&pb);
+        goto end;
+    }
+    avio_closep(&ref);
+    if (avio_closep(&pb) < 0 || avio_open(&ref, url, AVIO_FLAG_READ) < 0)
+        goto end;
+
+    ret = avio_read(ref, buf, FILE_SIZE) != FILE_SIZE || avio_r8(ref) ||
+          !avio_feof(ref) || memcmp(buf, data, FILE_SIZE);
+    avio_closep(&ref);
+    if (ret)
+        printf("the file written differs\n");
+    else
+        printf("write: %d bytes\n", FILE_SIZE);
+end:
+    av_free(buf);
+    return ret;
+}
+
+/* read from both contexts, and check that they return the same */
+static int compare_read(AVIOContext *ref, AVIOContext *pb, uint8_t *buf_ref,
+                        uint8_t *buf, int size)
+{
+    int ret_ref = avio_read(ref, buf_ref, size);
+    int ret     = avio_read(pb,  buf,     size);
+
+    if (ret != ret_ref || (ret > 0 && memcmp(buf, buf_ref, ret)) ||
+        avio_tell(pb) != avio_tell(ref) || avio_feof(pb) != avio_feof(ref)) {
+        printf("reading %d bytes at %"PRId64" returned %d instead of %d\n",
+               size, avio_tell(ref), ret, ret_ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int compare_seek(AVIOContext *ref, AVIOContext *pb,
+                        int64_t offset, int whence)
+{
+    int64_t ret_ref = avio_seek(ref, offset, whence);
+    int64_t ret     = avio_seek(pb,  offset, whence);
+
+    if (ret != ret_ref) {
+        printf("seeking to %"PRId64" (%d) returned %"PRId64" instead of %"PRId64"\n",
+               offset, whence, ret, ret_ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_read(const char *url, AVLFG *lfg)
+{
+    AVIOContext *ref = NULL, *pb = NULL;
+    uint8_t *buf_ref = av_malloc(MAX_READ), *buf = av_malloc(MAX_READ);
+    int i, ret = 1;
+
+    if (!buf_ref || !buf ||
+        avio_open(&ref, url, AVIO_FLAG_READ) < 0 ||
+        open_uring(&pb, url, AVIO_FLAG_READ) < 0)
+        goto end;
+
+    while (!avio_feof(ref)) {
+        if (compare_read(ref, pb, buf_ref, buf, av_lfg_get(lfg) % 70000 + 1))
+            goto end;
+    }
+    printf("sequential: %"PRId64" bytes\n", avio_tell(ref));
+
+    for (i = 0; i < 2000; i++) {
+        int64_t pos = avio_tell(ref);
+        int64_t offset;
+
+        switch (av_lfg_get(lfg) % 5) {
+        case 0: offset = av_lfg_get(lfg) % (FILE_SIZE + 1000);        break;
+        case 1: offset = pos + av_lfg_get(lfg) % 1000000;              break;
+        case 2: offset = pos - av_lfg_get(lfg) % 1000000;              break;
+        case 3: offset = FILE_SIZE - av_lfg_get(lfg) % 1000000;        break;
+        default: offset = pos;                                         break;
+        }
+        if (av_lfg_get(lfg) & 1) {
+            if (compare_seek(ref, pb, offset - pos, SEEK_CUR))
+                goto end;
+        } else if (compare_seek(ref, pb, offset, SEEK_SET)) {
+            goto end;
+        }
+        if (compare_read(ref, pb, buf_ref, buf, av_lfg_get(lfg) % MAX_READ + 1))
+            goto end;
+    }
+    printf("random: %d seeks\n", i);
+
+    ret = 0;
+end:
+    avio_closep(&ref);
+    avio_closep(&pb);
+    av_free(buf_ref);
+    av_free(buf);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *data;
+    AVLFG lfg;
+    int i, ret = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <temporary file>\n", argv[0]);
+        return 1;
+    }
+
+    av_log_set_callback(log_callback);
+
+    data = av_malloc(FILE_SIZE);
+    if (!data)
+        return 1;
+    av_lfg_init(&lfg, 1);
+    for (i = 0; i < FILE_SIZE; i++)
+        data[i] = av_lfg_get(&lfg);
+
+    if (!test_write(argv[1], data, &lfg) && !test_read(argv[1], &lfg))
+        ret = 0;
+    /* the test is only meaningful if the ring could be set up */
+    if (HAVE_IO_URING && uring_unused) {
+        printf("io_uring was not used\n");
+        ret = 1;
+    }
+    avpriv_io_delete(argv[1]);
+    av_free(data);
+    return ret;
+}
@@ -0,0 +1,145 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/avio.h"
+
+#define FILE_SIZE (6 * 1024 * 1024 + 1234)
+#define MAX_READ  (300 * 1000)
+
+static int write_file(const char *url, AVLFG *lfg)
+{
+    AVIOContext *pb;
+    int i, ret;
+
+    if ((ret = avio_open(&pb, url, AVIO_FLAG_WRITE)) < 0)
+        return ret;
+    for (i = 0; i < FILE_SIZE; i++)
+        avio_w8(pb, av_lfg_get(lfg));
+    return avio_closep(&pb);
+}
+
+/* read from both contexts, and check that they return the same */
+static int compare_read(AVIOContext *ref, AVIOContext *pb, uint8_t *buf_ref,
+                        uint8_t *buf, int size)
+{
+    int ret_ref = avio_read(ref, buf_ref, size);
+    int ret     = avio_read(pb,  buf,     size);
+
+    if (ret != ret_ref || (ret > 0 && memcmp(buf, buf_ref, ret)) ||
+        avio_tell(pb) != avio_tell(ref) || avio_feof(pb) != avio_feof(ref)) {
+        printf("reading %d bytes at %"PRId64" returned %d instead of %d\n",
+               size, avio_tell(ref), ret, ret_ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int compare_seek(AVIOContext *ref, AVIOContext *pb,
+                        int64_t offset, int whence)
+{
+    int64_t ret_ref = avio_seek(ref, offset, whence);
+    int64_t ret     = avio_seek(pb,  offset, whence);
+
+    if (ret != ret_ref) {
+        printf("seeking to %"PRId64" (%d) returned %"PRId64" instead of %"PRId64"\n",
+               offset, whence, ret, ret_ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int test(const char *url, AVLFG *lfg)
+{
+    AVIOContext *ref = NULL, *pb = NULL;
+    uint8_t *buf_ref = av_malloc(MAX_READ), *buf = av_malloc(MAX_READ);
+    int i, ret = 1;
+
+    if (!buf_ref || !buf ||
+        avio_open(&ref, url, AVIO_FLAG_READ) < 0 ||
+        avio_open(&pb,  url, AVIO_FLAG_READ | AVIO_FLAG_PREFETCH) < 0)
+        goto end;
+
+    if (avio_size(pb) != avio_size(ref)) {
+        printf("size %"PRId64" instead of %"PRId64"\n", avio_size(pb), avio_size(ref));
+        goto end;
+    }
+
+    /* sequential reads, growing the window */
+    while (!avio_feof(ref)) {
+        if (compare_read(ref, pb, buf_ref, buf, av_lfg_get(lfg) % 70000 + 1))
+            goto end;
+    }
+    printf("sequential: %"PRId64" bytes\n", avio_tell(ref));
+
+    /* short and long seeks in both directions, and reads around them */
+    for (i = 0; i < 2000; i++) {
+        int64_t pos = avio_tell(ref);
+        int64_t offset;
+
+        switch (av_lfg_get(lfg) % 6) {
+        case 0: offset = av_lfg_get(lfg) % (FILE_SIZE + 1000);        break;
+        case 1: offset = pos + av_lfg_get(lfg) % 100000;               break;
+        case 2: offset = pos - av_lfg_get(lfg) % 100000;               break;
+        case 3: offset = pos + av_lfg_get(lfg) % 2000000;              break;
+        case 4: offset = pos - av_lfg_get(lfg) % 2000000;              break;
+        default: offset = pos;                                         break;
+        }
+        if (av_lfg_get(lfg) & 1) {
+            if (compare_seek(ref, pb, offset - pos, SEEK_CUR))
+                goto end;
+        } else if (compare_seek(ref, pb, offset, SEEK_SET)) {
+            goto end;
+        }
+        if (compare_read(ref, pb, buf_ref, buf, av_lfg_get(lfg) % MAX_READ + 1))
+            goto end;
+    }
+    printf("random: %d seeks\n", i);
+
+    ret = 0;
+end:
+    avio_closep(&ref);
+    avio_closep(&pb);
+    av_free(buf_ref);
+    av_free(buf);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVLFG lfg;
+    int ret;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <temporary file>\n", argv[0]);
+        return 1;
+    }
+
+    av_lfg_init(&lfg, 1);
+    if (write_file(argv[1], &lfg) < 0) {
+        fprintf(stderr, "could not write %s\n", argv[1]);
+        return 1;
+    }
+    ret = test(argv[1], &lfg);
+    avpriv_io_delete(argv[1]);
+    return ret;
+}
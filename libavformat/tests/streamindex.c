@@ -0,0 +1,207 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/internal.h"
+#include "libavformat/streamindex.h"
+
+typedef struct TestIndex {
+    AVIndexEntry *entries;
+    int nb_entries;
+    unsigned int allocated_size;
+    FFStreamIndex *idx;
+} TestIndex;
+
+static int compare(TestIndex *t, const char *name)
+{
+    int i;
+
+    if (ff_stream_index_count(t->idx) != t->nb_entries) {
+        printf("%s: %d entries instead of %d\n", name,
+               ff_stream_index_count(t->idx), t->nb_entries);
+        return 1;
+    }
+    for (i = 0; i < t->nb_entries; i++) {
+        const AVIndexEntry *e = ff_stream_index_get(t->idx, i);
+        if (!e || memcmp(e, &t->entries[i], sizeof(*e))) {
+            printf("%s: entry %d differs\n", name, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int add(TestIndex *t, int64_t pos, int64_t timestamp,
+               int size, int distance, int flags)
+{
+    int ref = ff_add_index_entry(&t->entries, &t->nb_entries, &t->allocated_size,
+                                 pos, timestamp, size, distance, flags);
+    int ret = ff_stream_index_add(t->idx, pos, timestamp, size, distance, flags);
+
+    if (ret != ref) {
+        printf("adding %"PRId64" returned %d instead of %d\n", timestamp, ret, ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int search(TestIndex *t, AVLFG *lfg, int64_t range)
+{
+    static const int flags[] = {
+        0, AVSEEK_FLAG_BACKWARD, AVSEEK_FLAG_ANY,
+        AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY,
+    };
+    int i, j;
+
+    for (i = 0; i < 1000; i++) {
+        int64_t ts = av_lfg_get(lfg) % (range + 20) - 10;
+        for (j = 0; j < FF_ARRAY_ELEMS(flags); j++) {
+            int ref = ff_index_search_timestamp(t->entries, t->nb_entries, ts, flags[j]);
+            int ret = ff_stream_index_search(t->idx, ts, flags[j]);
+            if (ret != ref) {
+                printf("searching %"PRId64" with flags %d returned %d instead of %d\n",
+                       ts, flags[j], ret, ref);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int test(AVLFG *lfg, const char *name, int nb, int in_order)
+{
+    TestIndex t = { 0 };
+    int64_t pos = 0, ts = 0;
+    size_t flat_size;
+    int i, ret = 1;
+
+    t.idx = ff_stream_index_alloc();
+    if (!t.idx)
+        return 1;
+
+    for (i = 0; i < nb; i++) {
+        int size  = av_lfg_get(lfg) % 4 ? 1000 : av_lfg_get(lfg) % 100000;
+        int flags = av_lfg_get(lfg) % 10 ? 0 : AVINDEX_KEYFRAME;
+        int64_t timestamp;
+
+        if (in_order) {
+            ts += av_lfg_get(lfg) % 8 ? 40 : av_lfg_get(lfg) % 100;
+            timestamp = ts;
+        } else {
+            timestamp = av_lfg_get(lfg) % (nb * 4);
+        }
+        if (!(av_lfg_get(lfg) % 50))
+            flags |= AVINDEX_DISCARD_FRAME;
+        if (add(&t, pos, timestamp, size, i % 30, flags))
+            goto end;
+        if (av_lfg_get(lfg) % 8)
+            pos += size;
+        else
+            pos += av_lfg_get(lfg) % 5000;
+    }
+    if (compare(&t, name) || search(&t, lfg, in_order ? ts : nb * 4))
+        goto end;
+
+    /* invalid entries are rejected by both */
+    if (add(&t, -1, 0, 0, 0, 0) || add(&t, 0, AV_NOPTS_VALUE, 0, 0, 0))
+        goto end;
+
+    flat_size = t.allocated_size;
+    printf("%s: %d entries, compact index %s than the array\n", name,
+           t.nb_entries, ff_stream_index_size(t.idx) * 4 < flat_size ?
+           "more than 4 times smaller" : "not much smaller");
+
+    for (i = 0; 2 * i < t.nb_entries; i++)
+        t.entries[i] = t.entries[2 * i];
+    t.nb_entries = i;
+    if (ff_stream_index_reduce(t.idx, 1) < 0 || compare(&t, name) ||
+        search(&t, lfg, in_order ? ts : nb * 4))
+        goto end;
+    printf("%s: reduced to %d entries\n", name, t.nb_entries);
+
+    ret = 0;
+end:
+    av_freep(&t.entries);
+    ff_stream_index_free(&t.idx);
+    return ret;
+}
+
+/* entries appended as they are, with timestamps going back now and then */
+static int test_unsorted(AVLFG *lfg, const char *name, int nb)
+{
+    TestIndex t = { 0 };
+    int64_t pos = 0, ts = 0;
+    int i, ret = 1;
+
+    t.idx     = ff_stream_index_alloc();
+    t.entries = av_calloc(nb, sizeof(*t.entries));
+    if (!t.idx || !t.entries)
+        goto end;
+
+    for (i = 0; i < nb; i++) {
+        AVIndexEntry *e = &t.entries[i];
+
+        e->pos          = pos;
+        e->timestamp    = ts;
+        e->size         = av_lfg_get(lfg) % 100000;
+        e->min_distance = i % 30;
+        e->flags        = av_lfg_get(lfg) % 10 ? 0 : AVINDEX_KEYFRAME;
+        if (ff_stream_index_append(t.idx, e) != i) {
+            printf("%s: appending entry %d failed\n", name, i);
+            goto end;
+        }
+        t.nb_entries++;
+        pos += e->size;
+        ts  += av_lfg_get(lfg) % 8 ? 40 : -(int64_t)(av_lfg_get(lfg) % 1000);
+    }
+    if (compare(&t, name))
+        goto end;
+
+    for (i = 0; i < nb; i++) {
+        int n = av_lfg_get(lfg) % nb;
+        const AVIndexEntry *e = ff_stream_index_get(t.idx, n);
+        if (!e || memcmp(e, &t.entries[n], sizeof(*e))) {
+            printf("%s: entry %d differs\n", name, n);
+            goto end;
+        }
+    }
+    printf("%s: %d entries\n", name, t.nb_entries);
+
+    ret = 0;
+end:
+    av_freep(&t.entries);
+    ff_stream_index_free(&t.idx);
+    return ret;
+}
+
+int main(void)
+{
+    AVLFG lfg;
+
+    av_lfg_init(&lfg, 1);
+    if (test(&lfg, "append",  100000, 1) ||
+        test(&lfg, "insert",    5000, 0) ||
+        test(&lfg, "small",       10, 1) ||
+        test_unsorted(&lfg, "unsorted", 3000))
+        return 1;
+    return 0;
+}
@@ -51,6 +51,7 @@
 #include "network.h"
 #endif
 #include "riff.h"
+#include "streamindex.h"
 #include "url.h"
 
 #include "libavutil/ffversion.h"
@@ -1969,6 +1970,11 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     AVStream *st             = s->streams[stream_index];
     unsigned int max_entries = s->max_index_size / sizeof(AVIndexEntry);
 
+    if (st->internal->index) {
+        ff_stream_index_reduce(st->internal->index, FFMIN(max_entries, INT_MAX));
+        return;
+    }
+
     if ((unsigned) st->nb_index_entries >= max_entries) {
         int i;
         for (i = 0; 2 * i < st->nb_index_entries; i++)
@@ -2040,6 +2046,12 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags)
 {
     timestamp = wrap_timestamp(st, timestamp);
+    if (st->internal->index) {
+        if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
+            timestamp -= RELATIVE_TS_BASE;
+        return ff_stream_index_add(st->internal->index, pos, timestamp,
+                                   size, distance, flags);
+    }
     return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
                               &st->index_entries_allocated_size, pos,
                               timestamp, size, distance, flags);
@@ -2115,13 +2127,13 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
             if (ist1 == ist2)
                 continue;
 
-            for (i1 = i2 = 0; i1 < st1->nb_index_entries; i1++) {
-                AVIndexEntry *e1 = &st1->index_entries[i1];
+            for (i1 = i2 = 0; i1 < avformat_index_get_entries_count(st1); i1++) {
+                const AVIndexEntry *e1 = avformat_index_get_entry(st1, i1);
                 int64_t e1_pts = av_rescale_q(e1->timestamp, st1->time_base, AV_TIME_BASE_Q);
 
                 skip = FFMAX(skip, e1->size);
-                for (; i2 < st2->nb_index_entries; i2++) {
-                    AVIndexEntry *e2 = &st2->index_entries[i2];
+                for (; i2 < avformat_index_get_entries_count(st2); i2++) {
+                    const AVIndexEntry *e2 = avformat_index_get_entry(st2, i2);
                     int64_t e2_pts = av_rescale_q(e2->timestamp, st2->time_base, AV_TIME_BASE_Q);
                     if (e2_pts - e1_pts < time_tolerance)
                         continue;
@@ -2147,10 +2159,94 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
 
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
+    if (st->internal->index_callbacks)
+        return st->internal->index_callbacks->search_timestamp(st, wanted_timestamp, flags);
+    if (st->internal->index)
+        return ff_stream_index_search(st->internal->index, wanted_timestamp, flags);
     return ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
                                      wanted_timestamp, flags);
 }
 
+int avformat_index_get_entries_count(const AVStream *st)
+{
+    if (st->internal->index_callbacks)
+        return st->internal->index_callbacks->get_entries_count(st);
+    if (st->internal->index)
+        return ff_stream_index_count(st->internal->index);
+    return st->nb_index_entries;
+}
+
+const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx)
+{
+    if (st->internal->index_callbacks) {
+        if (idx < 0 || idx >= st->internal->index_callbacks->get_entries_count(st))
+            return NULL;
+        return st->internal->index_callbacks->get_entry(st, idx);
+    }
+    if (st->internal->index)
+        return ff_stream_index_get(st->internal->index, idx);
+    if (idx < 0 || idx >= st->nb_index_entries)
+        return NULL;
+    return &st->index_entries[idx];
+}
+
+const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
+                                                            int64_t wanted_timestamp,
+                                                            int flags)
+{
+    return avformat_index_get_entry(st, av_index_search_timestamp(st, wanted_timestamp, flags));
+}
+
+int ff_stream_enable_compact_index(AVFormatContext *s, AVStream *st)
+{
+    FFStreamIndex *idx;
+    int i, ret;
+
+    if (!(s->flags & AVFMT_FLAG_COMPACT_INDEX) || st->internal->index)
+        return 0;
+
+    idx = ff_stream_index_alloc();
+    if (!idx)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < st->nb_index_entries; i++) {
+        if ((ret = ff_stream_index_append(idx, &st->index_entries[i])) < 0) {
+            ff_stream_index_free(&idx);
+            return ret;
+        }
+    }
+
+    av_freep(&st->index_entries);
+    st->nb_index_entries             = 0;
+    st->index_entries_allocated_size = 0;
+    st->internal->index              = idx;
+    return 0;
+}
+
+int ff_stream_disable_compact_index(AVStream *st)
+{
+    AVIndexEntry *entries = NULL;
+    int i, nb_entries;
+
+    if (!st->internal->index)
+        return 0;
+
+    nb_entries = ff_stream_index_count(st->internal->index);
+    if (nb_entries) {
+        entries = av_malloc_array(nb_entries, sizeof(*entries));
+        if (!entries)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < nb_entries; i++)
+            entries[i] = *ff_stream_index_get(st->internal->index, i);
+    }
+
+    av_freep(&st->index_entries);
+    st->index_entries                = entries;
+    st->nb_index_entries             = nb_entries;
+    st->index_entries_allocated_size = nb_entries * sizeof(*entries);
+    ff_stream_index_free(&st->internal->index);
+    return 0;
+}
+
 static int64_t ff_read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
                                  int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ))
 {
@@ -2180,15 +2276,15 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
     pos_limit = -1; // GCC falsely says it may be uninitialized.
 
     st = s->streams[stream_index];
-    if (st->index_entries) {
-        AVIndexEntry *e;
+    if (avformat_index_get_entries_count(st)) {
+        const AVIndexEntry *e;
 
         /* FIXME: Whole function must be checked for non-keyframe entries in
          * index case, especially read_timestamp(). */
         index = av_index_search_timestamp(st, target_ts,
                                           flags | AVSEEK_FLAG_BACKWARD);
         index = FFMAX(index, 0);
-        e     = &st->index_entries[index];
+        e     = avformat_index_get_entry(st, index);
 
         if (e->timestamp <= target_ts || e->pos == e->min_distance) {
             pos_min = e->pos;
@@ -2201,9 +2297,9 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
 
         index = av_index_search_timestamp(st, target_ts,
                                           flags & ~AVSEEK_FLAG_BACKWARD);
-        av_assert0(index < st->nb_index_entries);
+        av_assert0(index < avformat_index_get_entries_count(st));
         if (index >= 0) {
-            e = &st->index_entries[index];
+            e = avformat_index_get_entry(st, index);
             av_assert1(e->timestamp >= target_ts);
             pos_max   = e->pos;
             ts_max    = e->timestamp;
@@ -2395,26 +2491,27 @@ static int seek_frame_byte(AVFormatContext *s, int stream_index,
 static int seek_frame_generic(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
-    int index;
+    int index, nb_index_entries;
     int64_t ret;
     AVStream *st;
-    AVIndexEntry *ie;
+    const AVIndexEntry *ie;
 
     st = s->streams[stream_index];
 
     index = av_index_search_timestamp(st, timestamp, flags);
+    nb_index_entries = avformat_index_get_entries_count(st);
 
-    if (index < 0 && st->nb_index_entries &&
-        timestamp < st->index_entries[0].timestamp)
+    if (index < 0 && nb_index_entries &&
+        timestamp < avformat_index_get_entry(st, 0)->timestamp)
         return -1;
 
-    if (index < 0 || index == st->nb_index_entries - 1) {
+    if (index < 0 || index == nb_index_entries - 1) {
         AVPacket pkt;
         int nonkey = 0;
 
-        if (st->nb_index_entries) {
-            av_assert0(st->index_entries);
-            ie = &st->index_entries[st->nb_index_entries - 1];
+        if (nb_index_entries) {
+            ie = avformat_index_get_entry(st, nb_index_entries - 1);
+            av_assert0(ie);
             if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
                 return ret;
             ff_update_cur_dts(s, st, ie->timestamp);
@@ -2451,7 +2548,7 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
     if (s->iformat->read_seek)
         if (s->iformat->read_seek(s, stream_index, timestamp, flags) >= 0)
             return 0;
-    ie = &st->index_entries[index];
+    ie = avformat_index_get_entry(st, index);
     if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
         return ret;
     ff_update_cur_dts(s, st, ie->timestamp);
@@ -4355,6 +4452,7 @@ static void free_stream(AVStream **pst)
             av_freep(&st->internal->bsfcs);
         }
         av_freep(&st->internal->priv_pts);
+        ff_stream_index_free(&st->internal->index);
         av_bsf_free(&st->internal->extract_extradata.bsf);
         av_packet_free(&st->internal->extract_extradata.pkt);
     }
@@ -215,6 +215,21 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
     return 0;
 }
 
+static void buffer_pool_init_cache(AVBufferPool *pool)
+{
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i], 0);
+    atomic_init(&pool->hits,         0);
+    atomic_init(&pool->misses,       0);
+    atomic_init(&pool->nb_allocated, 0);
+    atomic_init(&pool->nb_idle,      0);
+    atomic_init(&pool->peak,         0);
+    atomic_init(&pool->max_idle,    -1);
+    atomic_init(&pool->uninited,     0);
+}
+
 AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
                                    AVBufferRef* (*alloc)(void *opaque, int size),
                                    void (*pool_free)(void *opaque))
@@ -231,6 +246,7 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    buffer_pool_init_cache(pool);
 
     return pool;
 }
@@ -247,6 +263,7 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    buffer_pool_init_cache(pool);
 
     return pool;
 }
@@ -257,6 +274,16 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        BufferPoolEntry *buf = (BufferPoolEntry*)atomic_load(&pool->cache[i]);
+        if (buf) {
+            buf->next  = pool->pool;
+            pool->pool = buf;
+        }
+    }
+
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -272,15 +299,81 @@ static void buffer_pool_free(AVBufferPool *pool)
     av_freep(&pool);
 }
 
+/* put an entry back into the pool, preferably into a free cache slot */
+static void pool_put_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        intptr_t expected = 0;
+
+        if (atomic_load_explicit(&pool->cache[i], memory_order_relaxed))
+            continue;
+        if (atomic_compare_exchange_strong_explicit(&pool->cache[i], &expected,
+                                                    (intptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed))
+            return;
+    }
+
+    ff_mutex_lock(&pool->mutex);
+    buf->next = pool->pool;
+    pool->pool = buf;
+    ff_mutex_unlock(&pool->mutex);
+}
+
+/* take an entry out of the cache slots, or NULL if they are all empty */
+static BufferPoolEntry *pool_get_cached_entry(AVBufferPool *pool)
+{
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        BufferPoolEntry *buf;
+
+        if (!atomic_load_explicit(&pool->cache[i], memory_order_relaxed))
+            continue;
+        buf = (BufferPoolEntry*)atomic_exchange_explicit(&pool->cache[i], 0,
+                                                         memory_order_acquire);
+        if (buf)
+            return buf;
+    }
+
+    return NULL;
+}
+
+/* free the memory of an entry which is not in the pool anymore */
+static void pool_free_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    buf->free(buf->opaque, buf->data);
+    av_free(buf);
+    atomic_fetch_sub_explicit(&pool->nb_allocated, 1, memory_order_relaxed);
+}
+
 void av_buffer_pool_uninit(AVBufferPool **ppool)
 {
     AVBufferPool *pool;
+    BufferPoolEntry *buf;
 
     if (!ppool || !*ppool)
         return;
     pool   = *ppool;
     *ppool = NULL;
 
+    /* give back the memory of the unused buffers right away rather than
+     * once the last buffer still in use is released */
+    atomic_store(&pool->uninited, 1);
+    while ((buf = pool_get_cached_entry(pool))) {
+        atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_free_entry(pool, buf);
+    }
+    ff_mutex_lock(&pool->mutex);
+    while ((buf = pool->pool)) {
+        pool->pool = buf->next;
+        atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_free_entry(pool, buf);
+    }
+    ff_mutex_unlock(&pool->mutex);
+
     if (atomic_fetch_add_explicit(&pool->refcount, -1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
@@ -289,14 +382,20 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
+    int max_idle = atomic_load_explicit(&pool->max_idle, memory_order_relaxed);
 
-    if(CONFIG_MEMORY_POISONING)
-        memset(buf->data, FF_MEMORY_POISON, pool->size);
+    /* concurrent releases may overshoot max_idle slightly, which is fine */
+    if (atomic_load_explicit(&pool->uninited, memory_order_relaxed) ||
+        (max_idle >= 0 &&
+         atomic_load_explicit(&pool->nb_idle, memory_order_relaxed) >= max_idle)) {
+        pool_free_entry(pool, buf);
+    } else {
+        if(CONFIG_MEMORY_POISONING)
+            memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+        atomic_fetch_add_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_put_entry(pool, buf);
+    }
 
     if (atomic_fetch_add_explicit(&pool->refcount, -1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -335,23 +434,84 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
     AVBufferRef *ret;
     BufferPoolEntry *buf;
+    int in_use, peak;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
-    if (buf) {
-        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                               buf, 0);
-        if (ret) {
+    buf = pool_get_cached_entry(pool);
+    if (!buf) {
+        ff_mutex_lock(&pool->mutex);
+        buf = pool->pool;
+        if (buf) {
             pool->pool = buf->next;
             buf->next = NULL;
+            ff_mutex_unlock(&pool->mutex);
+        } else {
+            ret = pool_alloc_buffer(pool);
+            ff_mutex_unlock(&pool->mutex);
+            if (!ret)
+                return NULL;
+            atomic_fetch_add_explicit(&pool->nb_allocated, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+            goto end;
         }
-    } else {
-        ret = pool_alloc_buffer(pool);
     }
-    ff_mutex_unlock(&pool->mutex);
 
-    if (ret)
-        atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    ret = av_buffer_create(buf->data, pool->size, pool_release_buffer, buf, 0);
+    if (!ret) {
+        pool_put_entry(pool, buf);
+        return NULL;
+    }
+    atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+
+end:
+    /* the caller holds one reference, so the old value is the number of
+     * buffers in use including this one */
+    in_use = atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    peak   = atomic_load_explicit(&pool->peak, memory_order_relaxed);
+    while (in_use > peak &&
+           !atomic_compare_exchange_weak_explicit(&pool->peak, &peak, in_use,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
 
     return ret;
 }
+
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle)
+{
+    BufferPoolEntry *buf;
+
+    atomic_store_explicit(&pool->max_idle, max_idle, memory_order_relaxed);
+    if (max_idle < 0)
+        return;
+
+    /* evict what is above the new limit, from the list first */
+    ff_mutex_lock(&pool->mutex);
+    while (atomic_load_explicit(&pool->nb_idle, memory_order_relaxed) > max_idle &&
+           (buf = pool->pool)) {
+        pool->pool = buf->next;
+        atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_free_entry(pool, buf);
+    }
+    ff_mutex_unlock(&pool->mutex);
+
+    while (atomic_load_explicit(&pool->nb_idle, memory_order_relaxed) > max_idle &&
+           (buf = pool_get_cached_entry(pool))) {
+        atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_free_entry(pool, buf);
+    }
+}
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    stats->hits        = atomic_load_explicit(&pool->hits,   memory_order_relaxed);
+    stats->misses      = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+    /* the reference of the owner of the pool is dropped by uninit */
+    stats->outstanding = atomic_load_explicit(&pool->refcount, memory_order_relaxed) -
+                         !atomic_load_explicit(&pool->uninited, memory_order_relaxed);
+    stats->allocated   = atomic_load_explicit(&pool->nb_allocated, memory_order_relaxed);
+    stats->peak        = atomic_load_explicit(&pool->peak, memory_order_relaxed);
+    stats->bytes       = (int64_t)stats->allocated * pool->size;
+}
@@ -223,11 +223,13 @@ int av_buffer_realloc(AVBufferRef **buf, int size);
  *
  * When the caller is done with the pool and no longer needs to allocate any new
  * buffers, av_buffer_pool_uninit() must be called to mark the pool as freeable.
- * Once all the buffers are released, it will automatically be freed.
+ * Unused buffers are freed right away, the others as they are released. Once
+ * all the buffers are released, the pool will automatically be freed.
  *
  * Allocating and releasing buffers with this API is thread-safe as long as
  * either the default alloc callback is used, or the user-supplied one is
- * thread-safe.
+ * thread-safe. Buffers are normally handed out and returned without taking
+ * a lock; the alloc callback is never called concurrently for the same pool.
  */
 
 /**
@@ -270,7 +272,8 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
  * Mark the pool as being available for freeing. It will actually be freed only
  * once all the allocated buffers associated with the pool are released. Thus it
  * is safe to call this function while some of the allocated buffers are still
- * in use.
+ * in use. Buffers which are not in use are freed immediately, the others when
+ * they are released.
  *
  * @param pool pointer to the pool to be freed. It will be set to NULL.
  */
@@ -284,6 +287,63 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Limit the number of unused buffers kept by the pool for reuse. Buffers
+ * released while this many are already kept are freed instead, and unused
+ * buffers above the limit are freed immediately.
+ *
+ * Note that the unused buffers of a pool are always freed by
+ * av_buffer_pool_uninit(), and the buffers still in use once released.
+ *
+ * @param pool     the buffer pool
+ * @param max_idle maximum number of unused buffers, a negative value (the
+ *                 default) means no limit
+ */
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle);
+
+/**
+ * Usage statistics of an AVBufferPool, filled by av_buffer_pool_get_stats().
+ */
+typedef struct AVBufferPoolStats {
+    /**
+     * Number of av_buffer_pool_get() calls which reused a buffer from the pool.
+     */
+    uint64_t hits;
+    /**
+     * Number of av_buffer_pool_get() calls which had to allocate a new buffer.
+     */
+    uint64_t misses;
+    /**
+     * Number of buffers currently handed out by the pool and not yet released.
+     */
+    int outstanding;
+    /**
+     * Number of buffers currently allocated by the pool, whether in use or
+     * kept for reuse.
+     */
+    int allocated;
+    /**
+     * Highest number of buffers handed out at the same time.
+     */
+    int peak;
+    /**
+     * Size in bytes of all the buffers currently allocated by the pool.
+     */
+    int64_t bytes;
+} AVBufferPoolStats;
+
+/**
+ * Get the usage statistics of a buffer pool. This function may be called
+ * while other threads get and release buffers, in which case the values are
+ * a snapshot which is not necessarily consistent across fields. It may also
+ * be called after av_buffer_pool_uninit(), through another pointer to the
+ * pool, as long as some of its buffers are still in use.
+ *
+ * @param pool  the buffer pool
+ * @param stats structure to fill
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats);
+
 /**
  * @}
  */
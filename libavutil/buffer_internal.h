@@ -73,10 +73,41 @@ typedef struct BufferPoolEntry {
     struct BufferPoolEntry *next;
 } BufferPoolEntry;
 
+/**
+ * Number of released buffers an AVBufferPool keeps in its lock-free cache.
+ */
+#define BUFFER_POOL_CACHE_SIZE 16
+
 struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Released buffers are stored here first and only go to the
+     * mutex-protected list above when all the slots are taken. Each slot
+     * holds either 0 or a BufferPoolEntry pointer, and an entry is only ever
+     * taken out of a slot with an atomic exchange, so the owner of an entry
+     * is always well defined and the ABA problem of lock-free lists does
+     * not arise.
+     */
+    atomic_intptr_t cache[BUFFER_POOL_CACHE_SIZE];
+
+    /* number of av_buffer_pool_get() calls served by a pooled buffer */
+    atomic_uint_least64_t hits;
+    /* number of av_buffer_pool_get() calls which allocated a new buffer */
+    atomic_uint_least64_t misses;
+
+    /* number of buffers allocated and not freed yet, in use or not */
+    atomic_int nb_allocated;
+    /* number of buffers sitting unused in the cache or the list */
+    atomic_int nb_idle;
+    /* highest number of buffers in use at the same time */
+    atomic_int peak;
+    /* see av_buffer_pool_set_max_idle(), negative for no limit */
+    atomic_int max_idle;
+    /* set by av_buffer_pool_uninit(), released buffers are freed then */
+    atomic_int uninited;
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
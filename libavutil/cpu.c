@@ -48,6 +48,7 @@
 #endif
 
 static atomic_int cpu_flags = ATOMIC_VAR_INIT(-1);
+static atomic_int shared_threads = ATOMIC_VAR_INIT(-1);
 
 static int get_cpu_flags(void)
 {
@@ -264,6 +265,16 @@ int av_parse_cpu_caps(unsigned *flags, const char *s)
     return av_opt_eval_flags(&pclass, &cpuflags_opts[0], s, flags);
 }
 
+void av_cpu_set_shared_threads(int count)
+{
+    atomic_store_explicit(&shared_threads, FFMAX(count, -1), memory_order_relaxed);
+}
+
+int ff_get_shared_threads(void)
+{
+    return atomic_load_explicit(&shared_threads, memory_order_relaxed);
+}
+
 int av_cpu_count(void)
 {
     static volatile int printed;
@@ -116,6 +116,26 @@ int av_parse_cpu_caps(unsigned *flags, const char *s);
  */
 int av_cpu_count(void);
 
+/**
+ * Make the slice threading contexts created from now on (e.g. by libavcodec
+ * and libavfilter) run their jobs on a single pool of worker threads shared
+ * by the whole process, instead of starting their own threads.
+ *
+ * Frame threaded decoders opened afterwards also decode their frames on this
+ * pool rather than on threads of their own, unless their callbacks are not
+ * thread safe (AVCodecContext.thread_safe_callbacks). Codecs whose slice
+ * threading jobs wait for each other also keep their own threads.
+ *
+ * The pool is started when the first context using it is created and
+ * stopped when the last one is freed. Contexts created before the call are
+ * not affected.
+ *
+ * @param count number of worker threads of the pool, 0 for the number of
+ *              logical CPU cores, a negative value to let every context
+ *              start its own threads (the default)
+ */
+void av_cpu_set_shared_threads(int count);
+
 /**
  * Get the maximum data alignment that may be required by FFmpeg.
  *
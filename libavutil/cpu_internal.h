@@ -51,4 +51,10 @@ size_t ff_get_cpu_max_align_arm(void);
 size_t ff_get_cpu_max_align_ppc(void);
 size_t ff_get_cpu_max_align_x86(void);
 
+/**
+ * @return the size requested with av_cpu_set_shared_threads(), negative if
+ *         the shared thread pool is disabled
+ */
+int ff_get_shared_threads(void);
+
 #endif /* AVUTIL_CPU_INTERNAL_H */
@@ -17,6 +17,8 @@
  */
 
 #include <stdatomic.h>
+#include "cpu.h"
+#include "cpu_internal.h"
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
@@ -32,8 +34,36 @@ typedef struct WorkerContext {
     int             done;
 } WorkerContext;
 
+/**
+ * Process-wide pool of workers, see av_cpu_set_shared_threads().
+ *
+ * Executions waiting for workers are queued by decreasing priority. An idle
+ * worker joins the first one, takes a thread index and claims its jobs from
+ * the same counter as the caller and the other workers of that execution.
+ */
+typedef struct SharedPool {
+    pthread_t       *threads;
+    int             nb_threads;
+    int             refcount;
+    int             finished;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    AVSliceThread   *queue;
+} SharedPool;
+
+static pthread_mutex_t shared_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static SharedPool *shared_pool;
+
 struct AVSliceThread {
     WorkerContext   *workers;
+    SharedPool      *pool;
+    AVSliceThread   *next;
+    int             priority;
+    int             queued;
+    int             nb_slots;
+    int             nb_busy;
+
     int             nb_threads;
     int             nb_active_threads;
     int             nb_jobs;
@@ -91,15 +121,229 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+static void shared_queue_add(SharedPool *pool, AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool->queue;
+
+    while (*p && (*p)->priority >= ctx->priority)
+        p = &(*p)->next;
+    ctx->next   = *p;
+    ctx->queued = 1;
+    *p          = ctx;
+}
+
+static void shared_queue_remove(SharedPool *pool, AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool->queue;
+
+    while (*p != ctx)
+        p = &(*p)->next;
+    *p          = ctx->next;
+    ctx->next   = NULL;
+    ctx->queued = 0;
+}
+
+static void run_shared_jobs(AVSliceThread *ctx, int threadnr)
+{
+    unsigned nb_jobs = ctx->nb_jobs;
+    unsigned job;
+
+    while ((job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+        ctx->worker_func(ctx->priv, job, threadnr, nb_jobs, ctx->nb_active_threads);
+}
+
+static void *attribute_align_arg shared_worker(void *v)
+{
+    SharedPool *pool = v;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->finished) {
+        AVSliceThread *ctx = pool->queue;
+        int threadnr;
+
+        if (!ctx) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            continue;
+        }
+
+        threadnr = ctx->nb_slots++;
+        ctx->nb_busy++;
+        if (ctx->nb_slots == ctx->nb_active_threads)
+            shared_queue_remove(pool, ctx);
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_shared_jobs(ctx, threadnr);
+
+        pthread_mutex_lock(&pool->mutex);
+        /* all jobs are claimed, nothing left for other workers */
+        if (ctx->queued)
+            shared_queue_remove(pool, ctx);
+        if (!--ctx->nb_busy)
+            pthread_cond_signal(&ctx->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static void shared_pool_stop(SharedPool *pool, int nb_threads)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool->threads);
+    av_free(pool);
+}
+
+static int shared_pool_ref(SharedPool **ppool, int nb_threads)
+{
+    SharedPool *pool;
+    int i, ret = 0;
+
+    pthread_mutex_lock(&shared_pool_lock);
+    if ((pool = shared_pool))
+        goto end;
+
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool || !(pool->threads = av_calloc(nb_threads, sizeof(*pool->threads)))) {
+        av_freep(&pool);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    for (i = 0; i < nb_threads; i++) {
+        if (ret = pthread_create(&pool->threads[i], NULL, shared_worker, pool)) {
+            shared_pool_stop(pool, i);
+            pool = NULL;
+            ret  = AVERROR(ret);
+            goto end;
+        }
+    }
+    pool->nb_threads = nb_threads;
+    shared_pool      = pool;
+
+end:
+    if (pool)
+        pool->refcount++;
+    *ppool = pool;
+    pthread_mutex_unlock(&shared_pool_lock);
+    return ret;
+}
+
+static void shared_pool_unref(SharedPool *pool)
+{
+    pthread_mutex_lock(&shared_pool_lock);
+    if (--pool->refcount) {
+        pthread_mutex_unlock(&shared_pool_lock);
+        return;
+    }
+    shared_pool = NULL;
+    pthread_mutex_unlock(&shared_pool_lock);
+
+    shared_pool_stop(pool, pool->nb_threads);
+}
+
+static void shared_execute(AVSliceThread *ctx, int nb_jobs)
+{
+    SharedPool *pool = ctx->pool;
+    int i;
+
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+
+    /* the caller always runs jobs itself, with thread index 0 */
+    pthread_mutex_lock(&pool->mutex);
+    ctx->nb_slots = 1;
+    if (ctx->nb_active_threads > 1) {
+        shared_queue_add(pool, ctx);
+        for (i = 1; i < ctx->nb_active_threads; i++)
+            pthread_cond_signal(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_shared_jobs(ctx, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (ctx->queued)
+        shared_queue_remove(pool, ctx);
+    while (ctx->nb_busy)
+        pthread_cond_wait(&ctx->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static int create_shared(AVSliceThread **pctx, void *priv,
+                         void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                         int nb_threads, int pool_size, int caller_runs_jobs)
+{
+    AVSliceThread *ctx;
+    int ret;
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    if ((ret = shared_pool_ref(&ctx->pool, pool_size)) < 0) {
+        av_freep(pctx);
+        return ret;
+    }
+
+    /* more threads could not run jobs at the same time */
+    if (!nb_threads || nb_threads > ctx->pool->nb_threads + caller_runs_jobs)
+        nb_threads = ctx->pool->nb_threads + caller_runs_jobs;
+
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->nb_threads  = nb_threads;
+    atomic_init(&ctx->first_job, 0);
+    atomic_init(&ctx->current_job, 0);
+    pthread_mutex_init(&ctx->done_mutex, NULL);
+    pthread_cond_init(&ctx->done_cond, NULL);
+
+    return nb_threads;
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
                               int nb_threads)
+{
+    int pool_size;
+
+    av_assert0(nb_threads >= 0);
+
+    /* main_func may wait for the jobs, so it cannot share workers */
+    pool_size = ff_get_shared_threads();
+    if (pool_size >= 0 && !main_func)
+        return create_shared(pctx, priv, worker_func, nb_threads, pool_size, 1);
+
+    return avpriv_slicethread_create_private(pctx, priv, worker_func, main_func, nb_threads);
+}
+
+int avpriv_slicethread_create_private(AVSliceThread **pctx, void *priv,
+                                      void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                      void (*main_func)(void *priv),
+                                      int nb_threads)
 {
     AVSliceThread *ctx;
     int nb_workers, i;
 
     av_assert0(nb_threads >= 0);
+
     if (!nb_threads) {
         int nb_cpus = av_cpu_count();
         if (nb_cpus > 1)
@@ -166,6 +410,12 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+
+    if (ctx->pool) {
+        shared_execute(ctx, nb_jobs);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -196,6 +446,50 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     }
 }
 
+int avpriv_slicethread_create_async(AVSliceThread **pctx, void *priv,
+                                    void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                    int nb_threads)
+{
+    int pool_size = ff_get_shared_threads();
+
+    av_assert0(nb_threads >= 0);
+    if (pool_size < 0) {
+        *pctx = NULL;
+        return AVERROR(ENOSYS);
+    }
+    return create_shared(pctx, priv, worker_func, nb_threads, pool_size, 0);
+}
+
+void avpriv_slicethread_execute_async(AVSliceThread *ctx, int nb_jobs)
+{
+    SharedPool *pool = ctx->pool;
+    int i;
+
+    av_assert0(pool && nb_jobs > 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    av_assert0(!ctx->queued);
+    /* the workers of the previous execution may still be leaving it */
+    while (ctx->nb_busy)
+        pthread_cond_wait(&ctx->done_cond, &pool->mutex);
+
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    ctx->nb_slots          = 0;
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+
+    shared_queue_add(pool, ctx);
+    for (i = 0; i < ctx->nb_active_threads; i++)
+        pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int avpriv_slicethread_set_priority(AVSliceThread *ctx, int priority)
+{
+    ctx->priority = priority;
+    return 0;
+}
+
 void avpriv_slicethread_free(AVSliceThread **pctx)
 {
     AVSliceThread *ctx;
@@ -205,6 +499,22 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+
+    if (ctx->pool) {
+        SharedPool *pool = ctx->pool;
+
+        pthread_mutex_lock(&pool->mutex);
+        while (ctx->queued || ctx->nb_busy)
+            pthread_cond_wait(&ctx->done_cond, &pool->mutex);
+        pthread_mutex_unlock(&pool->mutex);
+
+        shared_pool_unref(pool);
+        pthread_cond_destroy(&ctx->done_cond);
+        pthread_mutex_destroy(&ctx->done_mutex);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -242,11 +552,38 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(EINVAL);
 }
 
+int avpriv_slicethread_create_private(AVSliceThread **pctx, void *priv,
+                                      void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                      void (*main_func)(void *priv),
+                                      int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(EINVAL);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
 }
 
+int avpriv_slicethread_create_async(AVSliceThread **pctx, void *priv,
+                                    void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                    int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
+void avpriv_slicethread_execute_async(AVSliceThread *ctx, int nb_jobs)
+{
+    av_assert0(0);
+}
+
+int avpriv_slicethread_set_priority(AVSliceThread *ctx, int priority)
+{
+    return AVERROR(ENOSYS);
+}
+
 void avpriv_slicethread_free(AVSliceThread **pctx)
 {
     av_assert0(!pctx || !*pctx);
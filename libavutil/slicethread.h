@@ -29,12 +29,30 @@ typedef struct AVSliceThread AVSliceThread;
  * @param main_func special callback function, called from main thread, may be NULL
  * @param nb_threads number of threads, 0 for automatic, must be >= 0
  * @return return number of threads or negative AVERROR on failure
+ *
+ * If av_cpu_set_shared_threads() enabled the shared thread pool and main_func
+ * is NULL, the jobs are run by the caller of avpriv_slicethread_execute()
+ * together with the workers of the shared pool, nb_threads then bounds the
+ * number of threads running jobs of one execution, and is limited to the
+ * size of the pool plus one. The jobs are claimed in increasing order, but
+ * fewer of them than nb_threads may run at the same time.
  */
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Same as avpriv_slicethread_create(), but the context always has threads of
+ * its own, even if the shared thread pool is enabled. The jobs of an
+ * execution are then all run at the same time when nb_jobs <= nb_threads,
+ * so they may wait for each other.
+ */
+int avpriv_slicethread_create_private(AVSliceThread **pctx, void *priv,
+                                      void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                      void (*main_func)(void *priv),
+                                      int nb_threads);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
@@ -43,6 +61,43 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
  */
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main);
 
+/**
+ * Create a context whose executions are run asynchronously by the workers
+ * of the shared thread pool, see av_cpu_set_shared_threads().
+ * @param pctx slice threading context returned here
+ * @param priv private pointer to be passed to callback function
+ * @param worker_func callback function to be executed
+ * @param nb_threads maximum number of workers running jobs of one execution,
+ *                   0 for the size of the pool, must be >= 0
+ * @return return number of threads, AVERROR(ENOSYS) if the shared thread
+ *         pool is disabled or another negative AVERROR on failure
+ */
+int avpriv_slicethread_create_async(AVSliceThread **pctx, void *priv,
+                                    void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                    int nb_threads);
+
+/**
+ * Queue an execution of a context created with
+ * avpriv_slicethread_create_async() and return without waiting for it.
+ * The jobs must signal their completion themselves. The previous execution
+ * of the context must have been started by a worker.
+ * Executions with the same priority are started in submission order.
+ * @param ctx slice threading context
+ * @param nb_jobs number of jobs, must be > 0
+ */
+void avpriv_slicethread_execute_async(AVSliceThread *ctx, int nb_jobs);
+
+/**
+ * Set the priority of the executions of a context on the shared thread pool,
+ * see av_cpu_set_shared_threads(). Workers join the pending executions with
+ * the highest priority first. Has no effect on contexts with their own
+ * threads. Must not be called during avpriv_slicethread_execute().
+ * @param ctx slice threading context
+ * @param priority priority, default 0
+ * @return 0, or AVERROR(ENOSYS) if threads are not supported
+ */
+int avpriv_slicethread_set_priority(AVSliceThread *ctx, int priority);
+
 /**
  * Destroy slice threading context.
  * @param pctx pointer to context
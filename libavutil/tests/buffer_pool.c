@@ -0,0 +1,141 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program gets and releases buffers of one AVBufferPool from
+ * several threads at once and checks that no buffer is ever handed out
+ * twice, that the pool statistics add up, and that unused buffers are
+ * evicted down to the configured limit.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/thread.h"
+
+#define NB_THREADS    4
+#define NB_ITERATIONS 20000
+#define NB_HELD       3
+#define BUF_SIZE      64
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int errors;
+} ThreadArg;
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *held[NB_HELD] = { NULL };
+    int i, j;
+
+    for (i = 0; i < NB_ITERATIONS; i++) {
+        AVBufferRef **buf = &held[i % NB_HELD];
+
+        if (*buf) {
+            for (j = 0; j < BUF_SIZE; j++)
+                if ((*buf)->data[j] != (uint8_t)(arg->id + i % NB_HELD))
+                    arg->errors++;
+            av_buffer_unref(buf);
+        }
+
+        *buf = av_buffer_pool_get(arg->pool);
+        if (!*buf) {
+            arg->errors++;
+            break;
+        }
+        memset((*buf)->data, arg->id + i % NB_HELD, BUF_SIZE);
+    }
+
+    for (i = 0; i < NB_HELD; i++)
+        av_buffer_unref(&held[i]);
+
+    return NULL;
+}
+
+int main(void)
+{
+    AVBufferPool *pool, *alive;
+    AVBufferPoolStats stats;
+    ThreadArg args[NB_THREADS];
+    pthread_t threads[NB_THREADS];
+    AVBufferRef *held[NB_HELD];
+    int i, ret;
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    for (i = 0; i < NB_THREADS; i++) {
+        args[i].pool   = pool;
+        args[i].id     = 16 * i;
+        args[i].errors = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &args[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (i = 0; i < NB_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        if (args[i].errors) {
+            fprintf(stderr, "thread %d: %d errors\n", i, args[i].errors);
+            return 2;
+        }
+    }
+
+    av_buffer_pool_get_stats(pool, &stats);
+    if (stats.outstanding ||
+        stats.hits + stats.misses != NB_THREADS * NB_ITERATIONS ||
+        stats.misses > NB_THREADS * NB_HELD ||
+        stats.allocated != stats.misses || stats.peak > stats.allocated ||
+        stats.bytes != (int64_t)stats.allocated * BUF_SIZE) {
+        fprintf(stderr, "unexpected stats: hits %"PRIu64" misses %"PRIu64
+                " outstanding %d allocated %d peak %d\n", stats.hits,
+                stats.misses, stats.outstanding, stats.allocated, stats.peak);
+        return 3;
+    }
+
+    av_buffer_pool_set_max_idle(pool, 1);
+    av_buffer_pool_get_stats(pool, &stats);
+    if (stats.allocated != 1)
+        return 4;
+
+    for (i = 0; i < NB_HELD; i++)
+        if (!(held[i] = av_buffer_pool_get(pool)))
+            return 1;
+    for (i = 0; i < NB_HELD; i++)
+        av_buffer_unref(&held[i]);
+    av_buffer_pool_get_stats(pool, &stats);
+    if (stats.allocated != 1 || stats.outstanding || stats.peak < NB_HELD)
+        return 4;
+
+    /* the pool stays alive until its last buffer is released */
+    if (!(held[0] = av_buffer_pool_get(pool)))
+        return 1;
+    alive = pool;
+    av_buffer_pool_uninit(&pool);
+    av_buffer_pool_get_stats(alive, &stats);
+    if (stats.outstanding != 1 || stats.allocated != 1)
+        return 4;
+    av_buffer_unref(&held[0]);
+
+    return 0;
+}
@@ -102,6 +102,28 @@ void av_thread_message_queue_free(AVThreadMessageQueue **mq)
 #endif
 }
 
+int av_thread_message_queue_grow(AVThreadMessageQueue *mq, unsigned nelem)
+{
+#if HAVE_THREADS
+    unsigned cur;
+    int ret;
+
+    pthread_mutex_lock(&mq->lock);
+    cur = (av_fifo_size(mq->fifo) + av_fifo_space(mq->fifo)) / mq->elsize;
+    if (nelem > INT_MAX / mq->elsize - cur) {
+        ret = AVERROR(EINVAL);
+    } else {
+        ret = av_fifo_realloc2(mq->fifo, (cur + nelem) * mq->elsize);
+        if (ret >= 0)
+            pthread_cond_broadcast(&mq->cond_send);
+    }
+    pthread_mutex_unlock(&mq->lock);
+    return ret;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
 int av_thread_message_queue_nb_elems(AVThreadMessageQueue *mq)
 {
 #if HAVE_THREADS
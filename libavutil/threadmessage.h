@@ -45,6 +45,19 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
                                   unsigned nelem,
                                   unsigned elsize);
 
+/**
+ * Grow a message queue so that it can hold nelem more messages.
+ *
+ * This may be called while other threads use the queue; senders blocked
+ * because the queue was full are woken up.
+ *
+ * @param mq      the message queue
+ * @param nelem   number of elements to add to the maximum size of the queue
+ * @return  >=0 for success; <0 for error, in particular AVERROR(ENOSYS) if
+ *          lavu was built without thread support
+ */
+int av_thread_message_queue_grow(AVThreadMessageQueue *mq, unsigned nelem);
+
 /**
  * Free a message queue.
  *
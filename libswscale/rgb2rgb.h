@@ -142,6 +142,22 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * 16-bit versions of interleaveBytes() and deinterleaveBytes(), plus a plain
+ * copy, which also shift every sample left by shift bits, or right by -shift
+ * bits if shift is negative. The width is in samples, the strides in bytes.
+ */
+extern void (*interleaveWords)(const uint16_t *src1, const uint16_t *src2, uint16_t *dst,
+                               int width, int height, int src1Stride,
+                               int src2Stride, int dstStride, int shift);
+
+extern void (*deinterleaveWords)(const uint16_t *src, uint16_t *dst1, uint16_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride, int shift);
+
+extern void (*shiftWords)(const uint16_t *src, uint16_t *dst, int width, int height,
+                          int srcStride, int dstStride, int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -745,6 +745,60 @@ static void deinterleaveBytes_c(const uint8_t *src, uint8_t *dst1, uint8_t *dst2
     }
 }
 
+static void interleaveWords_c(const uint16_t *src1, const uint16_t *src2,
+                              uint16_t *dest, int width, int height,
+                              int src1Stride, int src2Stride, int dstStride,
+                              int shift)
+{
+    const int lshift = FFMAX(shift, 0), rshift = FFMAX(-shift, 0);
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        for (w = 0; w < width; w++) {
+            dest[2 * w + 0] = (uint16_t)(src1[w] << lshift) >> rshift;
+            dest[2 * w + 1] = (uint16_t)(src2[w] << lshift) >> rshift;
+        }
+        dest = (uint16_t *)((uint8_t *)dest + dstStride);
+        src1 = (const uint16_t *)((const uint8_t *)src1 + src1Stride);
+        src2 = (const uint16_t *)((const uint8_t *)src2 + src2Stride);
+    }
+}
+
+static void deinterleaveWords_c(const uint16_t *src, uint16_t *dst1, uint16_t *dst2,
+                                int width, int height, int srcStride,
+                                int dst1Stride, int dst2Stride, int shift)
+{
+    const int lshift = FFMAX(shift, 0), rshift = FFMAX(-shift, 0);
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        for (w = 0; w < width; w++) {
+            dst1[w] = (uint16_t)(src[2 * w + 0] << lshift) >> rshift;
+            dst2[w] = (uint16_t)(src[2 * w + 1] << lshift) >> rshift;
+        }
+        src  = (const uint16_t *)((const uint8_t *)src + srcStride);
+        dst1 = (uint16_t *)((uint8_t *)dst1 + dst1Stride);
+        dst2 = (uint16_t *)((uint8_t *)dst2 + dst2Stride);
+    }
+}
+
+static void shiftWords_c(const uint16_t *src, uint16_t *dst, int width, int height,
+                         int srcStride, int dstStride, int shift)
+{
+    const int lshift = FFMAX(shift, 0), rshift = FFMAX(-shift, 0);
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        for (w = 0; w < width; w++)
+            dst[w] = (uint16_t)(src[w] << lshift) >> rshift;
+        src = (const uint16_t *)((const uint8_t *)src + srcStride);
+        dst = (uint16_t *)((uint8_t *)dst + dstStride);
+    }
+}
+
 static inline void vu9_to_vu12_c(const uint8_t *src1, const uint8_t *src2,
                                  uint8_t *dst1, uint8_t *dst2,
                                  int width, int height,
@@ -984,6 +1038,9 @@ static av_cold void rgb2rgb_init_c(void)
     ff_rgb24toyv12     = ff_rgb24toyv12_c;
     interleaveBytes    = interleaveBytes_c;
     deinterleaveBytes  = deinterleaveBytes_c;
+    interleaveWords    = interleaveWords_c;
+    deinterleaveWords  = deinterleaveWords_c;
+    shiftWords         = shiftWords_c;
     vu9_to_vu12        = vu9_to_vu12_c;
     yvu9_to_yuy2       = yvu9_to_yuy2_c;
 
@@ -218,6 +218,44 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Prepare the context for scaling the destination image as independent
+ * horizontal bands with sws_scale_band(), so that they can be processed
+ * by different threads at the same time.
+ *
+ * This must be called after sws_init_context(). The context must not have
+ * been initialized with SwsFilters.
+ *
+ * @param c        the initialized scaling context
+ * @param nb_bands the number of bands to split the destination image in,
+ *                 1 to disable splitting
+ * @return 0 on success, AVERROR(ENOSYS) if the conversion set up in the
+ *         context can not be split, in which case it is processed as one
+ *         band, another negative error code on failure
+ */
+int sws_init_bands(struct SwsContext *c, int nb_bands);
+
+/**
+ * Scale a horizontal band of the destination image from the whole source
+ * image. Different bands of the same context may be scaled concurrently,
+ * and together produce the same output as sws_scale() on the whole image.
+ *
+ * If the context was not split into bands with sws_init_bands(), band 0
+ * covers the whole image and the other bands are empty.
+ *
+ * @param c         the scaling context
+ * @param band      the index of the band to scale, between 0 and the
+ *                  number of bands passed to sws_init_bands() - 1
+ * @param src       the pointers to the planes of the source image
+ * @param srcStride the strides of the planes of the source image
+ * @param dst       the pointers to the planes of the destination image
+ * @param dstStride the strides of the planes of the destination image
+ * @return the number of rows written, or a negative error code
+ */
+int sws_scale_band(struct SwsContext *c, int band,
+                   const uint8_t *const src[], const int srcStride[],
+                   uint8_t *const dst[], const int dstStride[]);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
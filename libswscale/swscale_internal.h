@@ -321,6 +321,12 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* Contexts scaling the horizontal bands of the destination image set up
+     * by sws_init_bands(), band_ctx[0] is the context itself. */
+    struct SwsContext **band_ctx;
+    int nb_bands;
+    int user_filters;             ///< Set if initialized with user supplied SwsFilters.
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -858,6 +864,8 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+void ff_sws_free_bands(SwsContext *c);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
@@ -0,0 +1,142 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check that scaling the destination as separate bands with
+ * sws_scale_band() gives the same output as sws_scale().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#define SRC_W 96
+#define SRC_H 72
+#define NB_BANDS 3
+
+static const enum AVPixelFormat src_fmts[] = {
+    AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_NV12,
+    AV_PIX_FMT_RGB24, AV_PIX_FMT_BGRA, AV_PIX_FMT_GRAY8, AV_PIX_FMT_PAL8,
+};
+
+static const enum AVPixelFormat dst_fmts[] = {
+    AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV410P,
+    AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_NV12, AV_PIX_FMT_RGB24,
+    AV_PIX_FMT_BGRA, AV_PIX_FMT_GRAY16LE,
+};
+
+static const struct {
+    int w, h, flags;
+} tests[] = {
+    {  64,  50, SWS_BILINEAR },
+    { 130,  97, SWS_BICUBIC  },
+    {  96,  72, SWS_LANCZOS | SWS_ACCURATE_RND },
+    {  40, 140, SWS_FAST_BILINEAR },
+    {  96,  72, SWS_BILINEAR | SWS_ERROR_DIFFUSION },
+};
+
+static int compare(uint8_t *a[4], uint8_t *b[4], const int linesize[4],
+                   enum AVPixelFormat fmt, int w, int h)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    int i, y;
+
+    for (i = 0; i < 4 && a[i]; i++) {
+        int ph = i == 1 || i == 2 ? AV_CEIL_RSHIFT(h, desc->log2_chroma_h) : h;
+        int bytes = av_image_get_linesize(fmt, w, i);
+
+        for (y = 0; y < ph; y++)
+            if (memcmp(a[i] + y * linesize[i], b[i] + y * linesize[i], bytes))
+                return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    uint8_t *src[4], *ref[4], *out[4];
+    int src_linesize[4], dst_linesize[4];
+    AVLFG lfg;
+    int i, j, k, b, ret, failed = 0;
+
+    av_lfg_init(&lfg, 1);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(src_fmts); i++) {
+        int size = av_image_alloc(src, src_linesize, SRC_W, SRC_H, src_fmts[i], 16);
+        if (size < 0)
+            return 1;
+        for (k = 0; k < size; k++)
+            src[0][k] = av_lfg_get(&lfg);
+
+        for (j = 0; j < FF_ARRAY_ELEMS(dst_fmts); j++) {
+            for (k = 0; k < FF_ARRAY_ELEMS(tests); k++) {
+                struct SwsContext *c;
+                const char *res;
+                int w = tests[k].w, h = tests[k].h, dst_size;
+
+                c = sws_getContext(SRC_W, SRC_H, src_fmts[i], w, h, dst_fmts[j],
+                                   tests[k].flags, NULL, NULL, NULL);
+                if (!c)
+                    return 1;
+                dst_size = av_image_alloc(ref, dst_linesize, w, h, dst_fmts[j], 16);
+                if (dst_size < 0 ||
+                    av_image_alloc(out, dst_linesize, w, h, dst_fmts[j], 16) < 0)
+                    return 1;
+                memset(ref[0], 0, dst_size);
+                memset(out[0], 0, dst_size);
+
+                sws_scale(c, (const uint8_t * const *)src, src_linesize,
+                          0, SRC_H, ref, dst_linesize);
+
+                ret = sws_init_bands(c, NB_BANDS);
+                if (ret < 0 && ret != AVERROR(ENOSYS))
+                    return 1;
+
+                /* scale the bands in reverse order to check that they
+                 * do not depend on each other */
+                for (b = NB_BANDS - 1; b >= 0; b--)
+                    if (sws_scale_band(c, b, (const uint8_t * const *)src, src_linesize,
+                                       out, dst_linesize) < 0)
+                        return 1;
+
+                if (compare(ref, out, dst_linesize, dst_fmts[j], w, h)) {
+                    res = "FAIL";
+                    failed = 1;
+                } else
+                    res = ret < 0 ? "ok, not split" : "ok";
+
+                printf("%-12s -> %-12s %3dx%-3d flags 0x%05x: %s\n",
+                       av_get_pix_fmt_name(src_fmts[i]),
+                       av_get_pix_fmt_name(dst_fmts[j]), w, h, tests[k].flags, res);
+
+                av_freep(&ref[0]);
+                av_freep(&out[0]);
+                sws_freeContext(c);
+            }
+        }
+        av_freep(&src[0]);
+    }
+
+    return failed;
+}
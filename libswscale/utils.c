@@ -862,6 +862,11 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 1; i < c->nb_bands; i++)
+        sws_setColorspaceDetails(c->band_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1185,6 +1190,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
 
     cpu_flags = av_get_cpu_flags();
     flags     = c->flags;
+    c->user_filters = srcFilter || dstFilter;
     emms_c();
     if (!rgb15to16)
         ff_sws_rgb2rgb_init();
@@ -2317,6 +2323,8 @@ void sws_freeContext(SwsContext *c)
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
+    ff_sws_free_bands(c);
+
     av_freep(&c->vLumFilter);
     av_freep(&c->vChrFilter);
     av_freep(&c->hLumFilter);
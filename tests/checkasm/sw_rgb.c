@@ -111,6 +111,117 @@ static void check_uyvy_to_422p(void)
     }
 }
 
+static const int word_shifts[] = { -6, 0, 6 };
+
+static void check_interleave_words(void)
+{
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint16_t, src_u, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, src_v, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [2 * MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [2 * MAX_STRIDE * MAX_HEIGHT]);
+
+    declare_func(void, const uint16_t *src1, const uint16_t *src2, uint16_t *dst,
+                 int width, int height, int src1Stride, int src2Stride,
+                 int dstStride, int shift);
+
+    randomize_buffers((uint8_t *)src_u, MAX_STRIDE * MAX_HEIGHT * 2);
+    randomize_buffers((uint8_t *)src_v, MAX_STRIDE * MAX_HEIGHT * 2);
+
+    if (check_func(interleaveWords, "interleave_words")) {
+        for (i = 0; i < 6; i++) {
+            for (j = 0; j < FF_ARRAY_ELEMS(word_shifts); j++) {
+                memset(dst0, 0, 2 * MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst1, 0, 2 * MAX_STRIDE * MAX_HEIGHT * 2);
+
+                call_ref(src_u, src_v, dst0, planes[i].w, planes[i].h,
+                         planes[i].s * 2, planes[i].s * 2, 2 * MAX_STRIDE * 2,
+                         word_shifts[j]);
+                call_new(src_u, src_v, dst1, planes[i].w, planes[i].h,
+                         planes[i].s * 2, planes[i].s * 2, 2 * MAX_STRIDE * 2,
+                         word_shifts[j]);
+                if (memcmp(dst0, dst1, 2 * MAX_STRIDE * MAX_HEIGHT * 2))
+                    fail();
+            }
+        }
+        bench_new(src_u, src_v, dst1, planes[5].w, planes[5].h,
+                  planes[5].s * 2, planes[5].s * 2, 2 * MAX_STRIDE * 2, -6);
+    }
+}
+
+static void check_deinterleave_words(void)
+{
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint16_t, src, [2 * MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst_u_0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst_u_1, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst_v_0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst_v_1, [MAX_STRIDE * MAX_HEIGHT]);
+
+    declare_func(void, const uint16_t *src, uint16_t *dst1, uint16_t *dst2,
+                 int width, int height, int srcStride, int dst1Stride,
+                 int dst2Stride, int shift);
+
+    randomize_buffers((uint8_t *)src, 2 * MAX_STRIDE * MAX_HEIGHT * 2);
+
+    if (check_func(deinterleaveWords, "deinterleave_words")) {
+        for (i = 0; i < 6; i++) {
+            for (j = 0; j < FF_ARRAY_ELEMS(word_shifts); j++) {
+                memset(dst_u_0, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst_u_1, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst_v_0, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst_v_1, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+
+                call_ref(src, dst_u_0, dst_v_0, planes[i].w, planes[i].h,
+                         planes[i].s * 4, MAX_STRIDE * 2, MAX_STRIDE * 2,
+                         word_shifts[j]);
+                call_new(src, dst_u_1, dst_v_1, planes[i].w, planes[i].h,
+                         planes[i].s * 4, MAX_STRIDE * 2, MAX_STRIDE * 2,
+                         word_shifts[j]);
+                if (memcmp(dst_u_0, dst_u_1, MAX_STRIDE * MAX_HEIGHT * 2) ||
+                    memcmp(dst_v_0, dst_v_1, MAX_STRIDE * MAX_HEIGHT * 2))
+                    fail();
+            }
+        }
+        bench_new(src, dst_u_1, dst_v_1, planes[5].w, planes[5].h,
+                  planes[5].s * 4, MAX_STRIDE * 2, MAX_STRIDE * 2, -6);
+    }
+}
+
+static void check_shift_words(void)
+{
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint16_t, src, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [MAX_STRIDE * MAX_HEIGHT]);
+
+    declare_func(void, const uint16_t *src, uint16_t *dst, int width, int height,
+                 int srcStride, int dstStride, int shift);
+
+    randomize_buffers((uint8_t *)src, MAX_STRIDE * MAX_HEIGHT * 2);
+
+    if (check_func(shiftWords, "shift_words")) {
+        for (i = 0; i < 6; i++) {
+            for (j = 0; j < FF_ARRAY_ELEMS(word_shifts); j++) {
+                memset(dst0, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst1, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+
+                call_ref(src, dst0, planes[i].w, planes[i].h,
+                         planes[i].s * 2, MAX_STRIDE * 2, word_shifts[j]);
+                call_new(src, dst1, planes[i].w, planes[i].h,
+                         planes[i].s * 2, MAX_STRIDE * 2, word_shifts[j]);
+                if (memcmp(dst0, dst1, MAX_STRIDE * MAX_HEIGHT * 2))
+                    fail();
+            }
+        }
+        bench_new(src, dst1, planes[5].w, planes[5].h,
+                  planes[5].s * 2, MAX_STRIDE * 2, -6);
+    }
+}
+
 void checkasm_check_sw_rgb(void)
 {
     ff_sws_rgb2rgb_init();
@@ -132,4 +243,13 @@ void checkasm_check_sw_rgb(void)
 
     check_uyvy_to_422p();
     report("uyvytoyuv422");
+
+    check_interleave_words();
+    report("interleave_words");
+
+    check_deinterleave_words();
+    report("deinterleave_words");
+
+    check_shift_words();
+    report("shift_words");
 }
@@ -0,0 +1,240 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j += 4)     \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define SRC_PIXELS 512
+#define MAX_DST_W  512
+/* the SIMD scalers may write up to 15 pixels past dstW */
+#define DST_PAD    16
+#define MAX_HFILTER_SIZE 40
+#define MAX_VFILTER_SIZE 16
+
+static const int dst_widths[] = { 8, 24, 77, 131, MAX_DST_W };
+
+/* Fill a filter of the given size for each of the w output pixels, plus the
+ * padding initFilter() adds for the SIMD scalers. The coefficients of each
+ * output pixel sum up to one and have small negative lobes, like the ones
+ * generated by initFilter(); the 16-bit scalers rely on the former. */
+static void fill_filter(int16_t *filter, int32_t *filter_pos, int w,
+                        int filter_size, int src_w, int one)
+{
+    int i, j;
+
+    for (i = 0; i < w; i++) {
+        int sum = 0;
+
+        filter_pos[i] = rnd() % (src_w - filter_size + 1);
+        for (j = 0; j < filter_size - 1; j++) {
+            filter[i * filter_size + j] = (int)(rnd() % (5 * one / (4 * filter_size))) -
+                                          one / (4 * filter_size);
+            sum += filter[i * filter_size + j];
+        }
+        filter[i * filter_size + filter_size - 1] = one - sum;
+    }
+    for (; i < w + 3; i++) {
+        filter_pos[i] = filter_pos[w - 1];
+        memcpy(filter + i * filter_size, filter + (w - 1) * filter_size,
+               filter_size * sizeof(*filter));
+    }
+}
+
+static void check_hscale(void)
+{
+    static const struct {
+        int src_bpc, dst_bpc;
+        enum AVPixelFormat src_fmt;
+    } depths[] = {
+        {  8, 15, AV_PIX_FMT_YUV420P     },
+        { 16, 19, AV_PIX_FMT_YUV420P16LE },
+    };
+    static const int filter_sizes[] = { 4, 8, 12, 16, 20, MAX_HFILTER_SIZE };
+    struct SwsContext *ctx;
+    int i, j, k;
+
+    LOCAL_ALIGNED_32(uint16_t, src, [SRC_PIXELS + MAX_HFILTER_SIZE]);
+    LOCAL_ALIGNED_32(int32_t, dst0, [MAX_DST_W + DST_PAD]);
+    LOCAL_ALIGNED_32(int32_t, dst1, [MAX_DST_W + DST_PAD]);
+    LOCAL_ALIGNED_32(int16_t, filter, [(MAX_DST_W + 3) * MAX_HFILTER_SIZE]);
+    LOCAL_ALIGNED_32(int32_t, filter_pos, [MAX_DST_W + 3]);
+
+    declare_func(void, SwsContext *c, int16_t *dst, int dstW,
+                 const uint8_t *src, const int16_t *filter,
+                 const int32_t *filterPos, int filterSize);
+
+    ctx = sws_alloc_context();
+    if (!ctx || sws_init_context(ctx, NULL, NULL) < 0) {
+        fail();
+        sws_freeContext(ctx);
+        return;
+    }
+
+    randomize_buffers(src, sizeof(*src) * (SRC_PIXELS + MAX_HFILTER_SIZE));
+
+    for (i = 0; i < FF_ARRAY_ELEMS(depths); i++) {
+        for (j = 0; j < FF_ARRAY_ELEMS(filter_sizes); j++) {
+            int filter_size = filter_sizes[j];
+
+            ctx->srcFormat      = depths[i].src_fmt;
+            ctx->srcBpc         = depths[i].src_bpc;
+            ctx->dstBpc         = depths[i].dst_bpc;
+            ctx->hLumFilterSize = ctx->hChrFilterSize = filter_size;
+            ff_getSwsFunc(ctx);
+
+            if (check_func(ctx->hyScale, "hscale_%d_to_%d_%d",
+                           depths[i].src_bpc, depths[i].dst_bpc, filter_size)) {
+                for (k = 0; k < FF_ARRAY_ELEMS(dst_widths); k++) {
+                    int w = dst_widths[k];
+
+                    fill_filter(filter, filter_pos, w, filter_size,
+                                SRC_PIXELS, 1 << 14);
+                    memset(dst0, 0, sizeof(*dst0) * (MAX_DST_W + DST_PAD));
+                    memset(dst1, 0, sizeof(*dst1) * (MAX_DST_W + DST_PAD));
+
+                    call_ref(ctx, (int16_t *)dst0, w, (const uint8_t *)src,
+                             filter, filter_pos, filter_size);
+                    call_new(ctx, (int16_t *)dst1, w, (const uint8_t *)src,
+                             filter, filter_pos, filter_size);
+                    if (memcmp(dst0, dst1, w * (depths[i].dst_bpc > 15 ? 4 : 2)))
+                        fail();
+                }
+                bench_new(ctx, (int16_t *)dst1, MAX_DST_W, (const uint8_t *)src,
+                          filter, filter_pos, filter_size);
+            }
+        }
+    }
+
+    sws_freeContext(ctx);
+}
+
+static void check_yuv2planeX(void)
+{
+    static const struct {
+        int bits;
+        enum AVPixelFormat fmt;
+    } depths[] = {
+        {  8, AV_PIX_FMT_YUV420P     },
+        {  9, AV_PIX_FMT_YUV420P9LE  },
+        { 10, AV_PIX_FMT_YUV420P10LE },
+        { 16, AV_PIX_FMT_YUV420P16LE },
+    };
+    static const int filter_sizes[] = { 2, 4, 8, MAX_VFILTER_SIZE };
+    static const int offsets[] = { 0, 3 };
+    struct SwsContext *ctx;
+    const int16_t *src[MAX_VFILTER_SIZE];
+    int i, j, k, l;
+
+    LOCAL_ALIGNED_32(int32_t, src_lines, [MAX_VFILTER_SIZE * (MAX_DST_W + DST_PAD)]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [MAX_DST_W + DST_PAD]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [MAX_DST_W + DST_PAD]);
+    LOCAL_ALIGNED_16(int16_t, filter, [MAX_VFILTER_SIZE]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    ctx = sws_alloc_context();
+    if (!ctx || sws_init_context(ctx, NULL, NULL) < 0) {
+        fail();
+        sws_freeContext(ctx);
+        return;
+    }
+
+    for (i = 0; i < MAX_VFILTER_SIZE; i++)
+        src[i] = (const int16_t *)(src_lines + i * (MAX_DST_W + DST_PAD));
+    randomize_buffers(dither, 8);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(depths); i++) {
+        int bits = depths[i].bits;
+
+        /* the intermediate lines are 15 bits in int16_t, or 19 bits in
+         * int32_t for 16-bit output */
+        for (j = 0; j < MAX_VFILTER_SIZE; j++) {
+            for (k = 0; k < MAX_DST_W + DST_PAD; k++) {
+                if (bits == 16)
+                    ((int32_t *)src[j])[k] = rnd() & 0x7ffff;
+                else
+                    ((int16_t *)src[j])[k] = rnd() & 0x7fff;
+            }
+        }
+
+        ctx->dstFormat = depths[i].fmt;
+        ctx->dstBpc    = bits;
+        ctx->flags    |= SWS_ACCURATE_RND;
+        ff_getSwsFunc(ctx);
+
+        if (check_func(ctx->yuv2planeX, "yuv2planeX_%d", bits)) {
+            for (j = 0; j < FF_ARRAY_ELEMS(filter_sizes); j++) {
+                int filter_size = filter_sizes[j], sum = 0;
+
+                for (k = 0; k < filter_size - 1; k++) {
+                    filter[k] = (int)(rnd() % (5 * 4096 / (4 * filter_size))) -
+                                4096 / (4 * filter_size);
+                    sum += filter[k];
+                }
+                filter[filter_size - 1] = 4096 - sum;
+
+                for (k = 0; k < FF_ARRAY_ELEMS(dst_widths); k++) {
+                    for (l = 0; l < FF_ARRAY_ELEMS(offsets); l++) {
+                        int w = dst_widths[k];
+
+                        memset(dst0, 0, sizeof(*dst0) * (MAX_DST_W + DST_PAD));
+                        memset(dst1, 0, sizeof(*dst1) * (MAX_DST_W + DST_PAD));
+
+                        call_ref(filter, filter_size, src, (uint8_t *)dst0, w,
+                                 dither, offsets[l]);
+                        call_new(filter, filter_size, src, (uint8_t *)dst1, w,
+                                 dither, offsets[l]);
+                        if (memcmp(dst0, dst1, w * (bits > 8 ? 2 : 1)))
+                            fail();
+                    }
+                }
+            }
+            bench_new(filter, MAX_VFILTER_SIZE, src, (uint8_t *)dst1, MAX_DST_W,
+                      dither, 0);
+        }
+    }
+
+    sws_freeContext(ctx);
+}
+
+void checkasm_check_sw_scale(void)
+{
+    check_hscale();
+    report("hscale");
+
+    check_yuv2planeX();
+    report("yuv2planeX");
+}
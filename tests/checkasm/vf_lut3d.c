@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/lut3d.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define WIDTH 251
+#define WIDTH_PADDED 256
+#define LUT_SIZE 33
+
+static float rnd_float(float max)
+{
+    return (rnd() & 0xFFFFFF) * max / 0xFFFFFF;
+}
+
+static void check_interp(const LUT3DDSPContext *dsp, const struct rgbvec *lut)
+{
+    static const char *const names[NB_INTERP_MODE] = {
+        "nearest", "trilinear", "tetrahedral"
+    };
+    LOCAL_ALIGNED_32(float, src,     [3 * WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(float, buf_ref, [3 * WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(float, buf_new, [3 * WIDTH_PADDED]);
+    const ptrdiff_t stride = WIDTH_PADDED * sizeof(float);
+    int i, mode;
+
+    declare_func(void, float *buf, ptrdiff_t stride, int w,
+                 const struct rgbvec *lut, int lutsize);
+
+    memset(src, 0, 3 * WIDTH_PADDED * sizeof(*src));
+    for (i = 0; i < WIDTH; i++) {
+        src[i]                    = rnd_float(LUT_SIZE - 1);
+        src[WIDTH_PADDED + i]     = rnd_float(LUT_SIZE - 1);
+        src[2 * WIDTH_PADDED + i] = rnd_float(LUT_SIZE - 1);
+    }
+    for (i = 0; i < WIDTH; i += 4) {
+        // ties between the fractional parts, and points on the levels
+        // including the last one
+        switch (i / 4 % 6) {
+        case 0: src[WIDTH_PADDED + i]     = src[i];                         break;
+        case 1: src[2 * WIDTH_PADDED + i] = src[WIDTH_PADDED + i];          break;
+        case 2: src[2 * WIDTH_PADDED + i] = src[WIDTH_PADDED + i] = src[i]; break;
+        case 3: src[i]                    = (int)src[i];                    break;
+        case 4: src[WIDTH_PADDED + i]     = LUT_SIZE - 1;                   break;
+        }
+    }
+
+    for (mode = 0; mode < NB_INTERP_MODE; mode++) {
+        if (check_func(dsp->interp[mode], "lut3d_interp_%s", names[mode])) {
+            memcpy(buf_ref, src, 3 * WIDTH_PADDED * sizeof(*src));
+            memcpy(buf_new, src, 3 * WIDTH_PADDED * sizeof(*src));
+            call_ref(buf_ref, stride, WIDTH, lut, LUT_SIZE);
+            call_new(buf_new, stride, WIDTH, lut, LUT_SIZE);
+            for (i = 0; i < 3; i++) {
+                if (!float_near_ulp_array(buf_ref + i * WIDTH_PADDED,
+                                          buf_new + i * WIDTH_PADDED, 0, WIDTH))
+                    fail();
+            }
+            // the interpolated colors are valid coordinates again
+            bench_new(buf_new, stride, WIDTH, lut, LUT_SIZE);
+        }
+    }
+}
+
+void checkasm_check_vf_lut3d(void)
+{
+    LUT3DDSPContext dsp;
+    struct rgbvec *lut = av_mallocz(MAX_LEVEL * MAX_LEVEL * MAX_LEVEL * sizeof(*lut));
+    int i, j, k;
+
+    if (!lut)
+        return;
+
+    for (i = 0; i < LUT_SIZE; i++) {
+        for (j = 0; j < LUT_SIZE; j++) {
+            for (k = 0; k < LUT_SIZE; k++) {
+                struct rgbvec *vec = &lut[(i * MAX_LEVEL + j) * MAX_LEVEL + k];
+                vec->r = rnd_float(1.f);
+                vec->g = rnd_float(1.f);
+                vec->b = rnd_float(1.f);
+            }
+        }
+    }
+
+    ff_lut3d_dsp_init(&dsp);
+    check_interp(&dsp, lut);
+    report("interp");
+
+    av_free(lut);
+}
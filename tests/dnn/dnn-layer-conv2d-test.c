@@ -0,0 +1,279 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Compare the conv2d layer against a straightforward convolution, single
+ * and multithreaded. Run with -b [threads] to benchmark both on the layers
+ * of a 2x super resolution network at a fixed resolution instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/common.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavfilter/dnn/dnn_backend_native_layer_conv2d.h"
+
+#define EPSON 0.0001
+
+#define BENCH_WIDTH  640
+#define BENCH_HEIGHT 360
+
+#define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
+
+static void convolve_ref(const float *input, float *output, const ConvolutionalParams *conv_params, int width, int height)
+{
+    int radius = conv_params->kernel_size >> 1;
+    int src_linesize = width * conv_params->input_num;
+    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
+    int filter_size = conv_params->kernel_size * filter_linesize;
+    int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
+
+    for (int y = pad_size; y < height - pad_size; ++y) {
+        for (int x = pad_size; x < width - pad_size; ++x) {
+            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
+                output[n_filter] = conv_params->biases[n_filter];
+
+                for (int ch = 0; ch < conv_params->input_num; ++ch) {
+                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
+                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
+                            float input_pel;
+                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
+                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
+                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
+                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
+                            } else {
+                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
+                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
+                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
+                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
+                            }
+
+                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
+                                                                                kernel_x * conv_params->input_num + ch];
+                        }
+                    }
+                }
+                switch (conv_params->activation){
+                case RELU:
+                    output[n_filter] = FFMAX(output[n_filter], 0.0);
+                    break;
+                case TANH:
+                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
+                    break;
+                case SIGMOID:
+                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
+                    break;
+                case NONE:
+                    break;
+                case LEAKY_RELU:
+                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+                }
+            }
+            output += conv_params->output_num;
+        }
+    }
+}
+
+static float *alloc_random(AVLFG *lfg, int size)
+{
+    float *data = av_malloc_array(size, sizeof(*data));
+
+    if (data) {
+        for (int i = 0; i < size; i++)
+            data[i] = av_lfg_get(lfg) / (float)UINT32_MAX - 0.5f;
+    }
+    return data;
+}
+
+static int init_params(ConvolutionalParams *params, AVLFG *lfg, int input_num, int output_num,
+                       int kernel_size, int dilation, DNNConvPaddingParam padding_method,
+                       DNNActivationFunc activation)
+{
+    memset(params, 0, sizeof(*params));
+    params->input_num      = input_num;
+    params->output_num     = output_num;
+    params->kernel_size    = kernel_size;
+    params->dilation       = dilation;
+    params->padding_method = padding_method;
+    params->activation     = activation;
+    params->kernel = alloc_random(lfg, input_num * output_num * kernel_size * kernel_size);
+    params->biases = alloc_random(lfg, output_num);
+    if (!params->kernel || !params->biases)
+        return -1;
+    return dnn_pack_conv2d_kernel(params);
+}
+
+static void uninit_params(ConvolutionalParams *params)
+{
+    av_freep(&params->kernel);
+    av_freep(&params->biases);
+    av_freep(&params->packed_kernel);
+}
+
+static void out_size(const ConvolutionalParams *params, int *width, int *height)
+{
+    if (params->padding_method == VALID) {
+        *width  -= (params->kernel_size - 1) * params->dilation;
+        *height -= (params->kernel_size - 1) * params->dilation;
+    }
+}
+
+static int test_conv2d(AVLFG *lfg, DNNConv2DContext *single, DNNConv2DContext *threaded,
+                       int width, int height, int input_num, int output_num, int kernel_size,
+                       int dilation, DNNConvPaddingParam padding_method, DNNActivationFunc activation)
+{
+    ConvolutionalParams params;
+    float *input, *ref, *out, *out_threaded;
+    int out_width = width, out_height = height, size, i, ret = 1;
+
+    if (init_params(&params, lfg, input_num, output_num, kernel_size,
+                    dilation, padding_method, activation) < 0) {
+        uninit_params(&params);
+        return 1;
+    }
+    out_size(&params, &out_width, &out_height);
+    size = out_width * out_height * output_num;
+
+    input        = alloc_random(lfg, width * height * input_num);
+    ref          = av_malloc_array(size, sizeof(*ref));
+    out          = av_malloc_array(size, sizeof(*out));
+    out_threaded = av_malloc_array(size, sizeof(*out_threaded));
+    if (!input || !ref || !out || !out_threaded)
+        goto end;
+
+    convolve_ref(input, ref, &params, width, height);
+    if (dnn_execute_layer_conv2d(single, input, out, &params, width, height) < 0 ||
+        dnn_execute_layer_conv2d(threaded, input, out_threaded, &params, width, height) < 0)
+        goto end;
+
+    for (i = 0; i < size; i++) {
+        if (fabs(out[i] - ref[i]) > EPSON * FFMAX(1.0, fabs(ref[i]))) {
+            printf("%dx%d %d->%d kernel %d dilation %d padding %d activation %d: "
+                   "at index %d, output: %f, expected_output: %f\n",
+                   width, height, input_num, output_num, kernel_size, dilation,
+                   padding_method, activation, i, out[i], ref[i]);
+            goto end;
+        }
+    }
+    if (memcmp(out, out_threaded, size * sizeof(*out))) {
+        printf("%dx%d %d->%d kernel %d dilation %d padding %d activation %d: "
+               "threaded output differs\n", width, height, input_num, output_num,
+               kernel_size, dilation, padding_method, activation);
+        goto end;
+    }
+    ret = 0;
+
+end:
+    uninit_params(&params);
+    av_freep(&input);
+    av_freep(&ref);
+    av_freep(&out);
+    av_freep(&out_threaded);
+    return ret;
+}
+
+static int bench_conv2d(AVLFG *lfg, DNNConv2DContext *s, int input_num, int output_num,
+                        int kernel_size, DNNActivationFunc activation)
+{
+    ConvolutionalParams params;
+    float *input, *output;
+    int64_t t0, t1, t2;
+    int ret = 1;
+
+    if (init_params(&params, lfg, input_num, output_num, kernel_size,
+                    1, SAME_CLAMP_TO_EDGE, activation) < 0) {
+        uninit_params(&params);
+        return 1;
+    }
+    input  = alloc_random(lfg, BENCH_WIDTH * BENCH_HEIGHT * input_num);
+    output = av_malloc_array(BENCH_WIDTH * BENCH_HEIGHT * output_num, sizeof(*output));
+    if (!input || !output)
+        goto end;
+
+    t0 = av_gettime_relative();
+    convolve_ref(input, output, &params, BENCH_WIDTH, BENCH_HEIGHT);
+    t1 = av_gettime_relative();
+    if (dnn_execute_layer_conv2d(s, input, output, &params, BENCH_WIDTH, BENCH_HEIGHT) < 0)
+        goto end;
+    t2 = av_gettime_relative();
+
+    printf("%dx%d conv %dx%d %3d->%3d: reference %8.2f ms, conv2d %8.2f ms\n",
+           BENCH_WIDTH, BENCH_HEIGHT, kernel_size, kernel_size, input_num, output_num,
+           (t1 - t0) / 1000.0, (t2 - t1) / 1000.0);
+    ret = 0;
+
+end:
+    uninit_params(&params);
+    av_freep(&input);
+    av_freep(&output);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        int width, height, input_num, output_num, kernel_size, dilation;
+        DNNConvPaddingParam padding_method;
+        DNNActivationFunc activation;
+    } tests[] = {
+        {  9,  7,  1,  1, 1, 1, VALID,              NONE       },
+        { 13, 11,  3, 16, 3, 1, VALID,              RELU       },
+        { 37,  5,  1, 64, 5, 1, SAME,               TANH       },
+        { 40, 33, 64, 32, 3, 1, SAME_CLAMP_TO_EDGE, TANH       },
+        { 35, 21, 32,  4, 3, 1, SAME_CLAMP_TO_EDGE, SIGMOID    },
+        { 17, 19,  5, 20, 3, 2, SAME,               LEAKY_RELU },
+        { 23, 23,  6,  7, 5, 2, VALID,              NONE       },
+        { 33,  9, 16, 17, 2, 1, SAME_CLAMP_TO_EDGE, RELU       },
+    };
+    DNNConv2DContext *single, *threaded;
+    AVLFG lfg;
+    int i, ret = 0;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        DNNConv2DContext *s = dnn_conv2d_alloc(argc > 2 ? atoi(argv[2]) : 0);
+        if (!s)
+            return 1;
+        // layers of ESPCN for 2x upscaling of one plane
+        ret = bench_conv2d(&lfg, s,  1, 64, 5, TANH) ||
+              bench_conv2d(&lfg, s, 64, 32, 3, TANH) ||
+              bench_conv2d(&lfg, s, 32,  4, 3, SIGMOID);
+        dnn_conv2d_free(&s);
+        return ret;
+    }
+
+    single   = dnn_conv2d_alloc(1);
+    threaded = dnn_conv2d_alloc(3);
+    if (!single || !threaded)
+        ret = 1;
+
+    for (i = 0; !ret && i < FF_ARRAY_ELEMS(tests); i++)
+        ret = test_conv2d(&lfg, single, threaded, tests[i].width, tests[i].height,
+                          tests[i].input_num, tests[i].output_num, tests[i].kernel_size,
+                          tests[i].dilation, tests[i].padding_method, tests[i].activation);
+
+    dnn_conv2d_free(&single);
+    dnn_conv2d_free(&threaded);
+    return ret;
+}
@@ -0,0 +1,206 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/common.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/mem.h"
+#include "libavfilter/dnn/dnn_backend_native.h"
+
+#define WIDTH      17
+#define HEIGHT     11
+#define NB_FRAMES  23
+#define KERNEL     3
+#define FILTERS    4
+
+// Writes a model like the sr one: a 3x3 convolution to 4 channels, followed
+// by a depth to space layer which makes the output twice as large.
+static int write_model(const char *filename)
+{
+    AVIOContext *pb;
+    int i;
+
+    if (avio_open(&pb, filename, AVIO_FLAG_WRITE) < 0)
+        return -1;
+
+    avio_wl32(pb, 2);
+    avio_wl32(pb, CONV);
+    avio_wl32(pb, 1);               // dilation
+    avio_wl32(pb, SAME_CLAMP_TO_EDGE);
+    avio_wl32(pb, TANH);
+    avio_wl32(pb, 1);               // input_num
+    avio_wl32(pb, FILTERS);
+    avio_wl32(pb, KERNEL);
+    for (i = 0; i < FILTERS * KERNEL * KERNEL; i++)
+        avio_wl32(pb, av_float2int((i % 7 - 3) * 0.125f));
+    for (i = 0; i < FILTERS; i++)
+        avio_wl32(pb, av_float2int(i * 0.0625f - 0.1f));
+    avio_wl32(pb, DEPTH_TO_SPACE);
+    avio_wl32(pb, 2);
+
+    return avio_closep(&pb);
+}
+
+static void fill_input(float *data, int frame)
+{
+    int i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++)
+        data[i] = ((i * 13 + frame * 29) % 256) / 255.0f;
+}
+
+static int check_output(const DNNData *output, const float *expected, int frame)
+{
+    if (output->width != 2 * WIDTH || output->height != 2 * HEIGHT || output->channels != 1) {
+        printf("frame %d: output of %dx%dx%d\n", frame, output->width, output->height, output->channels);
+        return 1;
+    }
+    if (memcmp(output->data, expected, 4 * WIDTH * HEIGHT * sizeof(float))) {
+        printf("frame %d: output differs from the synchronous execution\n", frame);
+        return 1;
+    }
+    return 0;
+}
+
+// Gets the next output, which must be the one of the frame next_frame.
+static int get_result(DNNModel *model, float **expected, int *next_frame, int wait)
+{
+    DNNAsyncStatusType status;
+    DNNData output;
+    void *opaque;
+
+    status = ff_dnn_get_async_result_native(model, &output, &opaque, wait);
+    if (status == DAST_NOT_READY && !wait)
+        return 0;
+    if (status != DAST_SUCCESS) {
+        printf("frame %d: async status %d\n", *next_frame, status);
+        return -1;
+    }
+    if (opaque != &expected[*next_frame]) {
+        printf("frame %d: got the output of another frame\n", *next_frame);
+        return -1;
+    }
+    if (check_output(&output, expected[*next_frame], *next_frame))
+        return -1;
+    (*next_frame)++;
+    return 1;
+}
+
+static int test_async(DNNModel *model, DNNInputData *input, float **expected)
+{
+    static const int batch_sizes[] = { 1, 3, 1, 5, 2, 4, 7 };
+    DNNData output;
+    void *opaque;
+    int next_frame = 0, frame = 0, i, j, ret;
+
+    // batches of different sizes, each one queued while the previous one
+    // may still be running
+    for (i = 0; frame < NB_FRAMES; i++) {
+        int nb = FFMIN(batch_sizes[i % FF_ARRAY_ELEMS(batch_sizes)], NB_FRAMES - frame);
+
+        for (j = 0; j < nb; j++, frame++) {
+            fill_input(input->data, frame);
+            if (ff_dnn_execute_model_async_native(model, &expected[frame]) != DNN_SUCCESS) {
+                printf("frame %d: queuing failed\n", frame);
+                return 1;
+            }
+        }
+        // nothing is executed before the flush
+        if (next_frame == frame - nb &&
+            ff_dnn_get_async_result_native(model, &output, &opaque, 0) != DAST_NOT_READY) {
+            printf("frame %d: executed before being flushed\n", next_frame);
+            return 1;
+        }
+        if (ff_dnn_flush_native(model) != DNN_SUCCESS)
+            return 1;
+        do {
+            ret = get_result(model, expected, &next_frame, 0);
+        } while (ret > 0);
+        if (ret < 0)
+            return 1;
+        while (frame - next_frame > nb)
+            if (get_result(model, expected, &next_frame, 1) < 0)
+                return 1;
+    }
+
+    // the last frames are queued without being flushed, waiting runs them
+    fill_input(input->data, 0);
+    if (ff_dnn_execute_model_async_native(model, &expected[0]) != DNN_SUCCESS)
+        return 1;
+    while (next_frame < NB_FRAMES)
+        if (get_result(model, expected, &next_frame, 1) < 0)
+            return 1;
+    next_frame = 0;
+    if (get_result(model, expected, &next_frame, 1) < 0)
+        return 1;
+
+    if (ff_dnn_get_async_result_native(model, &output, &opaque, 1) != DAST_EMPTY_QUEUE) {
+        printf("outputs left after the last frame\n");
+        return 1;
+    }
+    printf("async: %d frames\n", NB_FRAMES);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    DNNModel *model = NULL;
+    DNNInputData input = { 0 };
+    DNNData output;
+    const char *output_name = "y";
+    float *expected[NB_FRAMES] = { NULL };
+    int i, ret = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <temporary file>\n", argv[0]);
+        return 1;
+    }
+
+    if (write_model(argv[1]) < 0 || !(model = ff_dnn_load_model_native(argv[1]))) {
+        printf("could not create the model\n");
+        goto end;
+    }
+
+    input.dt       = DNN_FLOAT;
+    input.width    = WIDTH;
+    input.height   = HEIGHT;
+    input.channels = 1;
+    if (model->set_input_output(model->model, &input, "x", &output_name, 1) != DNN_SUCCESS)
+        goto end;
+
+    // the expected outputs are those of the synchronous execution
+    for (i = 0; i < NB_FRAMES; i++) {
+        fill_input(input.data, i);
+        if (ff_dnn_execute_model_native(model, &output, 1) != DNN_SUCCESS)
+            goto end;
+        expected[i] = av_memdup(output.data, 4 * WIDTH * HEIGHT * sizeof(float));
+        if (!expected[i])
+            goto end;
+    }
+
+    ret = test_async(model, &input, expected);
+
+end:
+    for (i = 0; i < NB_FRAMES; i++)
+        av_free(expected[i]);
+    ff_dnn_free_model_native(&model);
+    avpriv_io_delete(argv[1]);
+    return ret;
+}
@@ -135,6 +135,19 @@ framecrc(){
     ffmpeg "$@" -bitexact -f framecrc -
 }
 
+benchmark_json(){
+    ffmpeg "$@" -benchmark_json pipe:1 -f null - | sed 's/": [0-9][0-9]*/": N/g'
+}
+
+input_queue_stats(){
+    ffmpeg "$@" -progress pipe:1 -f null - | grep "^input_" | tail -n 4 | sed 's/=[0-9]*/=N/'
+}
+
+exit_status(){
+    "$@"
+    echo "exit status: $?"
+}
+
 ffmetadata(){
     ffmpeg "$@" -bitexact -f ffmetadata -
 }
@@ -38,6 +38,32 @@ FATE_SAMPLES_FFMPEG-$(CONFIG_COLORKEY_FILTER) += fate-ffmpeg-filter_colorkey
 fate-ffmpeg-filter_colorkey: tests/data/filtergraphs/colorkey
 fate-ffmpeg-filter_colorkey: CMD = framecrc -idct simple -fflags +bitexact -flags +bitexact  -sws_flags +accurate_rnd+bitexact -i $(TARGET_SAMPLES)/cavs/cavs.mpg -fflags +bitexact -flags +bitexact -sws_flags +accurate_rnd+bitexact -i $(TARGET_SAMPLES)/lena.pnm -an -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/colorkey -sws_flags +accurate_rnd+bitexact -fflags +bitexact -flags +bitexact -qscale 2 -frames:v 10
 
+FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-output_threads
+fate-ffmpeg-output_threads: CMD = framecrc -filter_complex color=d=1:r=5 -output_threads -thread_queue_size 2 -fflags +bitexact
+
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER SPLIT_FILTER SINE_FILTER PCM_S16LE_ENCODER RAWVIDEO_ENCODER) += fate-ffmpeg-output_threads_streams
+fate-ffmpeg-output_threads_streams: CMD = framecrc -filter_complex "testsrc=d=1:r=5,split[v0][v1];sine=d=1[a]" -map "[v0]" -map "[v1]" -map "[a]" -output_threads -thread_queue_size 2 -c:v rawvideo -c:a pcm_s16le -fflags +bitexact
+
+# the encoding thread fails on the non monotonous timestamps with -xerror
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER SETPTS_FILTER RAWVIDEO_ENCODER) += fate-ffmpeg-output_threads_error
+fate-ffmpeg-output_threads_error: CMD = exit_status framecrc -filter_complex "testsrc=d=1:r=5,setpts=if(eq(N\,3)\,0\,N)" -vsync passthrough -output_threads -xerror -c:v rawvideo -fflags +bitexact
+
+# only the keys are checked, the values are replaced
+FATE_FFMPEG-$(call ALLYES, LAVFI_INDEV COLOR_FILTER HFLIP_FILTER) += fate-ffmpeg-benchmark_json
+fate-ffmpeg-benchmark_json: CMD = benchmark_json -f lavfi -i color=d=1:r=5 -vf hflip -output_threads
+
+FATE_FFMPEG-$(call ALLYES, LAVFI_INDEV COLOR_FILTER) += fate-ffmpeg-input_queue_stats
+fate-ffmpeg-input_queue_stats: CMD = input_queue_stats -f lavfi -i color=d=1:r=5 -f lavfi -i color=d=1:r=5
+
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER HSTACK_FILTER) += fate-ffmpeg-filter_graph_threads
+fate-ffmpeg-filter_graph_threads: CMD = framecrc -filter_complex "testsrc=d=1:r=5,split[a][b];[a]hflip[a1];[b]vflip[b1];[a1][b1]hstack" -filter_graph_threads 4 -fflags +bitexact
+
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER HSTACK_FILTER) += fate-ffmpeg-shared_threads
+fate-ffmpeg-shared_threads: CMD = framecrc -shared_threads 2 -filter_complex_threads 3 -filter_complex "testsrc=d=1:r=5,split[a][b];[a]hflip[a1];[b]vflip[b1];[a1][b1]hstack" -filter_graph_threads 2 -fflags +bitexact
+
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER FORMAT_FILTER MJPEG_ENCODER) += fate-ffmpeg-dup_packets
+fate-ffmpeg-dup_packets: CMD = framecrc -filter_complex "testsrc=s=64x64:d=1:r=5,format=yuvj420p" -vsync cfr -r 12 -dup_packets -c:v mjpeg -q:v 3 -fflags +bitexact -flags +bitexact
+
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
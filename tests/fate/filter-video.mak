@@ -122,6 +122,10 @@ FATE_FILTER-$(call ALLYES, FRAMERATE_FILTER TESTSRC2_FILTER FORMAT_FILTER) += fa
 fate-filter-framerate-12bit-up: CMD = framecrc -lavfi testsrc2=r=50:d=1,format=pix_fmts=yuv422p12le,framerate=fps=60 -t 1 -pix_fmt yuv422p12le
 fate-filter-framerate-12bit-down: CMD = framecrc -lavfi testsrc2=r=60:d=1,format=pix_fmts=yuv422p12le,framerate=fps=50 -t 1 -pix_fmt yuv422p12le
 
+FATE_FILTER-$(call ALLYES, MINTERPOLATE_FILTER TESTSRC2_FILTER) += fate-filter-minterpolate-bidir fate-filter-minterpolate-aobmc
+fate-filter-minterpolate-bidir: CMD = framecrc -filter_threads 4 -lavfi testsrc2=s=170x98:r=5:d=1,minterpolate=fps=10:me_mode=bidir -t 1
+fate-filter-minterpolate-aobmc: CMD = framecrc -filter_threads 4 -lavfi testsrc2=s=170x98:r=5:d=1,minterpolate=fps=10:me=umh:mc_mode=aobmc:vsbmc=1 -t 1
+
 FATE_FILTER_VSYNTH-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -14,6 +14,18 @@ FATE_LIBAVFORMAT-$(CONFIG_SRTP) += fate-srtp
 fate-srtp: libavformat/tests/srtp$(EXESUF)
 fate-srtp: CMD = run libavformat/tests/srtp$(EXESUF)
 
+FATE_LIBAVFORMAT-$(CONFIG_FILE_PROTOCOL) += fate-file-uring
+fate-file-uring: libavformat/tests/file_uring$(EXESUF)
+fate-file-uring: CMD = run libavformat/tests/file_uring$(EXESUF) $(TARGET_PATH)/tests/data/fate/file_uring.bin
+
+FATE_LIBAVFORMAT-$(HAVE_THREADS) += fate-prefetch
+fate-prefetch: libavformat/tests/prefetch$(EXESUF)
+fate-prefetch: CMD = run libavformat/tests/prefetch$(EXESUF) $(TARGET_PATH)/tests/data/fate/prefetch.bin
+
+FATE_LIBAVFORMAT-yes += fate-streamindex
+fate-streamindex: libavformat/tests/streamindex$(EXESUF)
+fate-streamindex: CMD = run libavformat/tests/streamindex$(EXESUF)
+
 FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
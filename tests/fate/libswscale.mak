@@ -1,3 +1,7 @@
+FATE_LIBSWSCALE += fate-sws-bands
+fate-sws-bands: libswscale/tests/bands$(EXESUF)
+fate-sws-bands: CMD = run libswscale/tests/bands$(EXESUF)
+
 FATE_LIBSWSCALE += fate-sws-pixdesc-query
 fate-sws-pixdesc-query: libswscale/tests/pixdesc_query$(EXESUF)
 fate-sws-pixdesc-query: CMD = run libswscale/tests/pixdesc_query$(EXESUF)
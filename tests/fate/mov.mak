@@ -30,13 +30,26 @@ FATE_MOV_FFPROBE = fate-mov-neg-firstpts-discard \
                    fate-mov-guess-delay-3 \
                    fate-mov-mp4-with-mov-in24-ver \
 
+# The same tests, with the index resolved on demand from the sample tables.
+FATE_MOV_LAZY_INDEX = fate-mov-1elist-noctts-lazy_index \
+                      fate-mov-1elist-1ctts-lazy_index \
+                      fate-mov-3elist-lazy_index \
+                      fate-mov-440hz-10ms-lazy_index \
+                      fate-mov-frag-overlap-lazy_index \
+                      fate-mov-stream-shorter-than-movie-lazy_index \
+
+FATE_MOV_FFPROBE_LAZY_INDEX = fate-mov-aac-2048-priming-lazy_index \
+                              fate-mov-zombie-lazy_index \
+                              fate-mov-init-nonkeyframe-lazy_index \
+
 FATE_MOV_FASTSTART = fate-mov-faststart-4gb-overflow \
 
-FATE_SAMPLES_AVCONV += $(FATE_MOV)
-FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE)
+FATE_SAMPLES_AVCONV += $(FATE_MOV) $(FATE_MOV_LAZY_INDEX)
+FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE) $(FATE_MOV_FFPROBE_LAZY_INDEX)
 FATE_SAMPLES_FASTSTART += $(FATE_MOV_FASTSTART)
 
 fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART)
+fate-mov-lazy_index: $(FATE_MOV_LAZY_INDEX) $(FATE_MOV_FFPROBE_LAZY_INDEX)
 
 # Make sure we handle edit lists correctly in normal cases.
 fate-mov-1elist-noctts: CMD = framemd5 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
@@ -124,3 +137,15 @@ fate-mov-faststart-4gb-overflow: CMP = oneline
 fate-mov-faststart-4gb-overflow: REF = bc875921f151871e787c4b4023269b29
 
 fate-mov-mp4-with-mov-in24-ver: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -show_entries stream=codec_name -select_streams 1 $(TARGET_SAMPLES)/mov/mp4-with-mov-in24-ver.mp4
+
+
+fate-mov-1elist-noctts-lazy_index: CMD = framemd5 -lazy_index 1 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
+fate-mov-1elist-1ctts-lazy_index: CMD = framemd5 -lazy_index 1 -i $(TARGET_SAMPLES)/mov/mov-1elist-1ctts.mov
+fate-mov-3elist-lazy_index: CMD = framemd5 -lazy_index 1 -i $(TARGET_SAMPLES)/mov/mov-3elist.mov
+fate-mov-440hz-10ms-lazy_index: CMD = framemd5 -lazy_index 1 -i $(TARGET_SAMPLES)/mov/440hz-10ms.m4a
+fate-mov-frag-overlap-lazy_index: CMD = framemd5 -lazy_index 1 -i $(TARGET_SAMPLES)/mov/frag_overlap.mp4
+fate-mov-stream-shorter-than-movie-lazy_index: CMD = framemd5 -flags +bitexact -lazy_index 1 -i $(TARGET_SAMPLES)/mov/mov_stream_shorter_than_movie.mov -vf fps=fps=24 -an
+fate-mov-aac-2048-priming-lazy_index: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -lazy_index 1 -show_packets -print_format compact $(TARGET_SAMPLES)/mov/aac-2048-priming.mov
+fate-mov-zombie-lazy_index: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -lazy_index 1 -show_streams -show_packets -show_frames -bitexact -print_format compact $(TARGET_SAMPLES)/mov/white_zombie_scrunch-part.mov
+fate-mov-init-nonkeyframe-lazy_index: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -lazy_index 1 -show_packets -print_format compact -select_streams v $(TARGET_SAMPLES)/mov/mp4-init-nonkeyframe.mp4
+$(FATE_MOV_LAZY_INDEX) $(FATE_MOV_FFPROBE_LAZY_INDEX): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-lazy_index=%)
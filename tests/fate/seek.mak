@@ -245,6 +245,38 @@ fate-seek-lavf-y4m:      SRC = lavf/lavf.y4m
 
 FATE_SEEK += $(FATE_SEEK_LAVF-yes:%=fate-seek-lavf-%)
 
+# the same seeks, with the mov index resolved on demand from the sample tables
+
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC,  ALAC,                MOV)         += acodec-alac
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC,  PCM_S16BE,           MOV)         += acodec-pcm-s16be
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC,  PCM_S8,              MOV)         += acodec-pcm-s8
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC2, MPEG4,      PCM_ALAW,  MOV)       += lavf-mov
+
+fate-seek-acodec-alac-lazy_index:      SRC = fate/acodec-alac.mov
+fate-seek-acodec-pcm-s16be-lazy_index: SRC = fate/acodec-pcm-s16be.mov
+fate-seek-acodec-pcm-s8-lazy_index:    SRC = fate/acodec-pcm-s8.mov
+fate-seek-lavf-mov-lazy_index:         SRC = lavf/lavf.mov
+
+FATE_SEEK_LAZY_INDEX = $(FATE_SEEK_LAZY_INDEX-yes:%=fate-seek-%-lazy_index)
+
+$(FATE_SEEK_LAZY_INDEX): fate-seek-%-lazy_index: fate-% libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK_LAZY_INDEX): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC) -lazy_index 1
+$(FATE_SEEK_LAZY_INDEX): REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%-lazy_index=%)
+
+# the same seeks, with the index kept in a compact form
+
+FATE_SEEK_COMPACT_INDEX-$(call ENCDEC2, MPEG4,      PCM_ALAW,  MOV)       += lavf-mov
+FATE_SEEK_COMPACT_INDEX-$(call ENCDEC2, MPEG4,      MP2,       MATROSKA)  += lavf-mkv
+
+fate-seek-lavf-mov-compactindex: SRC = lavf/lavf.mov
+fate-seek-lavf-mkv-compactindex: SRC = lavf/lavf.mkv
+
+FATE_SEEK_COMPACT_INDEX = $(FATE_SEEK_COMPACT_INDEX-yes:%=fate-seek-%-compactindex)
+
+$(FATE_SEEK_COMPACT_INDEX): fate-seek-%-compactindex: fate-% libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK_COMPACT_INDEX): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC) -fflags +compactindex
+$(FATE_SEEK_COMPACT_INDEX): REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%-compactindex=%)
+
 # extra files
 
 FATE_SEEK_EXTRA-$(CONFIG_MP3_DEMUXER)   += fate-seek-extra-mp3
@@ -254,12 +286,15 @@ FATE_SEEK_EXTRA-$(CONFIG_MOV_DEMUXER) += fate-seek-extra-mp4
 FATE_SEEK_EXTRA-$(CONFIG_MOV_DEMUXER) += fate-seek-empty-edit-mp4
 FATE_SEEK_EXTRA-$(CONFIG_MOV_DEMUXER) += fate-seek-test-iibbibb-mp4
 FATE_SEEK_EXTRA-$(CONFIG_MOV_DEMUXER) += fate-seek-test-iibbibb-neg-ctts-mp4
+FATE_SEEK_EXTRA-$(CONFIG_MOV_DEMUXER) += fate-seek-extra-mp4-lazy_index
 
 fate-seek-extra-mp3:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/gapless/gapless.mp3 -fastseek 1
 fate-seek-extra-mp4:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mov/buck480p30_na.mp4 -duration 180 -frames 4
 fate-seek-empty-edit-mp4:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mov/empty_edit_5s.mp4 -duration 15 -frames 4
 fate-seek-test-iibbibb-mp4:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mov/test_iibbibb.mp4 -duration 13 -frames 4
 fate-seek-test-iibbibb-neg-ctts-mp4:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mov/test_iibbibb_neg_ctts.mp4 -duration 13 -frames 4
+fate-seek-extra-mp4-lazy_index:  CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mov/buck480p30_na.mp4 -duration 180 -frames 4 -lazy_index 1
+fate-seek-extra-mp4-lazy_index:  REF = $(SRC_PATH)/tests/ref/seek/extra-mp4
 fate-seek-cache-pipe: CMD = cat $(TARGET_SAMPLES)/gapless/gapless.mp3 | run libavformat/tests/seek$(EXESUF) cache:pipe:0 -read_ahead_limit -1
 fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_SAMPLES)/mkv/codec_delay_opus.mkv
 
@@ -271,6 +306,6 @@ $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(T
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_LAZY_INDEX) $(FATE_SEEK_COMPACT_INDEX)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
 fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
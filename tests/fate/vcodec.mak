@@ -274,6 +274,19 @@ fate-vsynth%-mpeg2-thread:       ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
 fate-vsynth%-mpeg2-thread-ivlc:  ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -intra_vlc 1 -threads 2 -slices 2
 
+# The B-frame decision lookahead runs on the encoder threads.
+FATE_VSYNTH1_THREADS-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO MPEGVIDEO) += fate-vsynth1-mpeg2-bstrategy-thread
+fate-vsynth%-mpeg2-bstrategy-thread: FMT     = mpeg2video
+fate-vsynth%-mpeg2-bstrategy-thread: CODEC   = mpeg2video
+fate-vsynth%-mpeg2-bstrategy-thread: ENCOPTS = -qscale 10 -bf 3 -b_strategy 2 \
+                                               -brd_scale 1 -threads 3 -slices 2
+
+FATE_VSYNTH1_THREADS-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO MPEGVIDEO) += fate-vsynth1-mpeg2-bstrategy1-thread
+fate-vsynth%-mpeg2-bstrategy1-thread: FMT     = mpeg2video
+fate-vsynth%-mpeg2-bstrategy1-thread: CODEC   = mpeg2video
+fate-vsynth%-mpeg2-bstrategy1-thread: ENCOPTS = -qscale 10 -bf 3 -b_strategy 1 \
+                                                -threads 3 -slices 2
+
 FATE_MPEG4_MP4 = mpeg4
 FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adv                                              \
@@ -325,6 +338,12 @@ fate-vsynth%-mpeg4-thread:       ENCOPTS = -b 500k -flags +mv4+aic         \
                                            -mbd bits -ps 200 -bf 2         \
                                            -threads 2 -slices 2
 
+# Only the decoding side differs from the other tests, one input is enough.
+FATE_VSYNTH1_THREADS-$(call ENCDEC, MPEG4, AVI) += fate-vsynth1-mpeg4-shared-threads
+fate-vsynth%-mpeg4-shared-threads: ENCOPTS   = -qscale 8 -flags +mv4 -bf 2
+fate-vsynth%-mpeg4-shared-threads: DECINOPTS = -shared_threads 2 -threads 3 \
+                                               -thread_type frame
+
 FATE_VCODEC-$(call ENCDEC, MSMPEG4V3, AVI) += msmpeg4
 fate-vsynth%-msmpeg4:            ENCOPTS = -qscale 10
 
@@ -447,7 +466,7 @@ FATE_VCODEC-$(call ENCDEC, Y41P, AVI) += y41p
 FATE_VCODEC-$(call ENCDEC, ZLIB, AVI) += zlib
 
 FATE_VCODEC += $(FATE_VCODEC-yes)
-FATE_VSYNTH1 = $(FATE_VCODEC:%=fate-vsynth1-%)
+FATE_VSYNTH1 = $(FATE_VCODEC:%=fate-vsynth1-%) $(FATE_VSYNTH1_THREADS-yes)
 FATE_VSYNTH2 = $(FATE_VCODEC:%=fate-vsynth2-%)
 FATE_VSYNTH_LENA = $(FATE_VCODEC:%=fate-vsynth_lena-%)
 # Redundant tests because they just resize the input
@@ -108,6 +108,8 @@ fate-vp8-size-change$(1): REF = $(SRC_PATH)/tests/ref/fate/vp8-size-change
 endef
 
 $(eval $(call FATE_VP8_FULL))
+# sliced decoding, whose jobs wait for each other, with a small shared pool
+$(eval $(call FATE_VP8_FULL,-shared-threads,-shared_threads 1 -threads 4 -thread_type slice))
 
 FATE_SAMPLES_AVCONV += $(FATE_VP8-yes)
 fate-vp8: $(FATE_VP8-yes)